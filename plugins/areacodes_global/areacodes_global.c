@@ -27,41 +27,33 @@
 #include <rm/rm.h>
 
 #include "csv.h"
+#include "trie.h"
 
 typedef struct {
 	guint signal_id;
-	GHashTable *table;
+	guint batch_signal_id;
+	AreaCodesTrie *trie;
 } RmGlobalAreaCodesPlugin;
 
 /**
- * areacodes_get_area_code:
+ * areacodes_get_city_full:
  * @areacodes_plugin: a #RmGlobalAreaCodesPlugin
- * @full_number: full phone number
+ * @full_number: remote caller number in international format
  *
- * Get area code pointer based on full_number
+ * Lookup city name by full number
  *
- * Returns: a #RmAreaCode
+ * Returns: city name or empty string
  */
-RmAreaCode *areacodes_get_area_code(RmGlobalAreaCodesPlugin *areacodes_plugin, const gchar *full_number)
+static gchar *areacodes_get_city_full(RmGlobalAreaCodesPlugin *areacodes_plugin, const gchar *full_number)
 {
-	RmAreaCode *areacode;
-	gchar sub_string[7];
-	gint index;
-	gint len = strlen(full_number);
-
-	index = len > 6 ? 6 : len;
+	const gchar *city = NULL;
 
-	while (index-- > 0) {
-		memset(sub_string, 0, sizeof(sub_string));
-		strncpy(sub_string, full_number + 2, index);
-
-		areacode = g_hash_table_lookup(areacodes_plugin->table, sub_string);
-		if (areacode) {
-			return areacode;
-		}
+	/* Skip international prefix */
+	if (areacodes_plugin->trie && full_number && full_number[0] && full_number[1]) {
+		city = areacodes_trie_lookup(areacodes_plugin->trie, full_number + 2);
 	}
 
-	return NULL;
+	return g_strdup(city ? city : "");
 }
 
 /**
@@ -75,63 +67,18 @@ RmAreaCode *areacodes_get_area_code(RmGlobalAreaCodesPlugin *areacodes_plugin, c
  */
 static gchar *areacodes_get_city(RmGlobalAreaCodesPlugin *areacodes_plugin, gchar *number)
 {
-	RmAreaCode *areacode = NULL;
 	gchar *full_number;
-	gchar *ret = NULL;
-	gint len;
-	gchar sub_string[6];
-	gchar *local_number;
+	gchar *city;
 
-	if (!areacodes_plugin->table) {
+	if (!areacodes_plugin->trie) {
 		return g_strdup("");
 	}
 
 	full_number = rm_number_full(number, TRUE);
-
-	/* Find area code */
-	areacode = areacodes_get_area_code(areacodes_plugin, full_number);
-
-	if (!areacode) {
-		g_free(full_number);
-		return g_strdup("");
-	}
-
-	local_number = g_strdup_printf("0%s", full_number + 2 + areacode->skip);
+	city = areacodes_get_city_full(areacodes_plugin, full_number);
 	g_free(full_number);
 
-	len = strlen(local_number);
-
-	/* Check for a 3 char match */
-	if (len >= 3 && !ret) {
-		memset(sub_string, 0, sizeof(sub_string));
-		strncpy(sub_string, local_number, 3);
-
-		ret = g_hash_table_lookup(areacode->table, sub_string);
-	}
-
-	/* Check for a 4 char match */
-	if (len >= 4 && !ret) {
-		memset(sub_string, 0, sizeof(sub_string));
-		strncpy(sub_string, local_number, 4);
-
-		ret = g_hash_table_lookup(areacode->table, sub_string);
-	}
-
-	/* Check for a 5 char match */
-	if (len >= 5 && !ret) {
-		memset(sub_string, 0, sizeof(sub_string));
-		strncpy(sub_string, local_number, 5);
-
-		ret = g_hash_table_lookup(areacode->table, sub_string);
-	}
-
-	g_free(local_number);
-
-	if (!ret) {
-		return g_strdup("");
-	}
-
-	return rm_convert_utf8(ret, -1);
+	return city;
 }
 
 /**
@@ -157,6 +104,48 @@ static void areacodes_contact_process_cb(RmObject *obj, RmContact *contact, gpoi
 	contact->city = areacodes_get_city(areacodes_plugin, contact->number);
 }
 
+/**
+ * areacodes_contacts_process_cb:
+ * @obj: a #RmObject
+ * @contacts: array of #RmContact
+ * @user_data: pointer to areacodes plugin structure
+ *
+ * Contacts process callback (searches for areacodes and set city names of all contacts)
+ */
+static void areacodes_contacts_process_cb(RmObject *obj, GPtrArray *contacts, gpointer user_data)
+{
+	RmGlobalAreaCodesPlugin *areacodes_plugin = user_data;
+	const gchar **numbers = g_new(const gchar*, contacts->len + 1);
+	gchar **full_numbers = g_new(gchar*, contacts->len + 1);
+	guint idx;
+
+	for (idx = 0; idx < contacts->len; idx++) {
+		RmContact *contact = g_ptr_array_index(contacts, idx);
+
+		numbers[idx] = contact->number;
+	}
+
+	rm_number_full_batch(numbers, full_numbers, contacts->len, TRUE);
+
+	for (idx = 0; idx < contacts->len; idx++) {
+		RmContact *contact = g_ptr_array_index(contacts, idx);
+
+		if (!RM_EMPTY_STRING(contact->number)) {
+			/* Entry may be shared (e.g. an address book result), modify a private copy */
+			contact = rm_contact_make_writable(contact);
+			g_ptr_array_index(contacts, idx) = contact;
+
+			g_free(contact->city);
+			contact->city = areacodes_get_city_full(areacodes_plugin, full_numbers[idx]);
+		}
+
+		g_free(full_numbers[idx]);
+	}
+
+	g_free(full_numbers);
+	g_free(numbers);
+}
+
 /**
  * areacodes_plugin_init:
  * @plugin: a #RmPlugin
@@ -168,36 +157,44 @@ static void areacodes_contact_process_cb(RmObject *obj, RmContact *contact, gpoi
 static gboolean areacodes_plugin_init(RmPlugin *plugin)
 {
 	RmGlobalAreaCodesPlugin *areacodes_plugin = g_slice_alloc0(sizeof(RmGlobalAreaCodesPlugin));
-	gchar *areacodes = g_build_filename(rm_get_directory(RM_PLUGINS), "areacodes_global", "globalareacodes.csv", NULL);
-	gchar *data;
-	gsize read;
-
-	g_debug("AreaCodes: '%s'", areacodes);
+	gchar *areacodes = g_build_filename(rm_get_directory(RM_PLUGINS), "areacodes_global", "globalareacodes.trie", NULL);
+	GFile *file;
+	GFileInputStream *stream;
+	GBytes *bytes;
 
 	plugin->priv = areacodes_plugin;
 
-	/* Load data file */
-	data = rm_file_load(areacodes, &read);
-	if (!data || read < 1) {
-		g_debug("Could not load areacodes: %s", areacodes);
-		g_free(data);
-		g_free(areacodes);
+	/* Map prebuilt trie */
+	areacodes_plugin->trie = areacodes_trie_new_from_file(areacodes);
+	g_free(areacodes);
 
-		return FALSE;
-	}
+	if (!areacodes_plugin->trie) {
+		/* Fall back to parsing csv data */
+		areacodes = g_build_filename(rm_get_directory(RM_PLUGINS), "areacodes_global", "globalareacodes.csv", NULL);
+		g_debug("AreaCodes: '%s'", areacodes);
 
-	/* Make sure data is terminated */
-	data[read - 1] = '\0';
+		file = g_file_new_for_path(areacodes);
+		stream = g_file_read(file, NULL, NULL);
+		g_object_unref(file);
+		if (!stream) {
+			g_debug("Could not load areacodes: %s", areacodes);
+			g_free(areacodes);
 
-	/* Parse data */
-	areacodes_plugin->table = csv_parse_global_areacodes_data(data);
+			return FALSE;
+		}
 
-	/* Free data */
-	g_free(data);
-	g_free(areacodes);
+		/* Parse data */
+		bytes = csv_parse_global_areacodes_stream(G_INPUT_STREAM(stream));
+		areacodes_plugin->trie = areacodes_trie_new(bytes);
+
+		g_bytes_unref(bytes);
+		g_object_unref(stream);
+		g_free(areacodes);
+	}
 
-	/* Connect to "contact-process" signal using "after" as this should come last */
-	areacodes_plugin->signal_id = g_signal_connect_after(G_OBJECT(rm_object), "contact-process", G_CALLBACK(areacodes_contact_process_cb), areacodes_plugin);
+	/* Connect to "contact-process" signal using "after" as this should come last, batches are handled by "contacts-process" */
+	areacodes_plugin->signal_id = g_signal_connect_after(G_OBJECT(rm_object), "contact-process::single", G_CALLBACK(areacodes_contact_process_cb), areacodes_plugin);
+	areacodes_plugin->batch_signal_id = g_signal_connect_after(G_OBJECT(rm_object), "contacts-process", G_CALLBACK(areacodes_contacts_process_cb), areacodes_plugin);
 
 	return TRUE;
 }
@@ -218,10 +215,13 @@ static gboolean areacodes_plugin_shutdown(RmPlugin *plugin)
 	if (g_signal_handler_is_connected(G_OBJECT(rm_object), areacodes_plugin->signal_id)) {
 		g_signal_handler_disconnect(G_OBJECT(rm_object), areacodes_plugin->signal_id);
 	}
+	if (g_signal_handler_is_connected(G_OBJECT(rm_object), areacodes_plugin->batch_signal_id)) {
+		g_signal_handler_disconnect(G_OBJECT(rm_object), areacodes_plugin->batch_signal_id);
+	}
 
-	/* Free hash table */
-	if (areacodes_plugin->table) {
-		g_hash_table_unref(areacodes_plugin->table);
+	/* Release trie */
+	if (areacodes_plugin->trie) {
+		areacodes_trie_free(areacodes_plugin->trie);
 	}
 
 	return TRUE;
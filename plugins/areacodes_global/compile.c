@@ -0,0 +1,80 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include <rm/rm.h>
+
+#include "csv.h"
+#include "trie.h"
+
+/*
+ * Build time helper: compiles globalareacodes.csv into the trie blob
+ * which is mapped by the plugin instead of parsing the csv on every start.
+ */
+int main(int argc, char **argv)
+{
+	GFile *file;
+	GFileInputStream *stream;
+	GBytes *bytes;
+	AreaCodesTrie *trie;
+	GError *error = NULL;
+	gconstpointer data;
+	gsize size;
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <globalareacodes.csv> <globalareacodes.trie>\n", argv[0]);
+		return 1;
+	}
+
+	file = g_file_new_for_path(argv[1]);
+	stream = g_file_read(file, NULL, &error);
+	g_object_unref(file);
+	if (!stream) {
+		fprintf(stderr, "Could not open %s: %s\n", argv[1], error->message);
+		g_error_free(error);
+		return 1;
+	}
+
+	bytes = csv_parse_global_areacodes_stream(G_INPUT_STREAM(stream));
+	g_object_unref(stream);
+
+	/* Make sure the plugin accepts what we are writing */
+	trie = areacodes_trie_new(bytes);
+	if (!trie) {
+		fprintf(stderr, "Could not build trie from %s\n", argv[1]);
+		g_bytes_unref(bytes);
+		return 1;
+	}
+	areacodes_trie_free(trie);
+
+	data = g_bytes_get_data(bytes, &size);
+	if (!g_file_set_contents(argv[2], data, size, &error)) {
+		fprintf(stderr, "Could not write %s: %s\n", argv[2], error->message);
+		g_error_free(error);
+		g_bytes_unref(bytes);
+		return 1;
+	}
+
+	g_bytes_unref(bytes);
+
+	return 0;
+}
@@ -24,112 +24,45 @@
 
 #include <rm/rm.h>
 #include <csv.h>
+#include "trie.h"
 
 #define CSV_AREACODES "\"Country\",\"Country Code\",\"Area\",\"Area Code\""
 
-/**
- * csv_trim:
- * @str_in: input string
- *
- * Trim csv string
- *
- * Returns: trimmed string
- */
-static gchar *csv_trim(const gchar *str_in)
-{
-	gchar *str_out;
-	gint len = strlen(str_in) - 1;
-
-	if (len <= 0) {
-		return g_strdup("");
-	}
-
-	str_out = g_malloc0(len);
-	strncpy(str_out, str_in + 1, len - 1);
-
-	return str_out;
-}
-
 /**
  * csv_parse_global_areacodes:
- * @ptr: hashtable pointer
- * @split: splitted line
+ * @ptr: trie builder pointer
+ * @fields: fields of current line
+ * @count: number of fields
  *
  * Parse areacodes line
  *
- * Returns: hashtable pointer
+ * Returns: trie builder pointer
  */
-static gpointer csv_parse_global_areacodes(gpointer ptr, gchar **split)
+static gpointer csv_parse_global_areacodes(gpointer ptr, const RmCsvField *fields, guint count)
 {
-	GHashTable *global_table = ptr;
-
-	/* If we have 4 fields add it to table */
-	if (g_strv_length(split) == 4) {
-		RmAreaCode *areacode;
+	AreaCodesTrieBuilder *builder = ptr;
 
-		areacode = g_hash_table_lookup(global_table, split[1]);
-		if (!areacode) {
-			areacode = g_slice_new(RmAreaCode);
-			areacode->country = csv_trim(split[0]);
-			areacode->skip = strlen(split[1]);
-
-			areacode->table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
-			g_hash_table_insert(global_table, g_strdup(split[1]), areacode);
-		}
-
-		if (strlen(split[2]) && strlen(split[3])) {
-			g_hash_table_insert(areacode->table, csv_trim(split[3]), csv_trim(split[2]));
-		}
+	/* If we have 4 fields add it to trie */
+	if (count == 4) {
+		areacodes_trie_builder_add(builder, fields[0].str, fields[1].str, fields[2].str, fields[3].str);
 	}
 
 	return ptr;
 }
 
 /**
- * csv_data_destroy:
- * @data: data pointer
- *
- * Free key data of hash table
- */
-static void csv_data_destroy(gpointer data)
-{
-	g_free(data);
-}
-
-/**
- * csv_areacode_destroy:
- * @data: data pointer
- *
- * Free value data of hash table
- */
-static void csv_areacode_destroy(gpointer data)
-{
-	RmAreaCode *areacode = data;
-
-	g_free(areacode->country);
-
-	if (areacode->table) {
-		g_hash_table_destroy(areacode->table);
-	}
-
-	g_slice_free(RmAreaCode, data);
-}
-
-/**
- * csv_parse_global_areacodes_data:
- * @data: input data from areacodes file
+ * csv_parse_global_areacodes_stream:
+ * @stream: input stream of areacodes file
  *
  * Parse Areacodes data
  *
- * Returns: hashtable pointer
+ * Returns: area code trie blob
  */
-GHashTable *csv_parse_global_areacodes_data(gchar *data)
+GBytes *csv_parse_global_areacodes_stream(GInputStream *stream)
 {
-	GHashTable *global_table = NULL;
-
-	global_table = g_hash_table_new_full(g_str_hash, g_str_equal, csv_data_destroy, csv_areacode_destroy);
+	AreaCodesTrieBuilder *builder = areacodes_trie_builder_new();
 
-	rm_csv_parse_data(data, CSV_AREACODES, csv_parse_global_areacodes, global_table);
+	rm_csv_parse_stream(stream, CSV_AREACODES, csv_parse_global_areacodes, builder, NULL, NULL);
 
-	return global_table;
+	return areacodes_trie_builder_end(builder);
 }
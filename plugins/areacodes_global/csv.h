@@ -20,15 +20,9 @@
 #ifndef AREACODES_CSV_H
 #define AREACODES_CSV_H
 
-typedef struct _RmAreaCode {
-	gchar *country;
-	gint skip;
-	GHashTable *table;
-} RmAreaCode;
-
 G_BEGIN_DECLS
 
-GHashTable *csv_parse_global_areacodes_data(gchar *data);
+GBytes *csv_parse_global_areacodes_stream(GInputStream *stream);
 
 G_END_DECLS
 
@@ -0,0 +1,522 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <rm/rm.h>
+
+#include "trie.h"
+
+/* Byte order marker, guards against blobs written by older big endian builds */
+#define AREACODES_TRIE_BYTE_ORDER 0x01020304
+
+/*
+ * Blob layout, all integers are stored little endian so a blob can be shared between architectures:
+ *  - AreaCodesTrieHeader
+ *  - AreaCodesTrieNode[nodes], node 0 is the country code root
+ *  - string pool of NUL terminated names, offset 0 is the empty string
+ *
+ * Children of a node are stored consecutively ordered by digit, starting at index first.
+ * Nodes completing a country code point to the root of their area code trie.
+ */
+typedef struct {
+	gchar magic[8];
+	guint32 byte_order;
+	guint32 version;
+	guint32 nodes;
+	guint32 strings;
+} AreaCodesTrieHeader;
+
+typedef struct {
+	/* Bit d is set if a child for digit d exists */
+	guint16 children;
+	guint16 reserved;
+	/* Index of first child node */
+	guint32 first;
+	/* Offset of country or city name, 0 if none */
+	guint32 name;
+	/* Index of area code trie root of a country, 0 if none */
+	guint32 area;
+} AreaCodesTrieNode;
+
+struct AreaCodesTrie {
+	GBytes *bytes;
+	const AreaCodesTrieNode *nodes;
+	guint32 count;
+	const gchar *strings;
+	guint32 size;
+};
+
+typedef struct AreaCodesTrieBuildNode {
+	struct AreaCodesTrieBuildNode *children[10];
+	struct AreaCodesTrieBuildNode *area;
+	gchar *name;
+	guint32 index;
+} AreaCodesTrieBuildNode;
+
+struct AreaCodesTrieBuilder {
+	AreaCodesTrieBuildNode *root;
+};
+
+/**
+ * areacodes_trie_is_number:
+ * @str: string
+ *
+ * Checks whether @str is a non-empty digit string.
+ *
+ * Returns: %TRUE if @str only consists of digits
+ */
+static gboolean areacodes_trie_is_number(const gchar *str)
+{
+	if (RM_EMPTY_STRING(str)) {
+		return FALSE;
+	}
+
+	for (; *str; str++) {
+		if (!g_ascii_isdigit(*str)) {
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/**
+ * areacodes_trie_build_insert:
+ * @node: a #AreaCodesTrieBuildNode
+ * @digits: digit string
+ *
+ * Walks down @digits and creates missing nodes.
+ *
+ * Returns: node of last digit
+ */
+static AreaCodesTrieBuildNode *areacodes_trie_build_insert(AreaCodesTrieBuildNode *node, const gchar *digits)
+{
+	for (; *digits; digits++) {
+		gint digit = *digits - '0';
+
+		if (!node->children[digit]) {
+			node->children[digit] = g_slice_new0(AreaCodesTrieBuildNode);
+		}
+
+		node = node->children[digit];
+	}
+
+	return node;
+}
+
+/**
+ * areacodes_trie_build_free:
+ * @node: a #AreaCodesTrieBuildNode
+ *
+ * Frees @node and all of its descendants.
+ */
+static void areacodes_trie_build_free(AreaCodesTrieBuildNode *node)
+{
+	gint digit;
+
+	if (!node) {
+		return;
+	}
+
+	for (digit = 0; digit < 10; digit++) {
+		areacodes_trie_build_free(node->children[digit]);
+	}
+
+	areacodes_trie_build_free(node->area);
+	g_free(node->name);
+	g_slice_free(AreaCodesTrieBuildNode, node);
+}
+
+/**
+ * areacodes_trie_builder_new:
+ *
+ * Creates a new area code trie builder.
+ *
+ * Returns: new #AreaCodesTrieBuilder
+ */
+AreaCodesTrieBuilder *areacodes_trie_builder_new(void)
+{
+	AreaCodesTrieBuilder *builder = g_slice_new(AreaCodesTrieBuilder);
+
+	builder->root = g_slice_new0(AreaCodesTrieBuildNode);
+
+	return builder;
+}
+
+/**
+ * areacodes_trie_builder_add:
+ * @builder: a #AreaCodesTrieBuilder
+ * @country: country name
+ * @country_code: country code
+ * @city: city name or %NULL
+ * @area_code: area code or %NULL
+ *
+ * Adds an area code entry. Names are stored in UTF-8, so lookups can return them as is.
+ * The first name of a country code is kept, later area codes replace earlier ones.
+ * Area codes containing other characters than digits can never match a number and are skipped.
+ */
+void areacodes_trie_builder_add(AreaCodesTrieBuilder *builder, const gchar *country, const gchar *country_code, const gchar *city, const gchar *area_code)
+{
+	AreaCodesTrieBuildNode *node;
+
+	if (!areacodes_trie_is_number(country_code)) {
+		return;
+	}
+
+	node = areacodes_trie_build_insert(builder->root, country_code);
+	if (!node->area) {
+		node->name = rm_convert_utf8(country, -1);
+		node->area = g_slice_new0(AreaCodesTrieBuildNode);
+	}
+
+	if (RM_EMPTY_STRING(city) || !areacodes_trie_is_number(area_code)) {
+		return;
+	}
+
+	node = areacodes_trie_build_insert(node->area, area_code);
+	g_free(node->name);
+	node->name = rm_convert_utf8(city, -1);
+}
+
+/**
+ * areacodes_trie_builder_string:
+ * @strings: string pool
+ * @offsets: hash table of already stored strings
+ * @str: string to store
+ *
+ * Stores @str once within string pool.
+ *
+ * Returns: offset of @str in string pool
+ */
+static guint32 areacodes_trie_builder_string(GString *strings, GHashTable *offsets, const gchar *str)
+{
+	gpointer offset;
+
+	if (RM_EMPTY_STRING(str)) {
+		return 0;
+	}
+
+	if (g_hash_table_lookup_extended(offsets, str, NULL, &offset)) {
+		return GPOINTER_TO_UINT(offset);
+	}
+
+	offset = GUINT_TO_POINTER(strings->len);
+	g_string_append_len(strings, str, strlen(str) + 1);
+	g_hash_table_insert(offsets, (gpointer)str, offset);
+
+	return GPOINTER_TO_UINT(offset);
+}
+
+/**
+ * areacodes_trie_builder_end:
+ * @builder: a #AreaCodesTrieBuilder
+ *
+ * Serializes the trie into its binary representation and frees @builder.
+ *
+ * Returns: trie blob, use areacodes_trie_new() to access it
+ */
+GBytes *areacodes_trie_builder_end(AreaCodesTrieBuilder *builder)
+{
+	AreaCodesTrieHeader header;
+	GPtrArray *order = g_ptr_array_new();
+	GHashTable *offsets = g_hash_table_new(g_str_hash, g_str_equal);
+	GString *strings = g_string_new_len("", 1);
+	GByteArray *blob;
+	guint idx;
+
+	/* Number nodes breadth first, so that children of each node are consecutive */
+	g_ptr_array_add(order, builder->root);
+
+	for (idx = 0; idx < order->len; idx++) {
+		AreaCodesTrieBuildNode *node = g_ptr_array_index(order, idx);
+		gint digit;
+
+		node->index = idx;
+
+		for (digit = 0; digit < 10; digit++) {
+			if (node->children[digit]) {
+				g_ptr_array_add(order, node->children[digit]);
+			}
+		}
+
+		if (node->area) {
+			g_ptr_array_add(order, node->area);
+		}
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, AREACODES_TRIE_MAGIC, sizeof(AREACODES_TRIE_MAGIC));
+	header.byte_order = GUINT32_TO_LE(AREACODES_TRIE_BYTE_ORDER);
+	header.version = GUINT32_TO_LE(AREACODES_TRIE_VERSION);
+	header.nodes = GUINT32_TO_LE(order->len);
+
+	blob = g_byte_array_sized_new(sizeof(header) + order->len * sizeof(AreaCodesTrieNode));
+	g_byte_array_append(blob, (guint8*)&header, sizeof(header));
+
+	for (idx = 0; idx < order->len; idx++) {
+		AreaCodesTrieBuildNode *node = g_ptr_array_index(order, idx);
+		AreaCodesTrieNode data;
+		gint digit;
+
+		guint16 children = 0;
+		guint32 first = 0;
+
+		memset(&data, 0, sizeof(data));
+
+		for (digit = 0; digit < 10; digit++) {
+			if (node->children[digit]) {
+				if (!children) {
+					first = node->children[digit]->index;
+				}
+				children |= 1 << digit;
+			}
+		}
+
+		data.children = GUINT16_TO_LE(children);
+		data.first = GUINT32_TO_LE(first);
+		data.name = GUINT32_TO_LE(areacodes_trie_builder_string(strings, offsets, node->name));
+		data.area = GUINT32_TO_LE(node->area ? node->area->index : 0);
+
+		g_byte_array_append(blob, (guint8*)&data, sizeof(data));
+	}
+
+	/* Patch string pool size into header */
+	((AreaCodesTrieHeader*)blob->data)->strings = GUINT32_TO_LE(strings->len);
+	g_byte_array_append(blob, (guint8*)strings->str, strings->len);
+
+	g_debug("%s(): %u nodes, %" G_GSIZE_FORMAT " bytes of names", __FUNCTION__, order->len, strings->len);
+
+	g_string_free(strings, TRUE);
+	g_hash_table_destroy(offsets);
+	g_ptr_array_free(order, TRUE);
+	areacodes_trie_build_free(builder->root);
+	g_slice_free(AreaCodesTrieBuilder, builder);
+
+	return g_byte_array_free_to_bytes(blob);
+}
+
+/**
+ * areacodes_trie_new:
+ * @bytes: trie blob
+ *
+ * Creates a trie accessing @bytes. Nodes are validated lazily while walking the trie,
+ * so that a mapped blob is only paged in where it is used.
+ *
+ * Returns: new #AreaCodesTrie or %NULL if @bytes is not a valid blob
+ */
+AreaCodesTrie *areacodes_trie_new(GBytes *bytes)
+{
+	AreaCodesTrie *trie;
+	AreaCodesTrieHeader header;
+	const guint8 *data;
+	gsize size;
+	guint32 nodes;
+	guint32 strings;
+
+	data = g_bytes_get_data(bytes, &size);
+	if (size < sizeof(AreaCodesTrieHeader)) {
+		return NULL;
+	}
+
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, AREACODES_TRIE_MAGIC, sizeof(AREACODES_TRIE_MAGIC)) || GUINT32_FROM_LE(header.byte_order) != AREACODES_TRIE_BYTE_ORDER ||
+	    GUINT32_FROM_LE(header.version) != AREACODES_TRIE_VERSION) {
+		return NULL;
+	}
+
+	nodes = GUINT32_FROM_LE(header.nodes);
+	strings = GUINT32_FROM_LE(header.strings);
+	if (!nodes || !strings || nodes > (size - sizeof(AreaCodesTrieHeader)) / sizeof(AreaCodesTrieNode) ||
+	    size != sizeof(AreaCodesTrieHeader) + (gsize)nodes * sizeof(AreaCodesTrieNode) + strings) {
+		return NULL;
+	}
+
+	trie = g_slice_new(AreaCodesTrie);
+	trie->bytes = g_bytes_ref(bytes);
+	trie->nodes = (const AreaCodesTrieNode*)(data + sizeof(AreaCodesTrieHeader));
+	trie->count = nodes;
+	trie->strings = (const gchar*)(trie->nodes + trie->count);
+	trie->size = strings;
+
+	/* Names must not run past the end of the pool */
+	if (trie->strings[0] != '\0' || trie->strings[trie->size - 1] != '\0') {
+		areacodes_trie_free(trie);
+		return NULL;
+	}
+
+	return trie;
+}
+
+/**
+ * areacodes_trie_new_from_file:
+ * @file_name: file name of trie blob
+ *
+ * Maps a prebuilt trie blob into memory.
+ *
+ * Returns: new #AreaCodesTrie or %NULL on error
+ */
+AreaCodesTrie *areacodes_trie_new_from_file(const gchar *file_name)
+{
+	AreaCodesTrie *trie;
+	GMappedFile *map;
+	GBytes *bytes;
+	GError *error = NULL;
+
+	map = g_mapped_file_new(file_name, FALSE, &error);
+	if (!map) {
+		g_debug("%s(): Could not map '%s': %s", __FUNCTION__, file_name, error->message);
+		g_error_free(error);
+		return NULL;
+	}
+
+	bytes = g_mapped_file_get_bytes(map);
+	g_mapped_file_unref(map);
+
+	trie = areacodes_trie_new(bytes);
+	g_bytes_unref(bytes);
+
+	if (!trie) {
+		g_debug("%s(): Invalid trie '%s'", __FUNCTION__, file_name);
+	}
+
+	return trie;
+}
+
+/**
+ * areacodes_trie_free:
+ * @trie: a #AreaCodesTrie
+ *
+ * Frees @trie and releases its blob.
+ */
+void areacodes_trie_free(AreaCodesTrie *trie)
+{
+	g_bytes_unref(trie->bytes);
+	g_slice_free(AreaCodesTrie, trie);
+}
+
+/**
+ * areacodes_trie_popcount:
+ * @value: bit mask
+ *
+ * Returns: number of set bits in @value
+ */
+static inline guint areacodes_trie_popcount(guint32 value)
+{
+	value = value - ((value >> 1) & 0x55555555);
+	value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+
+	return (((value + (value >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+/**
+ * areacodes_trie_child:
+ * @trie: a #AreaCodesTrie
+ * @node: current node
+ * @digit: next digit character
+ *
+ * Returns: child node of @node for @digit or %NULL
+ */
+static inline const AreaCodesTrieNode *areacodes_trie_child(AreaCodesTrie *trie, const AreaCodesTrieNode *node, gchar digit)
+{
+	guint16 children = GUINT16_FROM_LE(node->children);
+	guint bit;
+	guint32 index;
+
+	if (digit < '0' || digit > '9') {
+		return NULL;
+	}
+
+	bit = 1 << (digit - '0');
+	if (!(children & bit)) {
+		return NULL;
+	}
+
+	index = GUINT32_FROM_LE(node->first) + areacodes_trie_popcount(children & (bit - 1));
+	if (index >= trie->count) {
+		return NULL;
+	}
+
+	return &trie->nodes[index];
+}
+
+/**
+ * areacodes_trie_name:
+ * @trie: a #AreaCodesTrie
+ * @node: a node
+ *
+ * Returns: name of @node or %NULL if it has none
+ */
+static inline const gchar *areacodes_trie_name(AreaCodesTrie *trie, const AreaCodesTrieNode *node)
+{
+	guint32 name = GUINT32_FROM_LE(node->name);
+
+	if (!name || name >= trie->size) {
+		return NULL;
+	}
+
+	return trie->strings + name;
+}
+
+/**
+ * areacodes_trie_lookup:
+ * @trie: a #AreaCodesTrie
+ * @number: number without international prefix
+ *
+ * Finds the city of @number in a single walk: the longest country code selects the area code trie,
+ * which is continued with the national number (leading 0 plus remaining digits) for the longest area code.
+ *
+ * Returns: UTF-8 city name owned by @trie or %NULL if no area code matches
+ */
+const gchar *areacodes_trie_lookup(AreaCodesTrie *trie, const gchar *number)
+{
+	const AreaCodesTrieNode *node = &trie->nodes[0];
+	const gchar *city = NULL;
+	const gchar *ptr;
+	guint32 area = 0;
+
+	/* Find longest country code */
+	for (ptr = number; (node = areacodes_trie_child(trie, node, *ptr)); ptr++) {
+		guint32 node_area = GUINT32_FROM_LE(node->area);
+
+		if (node_area && node_area < trie->count) {
+			area = node_area;
+			number = ptr + 1;
+		}
+	}
+
+	if (!area) {
+		return NULL;
+	}
+
+	/* Area codes are stored in national format */
+	node = areacodes_trie_child(trie, &trie->nodes[area], '0');
+
+	for (ptr = number; node; node = areacodes_trie_child(trie, node, *ptr++)) {
+		const gchar *name = areacodes_trie_name(trie, node);
+
+		if (name) {
+			city = name;
+		}
+	}
+
+	return city;
+}
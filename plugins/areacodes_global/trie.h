@@ -0,0 +1,42 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef AREACODES_TRIE_H
+#define AREACODES_TRIE_H
+
+G_BEGIN_DECLS
+
+#define AREACODES_TRIE_MAGIC "RMACT01"
+#define AREACODES_TRIE_VERSION 2
+
+typedef struct AreaCodesTrie AreaCodesTrie;
+typedef struct AreaCodesTrieBuilder AreaCodesTrieBuilder;
+
+AreaCodesTrieBuilder *areacodes_trie_builder_new(void);
+void areacodes_trie_builder_add(AreaCodesTrieBuilder *builder, const gchar *country, const gchar *country_code, const gchar *city, const gchar *area_code);
+GBytes *areacodes_trie_builder_end(AreaCodesTrieBuilder *builder);
+
+AreaCodesTrie *areacodes_trie_new(GBytes *bytes);
+AreaCodesTrie *areacodes_trie_new_from_file(const gchar *file_name);
+void areacodes_trie_free(AreaCodesTrie *trie);
+const gchar *areacodes_trie_lookup(AreaCodesTrie *trie, const gchar *number);
+
+G_END_DECLS
+
+#endif
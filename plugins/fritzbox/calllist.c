@@ -0,0 +1,221 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <libxml/parser.h>
+
+#include "calllist.h"
+
+/** Size of chunks read from the stream and fed into the push parser */
+#define CALLLIST_CHUNK_SIZE 8192
+
+/** Depth of <Call> elements: <root><Call> */
+#define CALLLIST_CALL_DEPTH 2
+
+static const gchar *calllist_field_names[CALLLIST_FIELD_MAX] = {
+	"Id",
+	"Type",
+	"Caller",
+	"Called",
+	"CallerNumber",
+	"CalledNumber",
+	"Name",
+	"Device",
+	"Port",
+	"Date",
+	"Duration",
+	"Path"
+};
+
+/**
+ * CallListParser:
+ *
+ * SAX state, field buffers are reused for all calls
+ */
+typedef struct {
+	CallListFunc func;
+	gpointer user_data;
+	/* Current element depth */
+	gint depth;
+	/* Inside of a <Call> element */
+	gboolean in_call;
+	/* Field currently read, -1 if none */
+	gint field;
+	GString *values[CALLLIST_FIELD_MAX];
+} CallListParser;
+
+/**
+ * calllist_start_element:
+ * @ctx: a #CallListParser
+ * @name: element name
+ * @prefix: element prefix
+ * @uri: element namespace
+ * @nb_namespaces: number of namespaces
+ * @namespaces: namespaces
+ * @nb_attributes: number of attributes
+ * @nb_defaulted: number of defaulted attributes
+ * @attributes: attributes
+ *
+ * Start a new call or the field of the current one
+ */
+static void calllist_start_element(void *ctx, const xmlChar *name, const xmlChar *prefix, const xmlChar *uri, int nb_namespaces,
+				   const xmlChar **namespaces, int nb_attributes, int nb_defaulted, const xmlChar **attributes)
+{
+	CallListParser *parser = ctx;
+	gint field;
+
+	parser->depth++;
+
+	if (parser->depth == CALLLIST_CALL_DEPTH && !strcmp((const gchar*)name, "Call")) {
+		for (field = 0; field < CALLLIST_FIELD_MAX; field++) {
+			g_string_truncate(parser->values[field], 0);
+		}
+
+		parser->in_call = TRUE;
+	} else if (parser->in_call && parser->depth == CALLLIST_CALL_DEPTH + 1) {
+		for (field = 0; field < CALLLIST_FIELD_MAX; field++) {
+			if (!strcmp((const gchar*)name, calllist_field_names[field])) {
+				parser->field = field;
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * calllist_end_element:
+ * @ctx: a #CallListParser
+ * @name: element name
+ * @prefix: element prefix
+ * @uri: element namespace
+ *
+ * Finish current field or emit the closed call
+ */
+static void calllist_end_element(void *ctx, const xmlChar *name, const xmlChar *prefix, const xmlChar *uri)
+{
+	CallListParser *parser = ctx;
+
+	if (parser->in_call && parser->depth == CALLLIST_CALL_DEPTH + 1) {
+		parser->field = -1;
+	} else if (parser->in_call && parser->depth == CALLLIST_CALL_DEPTH) {
+		const gchar *fields[CALLLIST_FIELD_MAX];
+		gint field;
+
+		for (field = 0; field < CALLLIST_FIELD_MAX; field++) {
+			fields[field] = parser->values[field]->len ? parser->values[field]->str : NULL;
+		}
+
+		parser->func(fields, parser->user_data);
+		parser->in_call = FALSE;
+	}
+
+	parser->depth--;
+}
+
+/**
+ * calllist_characters:
+ * @ctx: a #CallListParser
+ * @ch: character data
+ * @len: length of @ch
+ *
+ * Collect text of current field, text of nested elements is ignored
+ */
+static void calllist_characters(void *ctx, const xmlChar *ch, int len)
+{
+	CallListParser *parser = ctx;
+
+	if (parser->field >= 0 && parser->depth == CALLLIST_CALL_DEPTH + 1) {
+		g_string_append_len(parser->values[parser->field], (const gchar*)ch, len);
+	}
+}
+
+/**
+ * calllist_parse_stream:
+ * @stream: a #GInputStream delivering the call list xml
+ * @func: a #CallListFunc called for every call
+ * @user_data: user data for @func
+ * @cancellable: a #GCancellable
+ * @error: a #GError
+ *
+ * Parse TR-064 call list while it is read from @stream. Calls are handed to @func as their element
+ * closes, so memory usage does not depend on the size of the list.
+ *
+ * Returns: %TRUE if the complete list has been parsed
+ */
+gboolean calllist_parse_stream(GInputStream *stream, CallListFunc func, gpointer user_data, GCancellable *cancellable, GError **error)
+{
+	CallListParser parser;
+	xmlParserCtxtPtr ctxt;
+	xmlSAXHandler sax;
+	gchar *buffer;
+	gssize len = 0;
+	gint field;
+	gint err = 0;
+
+	memset(&parser, 0, sizeof(parser));
+	parser.func = func;
+	parser.user_data = user_data;
+	parser.field = -1;
+
+	memset(&sax, 0, sizeof(sax));
+	sax.initialized = XML_SAX2_MAGIC;
+	sax.startElementNs = calllist_start_element;
+	sax.endElementNs = calllist_end_element;
+	sax.characters = calllist_characters;
+
+	ctxt = xmlCreatePushParserCtxt(&sax, &parser, NULL, 0, NULL);
+	if (!ctxt) {
+		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_FAILED, "Could not create xml parser");
+		return FALSE;
+	}
+
+	xmlCtxtUseOptions(ctxt, XML_PARSE_NONET | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+
+	for (field = 0; field < CALLLIST_FIELD_MAX; field++) {
+		parser.values[field] = g_string_sized_new(32);
+	}
+
+	buffer = g_malloc(CALLLIST_CHUNK_SIZE);
+
+	while (!err && (len = g_input_stream_read(stream, buffer, CALLLIST_CHUNK_SIZE, cancellable, error)) > 0) {
+		err = xmlParseChunk(ctxt, buffer, len, 0);
+	}
+
+	if (!err && len == 0) {
+		err = xmlParseChunk(ctxt, NULL, 0, 1);
+	}
+
+	if (err && len >= 0) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Invalid call list (xml error %d)", err);
+	}
+
+	g_free(buffer);
+
+	for (field = 0; field < CALLLIST_FIELD_MAX; field++) {
+		g_string_free(parser.values[field], TRUE);
+	}
+
+	xmlFreeParserCtxt(ctxt);
+
+	return !err && len == 0;
+}
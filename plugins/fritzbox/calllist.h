@@ -0,0 +1,62 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef FRITZBOX_CALLLIST_H
+#define FRITZBOX_CALLLIST_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * CallListField:
+ *
+ * Child elements of a <Call> entry in the TR-064 call list
+ */
+typedef enum {
+	CALLLIST_FIELD_ID,
+	CALLLIST_FIELD_TYPE,
+	CALLLIST_FIELD_CALLER,
+	CALLLIST_FIELD_CALLED,
+	CALLLIST_FIELD_CALLER_NUMBER,
+	CALLLIST_FIELD_CALLED_NUMBER,
+	CALLLIST_FIELD_NAME,
+	CALLLIST_FIELD_DEVICE,
+	CALLLIST_FIELD_PORT,
+	CALLLIST_FIELD_DATE,
+	CALLLIST_FIELD_DURATION,
+	CALLLIST_FIELD_PATH,
+	CALLLIST_FIELD_MAX
+} CallListField;
+
+/**
+ * CallListFunc:
+ * @fields: text of each #CallListField, %NULL if missing or empty
+ * @user_data: user data
+ *
+ * Called for every <Call> once it is closed. @fields is only valid during the call.
+ */
+typedef void (*CallListFunc)(const gchar * const *fields, gpointer user_data);
+
+gboolean calllist_parse_stream(GInputStream *stream, CallListFunc func, gpointer user_data, GCancellable *cancellable, GError **error);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef FRITZBOX_CSV_PRIVATE_H
+#define FRITZBOX_CSV_PRIVATE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * CsvFritzboxColumn:
+ *
+ * Columns of a FRITZ!Box journal line
+ */
+typedef enum {
+	CSV_FRITZBOX_COLUMN_TYPE,
+	CSV_FRITZBOX_COLUMN_DATE_TIME,
+	CSV_FRITZBOX_COLUMN_REMOTE_NAME,
+	CSV_FRITZBOX_COLUMN_REMOTE_NUMBER,
+	CSV_FRITZBOX_COLUMN_LOCAL_NAME,
+	CSV_FRITZBOX_COLUMN_LOCAL_NUMBER,
+	CSV_FRITZBOX_COLUMN_DURATION,
+	CSV_FRITZBOX_COLUMN_MAX
+} CsvFritzboxColumn;
+
+/**
+ * CsvFritzboxDialect:
+ * @columns: field index of each #CsvFritzboxColumn
+ * @fields: number of fields of a line
+ *
+ * Column map of a journal header variant
+ */
+typedef struct {
+	guint columns[CSV_FRITZBOX_COLUMN_MAX];
+	guint fields;
+} CsvFritzboxDialect;
+
+extern const gchar * const csv_fritzbox_headers[];
+
+gboolean csv_fritzbox_dialect_init(CsvFritzboxDialect *dialect, const gchar *header);
+
+G_END_DECLS
+
+#endif
@@ -25,26 +25,131 @@
 #include <rm/rm.h>
 
 #include "csv.h"
+#include "csv-private.h"
 #include "firmware-common.h"
 
+/** Known journal header variants */
+const gchar * const csv_fritzbox_headers[] = {
+	CSV_FRITZBOX_JOURNAL_DE,
+	CSV_FRITZBOX_JOURNAL_EN,
+	CSV_FRITZBOX_JOURNAL_EN2,
+	CSV_FRITZBOX_JOURNAL_EN3,
+	NULL
+};
+
+/** Accepted header names of each #CsvFritzboxColumn, a name used twice is assigned in column order */
+static const gchar * const csv_fritzbox_column_names[CSV_FRITZBOX_COLUMN_MAX][5] = {
+	{ "Typ", "Type", NULL },
+	{ "Datum", "Date", NULL },
+	{ "Name", NULL },
+	{ "Rufnummer", "Number", "Telephone number", NULL },
+	{ "Nebenstelle", "Extension", NULL },
+	{ "Eigene Rufnummer", "Outgoing Caller ID", "Telephone Number", "Telephone number", NULL },
+	{ "Dauer", "Duration", NULL },
+};
+
+/** Column maps of csv_fritzbox_headers, derived once on first use */
+static CsvFritzboxDialect csv_fritzbox_dialects[G_N_ELEMENTS(csv_fritzbox_headers) - 1];
+
+/**
+ * CsvFritzboxContext:
+ * @journal: a #RmJournal
+ * @dialect: index of detected dialect
+ *
+ * Parser context
+ */
+typedef struct {
+	RmJournal *journal;
+	gint dialect;
+} CsvFritzboxContext;
+
+/**
+ * csv_fritzbox_dialect_init:
+ * @dialect: a #CsvFritzboxDialect to fill
+ * @header: header line
+ *
+ * Derive column map of @dialect from the field names of @header. Lines of an incomplete map are skipped.
+ *
+ * Returns: %TRUE if all columns have been found
+ */
+gboolean csv_fritzbox_dialect_init(CsvFritzboxDialect *dialect, const gchar *header)
+{
+	gchar **names = g_strsplit(header, ";", -1);
+	gboolean found[CSV_FRITZBOX_COLUMN_MAX] = { FALSE };
+	gboolean ret = TRUE;
+	guint field;
+	gint column;
+
+	dialect->fields = g_strv_length(names);
+
+	for (field = 0; field < dialect->fields; field++) {
+		for (column = 0; column < CSV_FRITZBOX_COLUMN_MAX; column++) {
+			if (!found[column] && g_strv_contains((const gchar * const *)csv_fritzbox_column_names[column], names[field])) {
+				dialect->columns[column] = field;
+				found[column] = TRUE;
+				break;
+			}
+		}
+	}
+
+	for (column = 0; column < CSV_FRITZBOX_COLUMN_MAX; column++) {
+		if (!found[column]) {
+			ret = FALSE;
+		}
+	}
+
+	/* Never match lines of an incomplete dialect */
+	if (!ret) {
+		g_warning("%s(): Header '%s' lacks columns", __FUNCTION__, header);
+		dialect->fields = G_MAXUINT;
+	}
+
+	g_strfreev(names);
+
+	return ret;
+}
+
+/**
+ * csv_fritzbox_dialects_init:
+ *
+ * Derive column maps of all known header variants once.
+ */
+static void csv_fritzbox_dialects_init(void)
+{
+	static gsize initialized = 0;
+
+	if (g_once_init_enter(&initialized)) {
+		guint idx;
+
+		for (idx = 0; idx < G_N_ELEMENTS(csv_fritzbox_dialects); idx++) {
+			csv_fritzbox_dialect_init(&csv_fritzbox_dialects[idx], csv_fritzbox_headers[idx]);
+		}
+
+		g_once_init_leave(&initialized, 1);
+	}
+}
+
 /**
  * csv_parse_fritzbox:
- * @ptr: pointer to journal
- * @split: splitted line
+ * @ptr: pointer to parser context
+ * @fields: fields of current line
+ * @count: number of fields
  *
  * Parse FRITZ!Box "Anruferliste"
  *
- * Returns: pointer to journal with attached call line
+ * Returns: pointer to parser context with attached call line
  */
-static inline gpointer csv_parse_fritzbox(gpointer ptr, gchar **split)
+static inline gpointer csv_parse_fritzbox(gpointer ptr, const RmCsvField *fields, guint count)
 {
-	GList *list = ptr;
+	CsvFritzboxContext *context = ptr;
+	const CsvFritzboxDialect *dialect = &csv_fritzbox_dialects[context->dialect];
+	const guint *columns = dialect->columns;
 
-	if (g_strv_length(split) == 7) {
+	if (count == dialect->fields) {
 		RmCallEntry *call;
 		gint call_type = 0;
 
-		switch (atoi(split[0])) {
+		switch (atoi(fields[columns[CSV_FRITZBOX_COLUMN_TYPE]].str)) {
 		case 1:
 			call_type = RM_CALL_ENTRY_TYPE_INCOMING;
 			break;
@@ -71,11 +176,18 @@ static inline gpointer csv_parse_fritzbox(gpointer ptr, gchar **split)
 			break;
 		}
 
-		call = rm_call_entry_new(call_type, split[1], split[2], split[3], split[4], split[5], split[6], NULL);
-		list = rm_journal_add_call_entry(list, call);
+		call = rm_call_entry_new(call_type,
+					 fields[columns[CSV_FRITZBOX_COLUMN_DATE_TIME]].str,
+					 fields[columns[CSV_FRITZBOX_COLUMN_REMOTE_NAME]].str,
+					 fields[columns[CSV_FRITZBOX_COLUMN_REMOTE_NUMBER]].str,
+					 fields[columns[CSV_FRITZBOX_COLUMN_LOCAL_NAME]].str,
+					 fields[columns[CSV_FRITZBOX_COLUMN_LOCAL_NUMBER]].str,
+					 fields[columns[CSV_FRITZBOX_COLUMN_DURATION]].str,
+					 NULL);
+		rm_journal_add(context->journal, call);
 	}
 
-	return list;
+	return context;
 }
 
 /**
@@ -83,29 +195,25 @@ static inline gpointer csv_parse_fritzbox(gpointer ptr, gchar **split)
  * @list: journal as list
  * @data: raw data to parse
  *
- * Parse journal data as csv
+ * Parse journal data as csv. The header dialect is detected once and the data is parsed in a single pass,
+ * fields are picked according to the column map derived from the header.
  *
  * Returns: call list
  */
 GList *csv_parse_fritzbox_journal_data(GList *list, const gchar *data)
 {
-	GList *new_list = NULL;
-
-	new_list = rm_csv_parse_data(data, CSV_FRITZBOX_JOURNAL_DE, csv_parse_fritzbox, list);
-	if (!new_list) {
-		new_list = rm_csv_parse_data(data, CSV_FRITZBOX_JOURNAL_EN, csv_parse_fritzbox, list);
-		if (!new_list) {
-			new_list = rm_csv_parse_data(data, CSV_FRITZBOX_JOURNAL_EN2, csv_parse_fritzbox, list);
-			if (!new_list) {
-				new_list = rm_csv_parse_data(data, CSV_FRITZBOX_JOURNAL_EN3, csv_parse_fritzbox, list);
-			}
-		}
-	}
+	CsvFritzboxContext context;
+
+	csv_fritzbox_dialects_init();
+
+	context.journal = rm_journal_new_from_list(list);
+	context.dialect = -1;
 
-	if (!new_list) {
+	if (!rm_csv_parse_data_full(data, csv_fritzbox_headers, &context.dialect, csv_parse_fritzbox, &context)) {
+		g_warning("%s(): Unknown journal dialect, data saved to log directory", __FUNCTION__);
 		rm_log_save_data("fritzbox-journal.csv", data, strlen(data));
 	}
 
 	/* Return call list */
-	return new_list;
+	return rm_journal_steal_list(context.journal);
 }
@@ -628,6 +628,7 @@ void fritzbox_journal_04_74_cb(SoupSession *session, SoupMessage *msg, gpointer
 {
 	GList *journal = NULL;
 	RmProfile *profile = user_data;
+	GError *error = NULL;
 
 	/* Parse journal */
 	journal = csv_parse_fritzbox_journal_data(journal, msg->response_body->data);
@@ -644,7 +645,13 @@ void fritzbox_journal_04_74_cb(SoupSession *session, SoupMessage *msg, gpointer
 	/* Load voice records */
 	journal = rm_router_load_voice_records(profile, journal);
 
-	rm_router_process_journal(journal);
+	/* Process journal list, the merged list is not needed here */
+	journal = rm_router_process_journal(journal, &error);
+	if (error) {
+		g_warning("%s(): Could not store journal: %s", __FUNCTION__, error->message);
+		g_error_free(error);
+	}
+	g_list_free_full(journal, rm_call_entry_free);
 
 	/* Logout */
 	fritzbox_logout(profile, FALSE);
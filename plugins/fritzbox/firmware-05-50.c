@@ -723,6 +723,7 @@ void fritzbox_journal_05_50_cb(SoupSession *session, SoupMessage *msg, gpointer
 {
 	GList *journal = NULL;
 	RmProfile *profile = user_data;
+	GError *error = NULL;
 
 	if (msg->status_code != SOUP_STATUS_OK) {
 		g_debug("%s(): Got invalid data, return code: %d", __FUNCTION__, msg->status_code);
@@ -744,8 +745,13 @@ void fritzbox_journal_05_50_cb(SoupSession *session, SoupMessage *msg, gpointer
 	/* Load voice records */
 	journal = rm_router_load_voice_records(profile, journal);
 
-	/* Process journal list */
-	rm_router_process_journal(journal);
+	/* Process journal list, the merged list is not needed here */
+	journal = rm_router_process_journal(journal, &error);
+	if (error) {
+		g_warning("%s(): Could not store journal: %s", __FUNCTION__, error->message);
+		g_error_free(error);
+	}
+	g_list_free_full(journal, rm_call_entry_free);
 
 	/* Logout */
 	rm_router_logout(profile);
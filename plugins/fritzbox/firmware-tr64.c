@@ -33,61 +33,54 @@
 #include "fritzbox.h"
 #include "firmware-common.h"
 #include "firmware-query.h"
+#include "calllist.h"
 
 /**
- * firmware_tr64_add_call:
- * @list: journal list
- * @profile: a #RmProfile
- * @call: xml master node of call element
+ * FirmwareTr64CallList:
  *
- * Add @call to journal @list
+ * State of a streamed call list
+ */
+typedef struct {
+	RmJournal *journal;
+	/* Call id watermark of previous refresh */
+	guint last_id;
+	/* Router returned ids at or below @last_id, e.g. after its call list has been reset */
+	gboolean id_reset;
+	/* Highest call id seen so far */
+	guint max_id;
+	/* Newest call timestamp seen so far */
+	gint64 max_timestamp;
+} FirmwareTr64CallList;
+
+/**
+ * firmware_tr64_add_call:
+ * @fields: text of call fields, see #CallListField
+ * @user_data: a #FirmwareTr64CallList
  *
- * Returns: Updated journal @list
+ * Add call to journal and update id/timestamp watermark
  */
-static GList *firmware_tr64_add_call(GList *list, RmProfile *profile, RmXmlNode *call)
+static void firmware_tr64_add_call(const gchar * const *fields, gpointer user_data)
 {
-	g_autofree gchar *type = NULL;
-	g_autofree gchar *port = NULL;
-	g_autofree gchar *date_time = NULL;
-	g_autofree gchar *duration = NULL;
-	g_autofree gchar *path = NULL;
-	g_autofree gchar *remote_name = NULL;
-	g_autofree gchar *remote_number = NULL;
-	g_autofree gchar *local_name = NULL;
-	g_autofree gchar *local_number = NULL;
-	RmXmlNode *tmp;
+	FirmwareTr64CallList *list = user_data;
+	const gchar *id = fields[CALLLIST_FIELD_ID];
+	const gchar *type = fields[CALLLIST_FIELD_TYPE];
+	const gchar *port = fields[CALLLIST_FIELD_PORT];
+	const gchar *path = fields[CALLLIST_FIELD_PATH];
+	const gchar *remote_number;
+	const gchar *local_number;
 	RmCallEntry *call_entry;
 	RmCallEntryTypes call_type;
 
-	tmp = rm_xmlnode_get_child(call, "Type");
-	type = rm_xmlnode_get_data(tmp);
-	tmp = rm_xmlnode_get_child(call, "Name");
-	remote_name = rm_xmlnode_get_data(tmp);
-	tmp = rm_xmlnode_get_child(call, "Duration");
-	duration = rm_xmlnode_get_data(tmp);
-	tmp = rm_xmlnode_get_child(call, "Date");
-	date_time = rm_xmlnode_get_data(tmp);
-	tmp = rm_xmlnode_get_child(call, "Device");
-	local_name = rm_xmlnode_get_data(tmp);
-	tmp = rm_xmlnode_get_child(call, "Path");
-	path = rm_xmlnode_get_data(tmp);
-	tmp = rm_xmlnode_get_child(call, "Port");
-	port = rm_xmlnode_get_data(tmp);
-
-	if (atoi(type) == 3) {
-		tmp = rm_xmlnode_get_child(call, "CallerNumber");
-		local_number = rm_xmlnode_get_data(tmp);
-		tmp = rm_xmlnode_get_child(call, "Called");
-		remote_number = rm_xmlnode_get_data(tmp);
+	call_type = type ? atoi(type) : 0;
+
+	if (call_type == 3) {
+		local_number = fields[CALLLIST_FIELD_CALLER_NUMBER];
+		remote_number = fields[CALLLIST_FIELD_CALLED];
 	} else {
-		tmp = rm_xmlnode_get_child(call, "CalledNumber");
-		local_number = rm_xmlnode_get_data(tmp);
-		tmp = rm_xmlnode_get_child(call, "Caller");
-		remote_number = rm_xmlnode_get_data(tmp);
+		local_number = fields[CALLLIST_FIELD_CALLED_NUMBER];
+		remote_number = fields[CALLLIST_FIELD_CALLER];
 	}
 
-	call_type = atoi(type);
-
 	if (call_type == 10) {
 		call_type = RM_CALL_ENTRY_TYPE_BLOCKED;
 	}
@@ -95,7 +88,6 @@ static GList *firmware_tr64_add_call(GList *list, RmProfile *profile, RmXmlNode
 	if (port && path) {
 		gint port_nr = atoi(port);
 
-
 		if (!RM_EMPTY_STRING(path)) {
 			g_debug("%s(): path %s, port %s", __FUNCTION__, path, port);
 		}
@@ -108,22 +100,61 @@ static GList *firmware_tr64_add_call(GList *list, RmProfile *profile, RmXmlNode
 		}
 	}
 
-	call_entry = rm_call_entry_new(call_type, date_time, remote_name, remote_number, local_name, local_number, duration, g_strdup(path));
-	list = rm_journal_add_call_entry(list, call_entry);
+	call_entry = rm_call_entry_new(call_type, fields[CALLLIST_FIELD_DATE], fields[CALLLIST_FIELD_NAME], remote_number, fields[CALLLIST_FIELD_DEVICE], local_number, fields[CALLLIST_FIELD_DURATION], g_strdup(path));
 
-	return list;
+	if (id) {
+		guint call_id = strtoul(id, NULL, 10);
+
+		if (call_id <= list->last_id) {
+			list->id_reset = TRUE;
+		}
+		list->max_id = MAX(list->max_id, call_id);
+	}
+	list->max_timestamp = MAX(list->max_timestamp, call_entry->timestamp);
+
+	rm_journal_add(list->journal, call_entry);
 }
 
 /**
- * firmware_tr64_journal_cb:
- * @session: a #SoupSession
- * @msg: a #SoupMessage
- * @user_data: a #RmProfile
+ * firmware_tr64_get_call_list_url:
+ * @profile: a #RmProfile
+ * @url: call list url as reported by router
  *
- * Get journal callback
+ * Restricts call list @url to calls which have not been ingested yet. The router reports all calls
+ * with an id greater than the stored one, older firmware without call ids is limited by days instead.
+ *
+ * Returns: call list url, free with g_free()
  */
-void firmware_tr64_journal_cb(SoupSession *session, SoupMessage *msg, gpointer user_data)
+static gchar *firmware_tr64_get_call_list_url(RmProfile *profile, const gchar *url)
 {
+	guint last_id;
+	gint64 last_timestamp;
+
+	/* Without local journal store we need the complete list again */
+	if (!rm_journal_has_store(profile)) {
+		g_settings_set_uint(fritzbox_settings, "journal-call-id", 0);
+		g_settings_set_int64(fritzbox_settings, "journal-call-timestamp", 0);
+
+		return g_strdup(url);
+	}
+
+	last_id = g_settings_get_uint(fritzbox_settings, "journal-call-id");
+	if (last_id) {
+		return g_strdup_printf("%s&id=%u", url, last_id);
+	}
+
+	last_timestamp = g_settings_get_int64(fritzbox_settings, "journal-call-timestamp");
+	if (last_timestamp) {
+		g_autoptr(GDateTime) now = g_date_time_new_now_local();
+		/* Call timestamps are local wall-clock time */
+		gint64 local_now = g_date_time_to_unix(now) + g_date_time_get_utc_offset(now) / G_USEC_PER_SEC;
+		gint64 days = MAX(0, local_now - last_timestamp) / 86400;
+
+		/* Include the day of the newest call and allow for clock skew */
+		return g_strdup_printf("%s&days=%" G_GINT64_FORMAT, url, days + 2);
+	}
+
+	return g_strdup(url);
 }
 
 /**
@@ -139,9 +170,11 @@ GList *firmware_tr64_load_journal(RmProfile *profile)
 	g_autoptr (SoupMessage) url_msg = NULL;
 	g_autoptr (SoupMessage) msg = NULL;
 	g_autofree char *url = NULL;
-	guint status;
+	g_autofree char *list_url = NULL;
+	g_autoptr (GInputStream) stream = NULL;
+	g_autoptr (GError) error = NULL;
+	FirmwareTr64CallList list;
 	GList *journal = NULL;
-	RmXmlNode *child;
 
 	url_msg = rm_network_tr64_request(profile, TRUE, "x_contact", "GetCallList", "urn:dslforum-org:service:X_AVM-DE_OnTel:1", NULL);
 	if (url_msg == NULL)
@@ -153,26 +186,36 @@ GList *firmware_tr64_load_journal(RmProfile *profile)
 
 	rm_log_save_data("tr64-getcalllist.xml", url_msg->response_body->data, url_msg->response_body->length);
 
-	msg = soup_message_new(SOUP_METHOD_GET, url);
+	list_url = firmware_tr64_get_call_list_url(profile, url);
+	g_debug("%s(): Requesting %s", __FUNCTION__, list_url);
+
+	msg = soup_message_new(SOUP_METHOD_GET, list_url);
 
-	status = soup_session_send_message(rm_soup_session, msg);
+	/* Parse list while it is received instead of buffering the whole document */
+	stream = soup_session_send(rm_soup_session, msg, NULL, &error);
+	if (!stream) {
+		g_debug("%s(): Could not request call list: %s", __FUNCTION__, error->message);
+		return journal;
+	}
 
-	if (status != SOUP_STATUS_OK) {
+	if (msg->status_code != SOUP_STATUS_OK) {
 		g_debug("%s(): Got invalid data, return code: %d (%s)", __FUNCTION__, msg->status_code, soup_status_get_phrase(msg->status_code));
 		return journal;
 	}
 
-	rm_log_save_data("tr64-callist.xml", msg->response_body->data, msg->response_body->length);
+	list.journal = rm_journal_new();
+	list.last_id = g_settings_get_uint(fritzbox_settings, "journal-call-id");
+	list.id_reset = FALSE;
+	list.max_id = 0;
+	list.max_timestamp = g_settings_get_int64(fritzbox_settings, "journal-call-timestamp");
 
-	RmXmlNode *node = rm_xmlnode_from_str(msg->response_body->data, msg->response_body->length);
-	if (node == NULL)
+	if (!calllist_parse_stream(stream, firmware_tr64_add_call, &list, NULL, &error)) {
+		g_debug("%s(): Could not parse call list: %s", __FUNCTION__, error->message);
+		rm_journal_destroy(list.journal);
 		return journal;
-
-	for (child = rm_xmlnode_get_child(node, "Call"); child != NULL; child = rm_xmlnode_get_next_twin(child)) {
-		journal = firmware_tr64_add_call(journal, profile, child);
 	}
 
-	rm_xmlnode_free(node);
+	journal = rm_journal_steal_list(list.journal);
 
 	/* Load fax reports */
 	journal = rm_router_load_fax_reports(profile, journal);
@@ -180,8 +223,24 @@ GList *firmware_tr64_load_journal(RmProfile *profile)
 	/* Load voice records */
 	journal = rm_router_load_voice_records(profile, journal);
 
-	/* Process journal list */
-	rm_router_process_journal(journal);
+	/* Process journal list, merges delta into local journal store */
+	journal = rm_router_process_journal(journal, &error);
+	if (error) {
+		/* Keep watermark, so the delta is requested again on next refresh */
+		g_warning("%s(): Could not store journal: %s", __FUNCTION__, error->message);
+		return journal;
+	}
+
+	if (list.id_reset) {
+		g_debug("%s(): Router returned call ids at or below watermark %u, resetting it to %u", __FUNCTION__, list.last_id, list.max_id);
+	} else if (!list.max_id) {
+		/* No new calls */
+		list.max_id = list.last_id;
+	}
+
+	/* Delta is persisted now, move watermark */
+	g_settings_set_uint(fritzbox_settings, "journal-call-id", list.max_id);
+	g_settings_set_int64(fritzbox_settings, "journal-call-timestamp", list.max_timestamp);
 
 	return journal;
 }
@@ -143,7 +143,7 @@ gboolean fritzbox_get_settings(RmProfile *profile)
  *
  * Main load journal function (big switch for each supported router)
  *
- * Returns: %TRUE when journal is loaded, %FALSE otherwise
+ * Returns: merged journal list or %NULL on error
  */
 GList *fritzbox_load_journal(RmProfile *profile)
 {
@@ -206,7 +206,7 @@ static void contact_add(RmProfile *profile, RmXmlNode *node, gint count)
 	RmContact *contact;
 	struct fritzfon_priv *priv;
 
-	contact = g_slice_new0(RmContact);
+	contact = rm_contact_new();
 	priv = g_slice_new0(struct fritzfon_priv);
 	contact->priv = priv;
 
@@ -290,7 +290,7 @@ static gint fritzfon_read_book_ftp(void)
 	}
 #endif
 
-	node = rm_xmlnode_from_str(data, read);
+	node = rm_xmlnode_from_str_full(data, read, RM_XMLNODE_PARSE_ARENA | RM_XMLNODE_PARSE_INDEX);
 	if (node == NULL) {
 		g_object_unref(msg);
 		return -1;
@@ -346,7 +346,7 @@ static gint fritzfon_read_book_tr64(void)
 
 	rm_log_save_data("fritzfon-phonebook.html", msg->response_body->data, msg->response_body->length);
 
-	node = rm_xmlnode_from_str(msg->response_body->data, msg->response_body->length);
+	node = rm_xmlnode_from_str_full(msg->response_body->data, msg->response_body->length, RM_XMLNODE_PARSE_ARENA | RM_XMLNODE_PARSE_INDEX);
 	if (node == NULL) {
 		g_debug("%s(): Could not parse xml node, abort...", __FUNCTION__);
 		return -1;
@@ -665,15 +665,99 @@ RmXmlNode *phonebook_to_xmlnode(void)
 	return node;
 }
 
+/**
+ * FritzFonUpload:
+ *
+ * Phonebook upload state, the request body is produced chunk by chunk while it is sent
+ */
+typedef struct {
+	RmXmlNode *node;
+	RmXmlWriter *writer;
+	GString *head;
+	gchar *tail;
+} FritzFonUpload;
+
+/**
+ * fritzfon_upload_part:
+ * @body: multipart body
+ * @boundary: multipart boundary
+ * @name: form field name
+ * @value: form field value
+ *
+ * Append form field @name to @body
+ */
+static void fritzfon_upload_part(GString *body, const gchar *boundary, const gchar *name, const gchar *value)
+{
+	g_string_append_printf(body, "--%s\r\nContent-Disposition: form-data; name=\"%s\"\r\n\r\n%s\r\n", boundary, name, value);
+}
+
+/**
+ * fritzfon_upload_next_cb:
+ * @msg: a #SoupMessage
+ * @user_data: a #FritzFonUpload
+ *
+ * Append next chunk of phonebook once previous one has been written. The synchronous send loop
+ * picks it up right away, so the message never runs out of data and does not need to be unpaused.
+ */
+static void fritzfon_upload_next_cb(SoupMessage *msg, gpointer user_data)
+{
+	FritzFonUpload *upload = user_data;
+	const gchar *data;
+	gsize len;
+
+	if (!upload->writer) {
+		return;
+	}
+
+	if (rm_xml_writer_next(upload->writer, &data, &len)) {
+		soup_message_body_append(msg->request_body, SOUP_MEMORY_COPY, data, len);
+	} else {
+		rm_xml_writer_free(upload->writer);
+		upload->writer = NULL;
+
+		soup_message_body_append(msg->request_body, SOUP_MEMORY_COPY, upload->tail, strlen(upload->tail));
+		soup_message_body_complete(msg->request_body);
+	}
+}
+
+/**
+ * fritzfon_upload_start:
+ * @msg: a #SoupMessage
+ * @user_data: a #FritzFonUpload
+ *
+ * Start request body with multipart head and a fresh phonebook writer. Written chunks are
+ * discarded, so the body is rebuilt whenever the message is restarted (e.g. on redirects).
+ */
+static void fritzfon_upload_start(SoupMessage *msg, gpointer user_data)
+{
+	FritzFonUpload *upload = user_data;
+
+	if (upload->writer) {
+		rm_xml_writer_free(upload->writer);
+	}
+	upload->writer = rm_xml_writer_new(upload->node);
+
+	soup_message_body_truncate(msg->request_body);
+	soup_message_body_append(msg->request_body, SOUP_MEMORY_COPY, upload->head->str, upload->head->len);
+}
+
 gboolean fritzfon_save(void)
 {
 	RmXmlNode *node;
 	RmProfile *profile = rm_profile_get_active();
-	gchar *data;
-	gint len;
-	SoupBuffer *buffer;
+	g_autofree gchar *owner = NULL;
+	g_autofree gchar *boundary = NULL;
+	g_autofree gchar *url = NULL;
+	GHashTable *params;
+	FritzFonUpload upload;
+	RmXmlWriter *writer;
+	SoupMessage *msg;
+	const gchar *data;
+	gsize xml_len = 0;
+	gsize len;
 
-	if (strlen(g_settings_get_string(fritzfon_settings, "book-owner")) > 2) {
+	owner = g_settings_get_string(fritzfon_settings, "book-owner");
+	if (strlen(owner) > 2) {
 		g_warning("Cannot save online address books");
 		return FALSE;
 	}
@@ -684,31 +768,49 @@ gboolean fritzfon_save(void)
 
 	node = phonebook_to_xmlnode();
 
-	data = rm_xmlnode_to_formatted_str(node, &len);
-#ifdef FRITZFON_DEBUG
-	gchar *file;
-	g_debug("len: %d", len);
-	file = g_strdup("/tmp/test.xml");
-	if (len > 0) {
-		rm_file_save(file, data, len);
+	/* Measure document first, router expects a content length */
+	writer = rm_xml_writer_new(node);
+	while (rm_xml_writer_next(writer, &data, &len)) {
+		xml_len += len;
 	}
-	g_free(file);
-#endif
-//	return FALSE;
+	rm_xml_writer_free(writer);
 
-	buffer = soup_buffer_new(SOUP_MEMORY_TAKE, data, len);
+	/* Build multipart framing around the streamed phonebook */
+	boundary = g_strdup_printf("rm-%08x%08x", g_random_int(), g_random_int());
+	upload.node = node;
+	upload.writer = NULL;
+	upload.head = g_string_new(NULL);
+	fritzfon_upload_part(upload.head, boundary, "sid", profile->router_info->session_id);
+	fritzfon_upload_part(upload.head, boundary, "PhonebookId", owner);
+	g_string_append_printf(upload.head, "--%s\r\nContent-Disposition: form-data; name=\"PhonebookImportFile\"; filename=\"dummy\"\r\nContent-Type: text/xml\r\n\r\n", boundary);
+	upload.tail = g_strdup_printf("\r\n--%s--\r\n", boundary);
 
 	/* Create POST message */
-	gchar *url = g_strdup_printf("http://%s/cgi-bin/firmwarecfg", rm_router_get_host(profile));
-	SoupMultipart *multipart = soup_multipart_new(SOUP_FORM_MIME_TYPE_MULTIPART);
-	soup_multipart_append_form_string(multipart, "sid", profile->router_info->session_id);
-	soup_multipart_append_form_string(multipart, "PhonebookId", g_settings_get_string(fritzfon_settings, "book-owner"));
-	soup_multipart_append_form_file(multipart, "PhonebookImportFile", "dummy", "text/xml", buffer);
-	SoupMessage *msg = soup_form_request_new_from_multipart(url, multipart);
+	url = g_strdup_printf("http://%s/cgi-bin/firmwarecfg", rm_router_get_host(profile));
+	msg = soup_message_new(SOUP_METHOD_POST, url);
+
+	params = g_hash_table_new(g_str_hash, g_str_equal);
+	g_hash_table_insert(params, "boundary", boundary);
+	soup_message_headers_set_content_type(msg->request_headers, SOUP_FORM_MIME_TYPE_MULTIPART, params);
+	g_hash_table_destroy(params);
+
+	soup_message_headers_set_content_length(msg->request_headers, upload.head->len + xml_len + strlen(upload.tail));
+	soup_message_body_set_accumulate(msg->request_body, FALSE);
+	soup_message_set_flags(msg, soup_message_get_flags(msg) | SOUP_MESSAGE_CAN_REBUILD);
+
+	fritzfon_upload_start(msg, &upload);
+
+	g_signal_connect(msg, "wrote-chunk", G_CALLBACK(fritzfon_upload_next_cb), &upload);
+	g_signal_connect(msg, "restarted", G_CALLBACK(fritzfon_upload_start), &upload);
 
 	soup_session_send_message(rm_soup_session, msg);
-	soup_buffer_free(buffer);
-	g_free(url);
+
+	if (upload.writer) {
+		rm_xml_writer_free(upload.writer);
+	}
+	g_string_free(upload.head, TRUE);
+	g_free(upload.tail);
+	rm_xmlnode_free(node);
 
 	if (msg->status_code != 200) {
 		g_warning("Could not send phonebook");
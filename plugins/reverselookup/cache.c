@@ -0,0 +1,637 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <rm/rm.h>
+
+#include "cache.h"
+
+/*
+ * Cache file layout (host byte order):
+ *  - RmLookupCacheHeader
+ *  - index: header.buckets * RmLookupCacheSlot, open addressing with linear probing
+ *  - record heap: gint64 timestamp followed by number, name, street, zip and city as NUL-terminated strings
+ *
+ * The file is mapped read-only and only records which are looked up are touched. Inserts append the
+ * record to the heap and update its index slot in place, replaced records become stale. The file is only
+ * rewritten (compacted, dropping stale and expired records) once the index exceeds its load factor or
+ * too many records are stale.
+ */
+
+#define REVERSELOOKUP_CACHE_MAGIC "RMRLC01"
+#define REVERSELOOKUP_CACHE_VERSION 1
+#define REVERSELOOKUP_CACHE_FIELDS 5
+#define REVERSELOOKUP_CACHE_MIN_BUCKETS 16
+/** Minimum number of stale records before the file is compacted */
+#define REVERSELOOKUP_CACHE_COMPACT_MIN 64
+
+/**
+ * RmLookupCacheHeader:
+ *
+ * Cache file header
+ */
+typedef struct {
+	gchar magic[8];
+	guint32 version;
+	guint32 buckets;
+	guint32 entries;
+	/* Replaced records still in the heap */
+	guint32 stale;
+} RmLookupCacheHeader;
+
+/**
+ * RmLookupCacheSlot:
+ *
+ * Cache index slot, offset 0 marks an empty slot
+ */
+typedef struct {
+	guint32 hash;
+	guint32 offset;
+} RmLookupCacheSlot;
+
+/**
+ * RmLookupCacheRecord:
+ *
+ * Decoded record pointing into the mapped file
+ */
+typedef struct {
+	gint64 timestamp;
+	const gchar *fields[REVERSELOOKUP_CACHE_FIELDS];
+} RmLookupCacheRecord;
+
+/**
+ * RmLookupCache:
+ *
+ * The #RmLookupCache-struct contains only private fileds and should not be directly accessed.
+ */
+struct RmLookupCache {
+	/*< private >*/
+	GMutex lock;
+	gchar *file_name;
+	GMappedFile *map;
+	const gchar *data;
+	gsize len;
+	guint32 buckets;
+};
+
+/**
+ * reverselookup_cache_hash:
+ * @number: phone number
+ *
+ * FNV-1a hash of @number, stable across library versions.
+ *
+ * Returns: hash value
+ */
+static guint32 reverselookup_cache_hash(const gchar *number)
+{
+	guint32 hash = 2166136261u;
+
+	for (; *number; number++) {
+		hash ^= (guchar)*number;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/**
+ * reverselookup_cache_map:
+ * @cache: a #RmLookupCache
+ *
+ * (Re-)Map cache file. Missing or invalid files result in an empty cache.
+ */
+static void reverselookup_cache_map(RmLookupCache *cache)
+{
+	RmLookupCacheHeader header;
+	GMappedFile *map;
+	gsize len;
+
+	g_clear_pointer(&cache->map, g_mapped_file_unref);
+	cache->data = NULL;
+	cache->len = 0;
+	cache->buckets = 0;
+
+	map = g_mapped_file_new(cache->file_name, FALSE, NULL);
+	if (!map) {
+		return;
+	}
+
+	len = g_mapped_file_get_length(map);
+	if (len < sizeof(header)) {
+		g_warning("%s(): Cache file too short, ignoring", __FUNCTION__);
+		g_mapped_file_unref(map);
+		return;
+	}
+
+	memcpy(&header, g_mapped_file_get_contents(map), sizeof(header));
+	if (memcmp(header.magic, REVERSELOOKUP_CACHE_MAGIC, sizeof(header.magic)) || header.version != REVERSELOOKUP_CACHE_VERSION ||
+	    !header.buckets || (header.buckets & (header.buckets - 1)) || sizeof(header) + (gsize)header.buckets * sizeof(RmLookupCacheSlot) > len) {
+		g_warning("%s(): Invalid cache file, ignoring", __FUNCTION__);
+		g_mapped_file_unref(map);
+		return;
+	}
+
+	cache->map = map;
+	cache->data = g_mapped_file_get_contents(map);
+	cache->len = len;
+	cache->buckets = header.buckets;
+
+	g_debug("%s(): %u entries, %u stale", __FUNCTION__, header.entries, header.stale);
+}
+
+/**
+ * reverselookup_cache_get_slot:
+ * @cache: a #RmLookupCache
+ * @index: slot index
+ * @slot: pointer to store slot in
+ */
+static void reverselookup_cache_get_slot(RmLookupCache *cache, guint32 index, RmLookupCacheSlot *slot)
+{
+	memcpy(slot, cache->data + sizeof(RmLookupCacheHeader) + index * sizeof(RmLookupCacheSlot), sizeof(RmLookupCacheSlot));
+}
+
+/**
+ * reverselookup_cache_get_record:
+ * @cache: a #RmLookupCache
+ * @offset: record offset
+ * @record: a #RmLookupCacheRecord to fill
+ *
+ * Decode record at @offset with bounds checking.
+ *
+ * Returns: %TRUE if record is valid
+ */
+static gboolean reverselookup_cache_get_record(RmLookupCache *cache, guint32 offset, RmLookupCacheRecord *record)
+{
+	const gchar *end = cache->data + cache->len;
+	const gchar *ptr;
+	gint idx;
+
+	if (offset < sizeof(RmLookupCacheHeader) + cache->buckets * sizeof(RmLookupCacheSlot) || offset + sizeof(gint64) > cache->len) {
+		return FALSE;
+	}
+
+	memcpy(&record->timestamp, cache->data + offset, sizeof(gint64));
+	ptr = cache->data + offset + sizeof(gint64);
+
+	for (idx = 0; idx < REVERSELOOKUP_CACHE_FIELDS; idx++) {
+		const gchar *nul = memchr(ptr, '\0', end - ptr);
+
+		if (!nul) {
+			return FALSE;
+		}
+
+		record->fields[idx] = ptr;
+		ptr = nul + 1;
+	}
+
+	return TRUE;
+}
+
+/**
+ * reverselookup_cache_probe:
+ * @cache: a #RmLookupCache
+ * @number: phone number
+ * @bucket: pointer to store slot index in
+ * @record: a #RmLookupCacheRecord to fill
+ *
+ * Probe index for @number. @bucket is set to the slot of @number, or to the empty slot ending the probe
+ * sequence if @number is not cached. A full index results in @bucket being the number of buckets.
+ *
+ * Returns: %TRUE if @number has been found
+ */
+static gboolean reverselookup_cache_probe(RmLookupCache *cache, const gchar *number, guint32 *bucket, RmLookupCacheRecord *record)
+{
+	guint32 hash = reverselookup_cache_hash(number);
+	guint32 probe;
+
+	*bucket = hash & (cache->buckets - 1);
+	for (probe = 0; probe < cache->buckets; probe++, *bucket = (*bucket + 1) & (cache->buckets - 1)) {
+		RmLookupCacheSlot slot;
+
+		reverselookup_cache_get_slot(cache, *bucket, &slot);
+		if (!slot.offset) {
+			return FALSE;
+		}
+
+		if (slot.hash == hash && reverselookup_cache_get_record(cache, slot.offset, record) && !strcmp(record->fields[0], number)) {
+			return TRUE;
+		}
+	}
+
+	*bucket = cache->buckets;
+
+	return FALSE;
+}
+
+/**
+ * reverselookup_cache_encode:
+ * @heap: record heap
+ * @timestamp: record timestamp
+ * @fields: record fields
+ *
+ * Append encoded record to @heap.
+ */
+static void reverselookup_cache_encode(GByteArray *heap, gint64 timestamp, const gchar **fields)
+{
+	gint idx;
+
+	g_byte_array_append(heap, (guint8*)&timestamp, sizeof(timestamp));
+	for (idx = 0; idx < REVERSELOOKUP_CACHE_FIELDS; idx++) {
+		const gchar *field = fields[idx] ? fields[idx] : "";
+
+		g_byte_array_append(heap, (guint8*)field, strlen(field) + 1);
+	}
+}
+
+/**
+ * reverselookup_cache_append:
+ * @heap: record heap
+ * @slots: array of #RmLookupCacheSlot with heap relative offsets
+ * @timestamp: record timestamp
+ * @fields: record fields
+ *
+ * Append a record to the heap of a new cache file.
+ */
+static void reverselookup_cache_append(GByteArray *heap, GArray *slots, gint64 timestamp, const gchar **fields)
+{
+	RmLookupCacheSlot slot;
+
+	slot.hash = reverselookup_cache_hash(fields[0]);
+	slot.offset = heap->len;
+	g_array_append_val(slots, slot);
+
+	reverselookup_cache_encode(heap, timestamp, fields);
+}
+
+/**
+ * reverselookup_cache_write:
+ * @cache: a #RmLookupCache
+ * @updates: number -> #RmContact to add or replace
+ *
+ * Rewrite cache file with all valid records and @updates, stale and expired records are dropped (compaction).
+ * Must be called with cache lock held.
+ *
+ * Returns: %TRUE if cache file has been saved
+ */
+static gboolean reverselookup_cache_write(RmLookupCache *cache, GHashTable *updates)
+{
+	RmLookupCacheHeader header;
+	GByteArray *heap = g_byte_array_new();
+	GArray *slots = g_array_new(FALSE, FALSE, sizeof(RmLookupCacheSlot));
+	GByteArray *file;
+	GHashTableIter iter;
+	GError *error = NULL;
+	gpointer key;
+	gpointer value;
+	gboolean ret = FALSE;
+	gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+	gsize heap_start;
+	guint32 buckets = REVERSELOOKUP_CACHE_MIN_BUCKETS;
+	guint32 idx;
+
+	/* Keep still valid records of current file */
+	for (idx = 0; idx < cache->buckets; idx++) {
+		RmLookupCacheRecord record;
+		RmLookupCacheSlot slot;
+
+		reverselookup_cache_get_slot(cache, idx, &slot);
+		if (!slot.offset || !reverselookup_cache_get_record(cache, slot.offset, &record)) {
+			continue;
+		}
+
+		if (now - record.timestamp > REVERSELOOKUP_CACHE_TTL || g_hash_table_contains(updates, record.fields[0])) {
+			continue;
+		}
+
+		reverselookup_cache_append(heap, slots, record.timestamp, record.fields);
+	}
+
+	g_hash_table_iter_init(&iter, updates);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		RmContact *contact = value;
+		const gchar *fields[REVERSELOOKUP_CACHE_FIELDS] = { key, contact->name, contact->street, contact->zip, contact->city };
+
+		reverselookup_cache_append(heap, slots, now, fields);
+	}
+
+	while (buckets < slots->len * 2) {
+		buckets <<= 1;
+	}
+
+	heap_start = sizeof(header) + buckets * sizeof(RmLookupCacheSlot);
+	if (heap_start + heap->len > G_MAXUINT32) {
+		g_warning("%s(): Cache too large, not saving", __FUNCTION__);
+		goto end;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, REVERSELOOKUP_CACHE_MAGIC, sizeof(header.magic));
+	header.version = REVERSELOOKUP_CACHE_VERSION;
+	header.buckets = buckets;
+	header.entries = slots->len;
+
+	file = g_byte_array_sized_new(heap_start + heap->len);
+	g_byte_array_append(file, (guint8*)&header, sizeof(header));
+	g_byte_array_set_size(file, heap_start);
+	memset(file->data + sizeof(header), 0, heap_start - sizeof(header));
+	g_byte_array_append(file, heap->data, heap->len);
+
+	for (idx = 0; idx < slots->len; idx++) {
+		RmLookupCacheSlot slot = g_array_index(slots, RmLookupCacheSlot, idx);
+		guint32 bucket = slot.hash & (buckets - 1);
+		RmLookupCacheSlot *index = (RmLookupCacheSlot*)(file->data + sizeof(header));
+
+		while (index[bucket].offset) {
+			bucket = (bucket + 1) & (buckets - 1);
+		}
+
+		index[bucket].hash = slot.hash;
+		index[bucket].offset = heap_start + slot.offset;
+	}
+
+	/* Release mapping before replacing the file */
+	g_clear_pointer(&cache->map, g_mapped_file_unref);
+	cache->buckets = 0;
+
+	ret = rm_file_save_full(cache->file_name, (gchar*)file->data, file->len, &error);
+	if (!ret) {
+		g_warning("%s(): Could not save cache: %s", __FUNCTION__, error->message);
+		g_error_free(error);
+	}
+	g_byte_array_free(file, TRUE);
+
+	reverselookup_cache_map(cache);
+
+end:
+	g_array_free(slots, TRUE);
+	g_byte_array_free(heap, TRUE);
+
+	return ret;
+}
+
+/**
+ * reverselookup_cache_update:
+ * @cache: a #RmLookupCache
+ * @number: phone number
+ * @contact: a #RmContact with lookup result
+ *
+ * Add or replace @number in place: append record to the heap, then update index slot and header.
+ * Must be called with cache lock held.
+ *
+ * Returns: %TRUE on success, %FALSE if the file needs to be compacted instead
+ */
+static gboolean reverselookup_cache_update(RmLookupCache *cache, const gchar *number, RmContact *contact)
+{
+	const gchar *fields[REVERSELOOKUP_CACHE_FIELDS] = { number, contact->name, contact->street, contact->zip, contact->city };
+	RmLookupCacheHeader header;
+	RmLookupCacheRecord record;
+	RmLookupCacheSlot slot;
+	GFileIOStream *stream;
+	GOutputStream *output;
+	GByteArray *heap;
+	GError *error = NULL;
+	GFile *file;
+	guint32 bucket;
+	gboolean ret = FALSE;
+
+	if (!cache->map) {
+		return FALSE;
+	}
+
+	memcpy(&header, cache->data, sizeof(header));
+
+	if (reverselookup_cache_probe(cache, number, &bucket, &record)) {
+		header.stale++;
+	} else if (bucket == cache->buckets || (header.entries + 1) * 2 > cache->buckets) {
+		/* Keep load factor below 0.5 */
+		return FALSE;
+	} else {
+		header.entries++;
+	}
+
+	if (header.stale >= REVERSELOOKUP_CACHE_COMPACT_MIN && header.stale >= header.entries) {
+		return FALSE;
+	}
+
+	heap = g_byte_array_new();
+	reverselookup_cache_encode(heap, g_get_real_time() / G_USEC_PER_SEC, fields);
+
+	if (cache->len + heap->len > G_MAXUINT32) {
+		g_byte_array_free(heap, TRUE);
+		return FALSE;
+	}
+
+	slot.hash = reverselookup_cache_hash(number);
+	slot.offset = cache->len;
+
+	file = g_file_new_for_path(cache->file_name);
+	stream = g_file_open_readwrite(file, NULL, &error);
+	g_object_unref(file);
+
+	if (stream) {
+		output = g_io_stream_get_output_stream(G_IO_STREAM(stream));
+
+		/* Record first, so a partial update never references missing data */
+		ret = g_seekable_seek(G_SEEKABLE(stream), cache->len, G_SEEK_SET, NULL, &error) &&
+		      g_output_stream_write_all(output, heap->data, heap->len, NULL, NULL, &error) &&
+		      g_seekable_seek(G_SEEKABLE(stream), sizeof(header) + bucket * sizeof(slot), G_SEEK_SET, NULL, &error) &&
+		      g_output_stream_write_all(output, &slot, sizeof(slot), NULL, NULL, &error) &&
+		      g_seekable_seek(G_SEEKABLE(stream), 0, G_SEEK_SET, NULL, &error) &&
+		      g_output_stream_write_all(output, &header, sizeof(header), NULL, NULL, &error);
+
+		if (!g_io_stream_close(G_IO_STREAM(stream), NULL, ret ? &error : NULL)) {
+			ret = FALSE;
+		}
+		g_object_unref(stream);
+	}
+
+	if (!ret) {
+		g_warning("%s(): Could not update cache: %s", __FUNCTION__, error->message);
+		g_error_free(error);
+	}
+
+	g_byte_array_free(heap, TRUE);
+
+	/* Map appended data */
+	reverselookup_cache_map(cache);
+
+	return ret;
+}
+
+/**
+ * reverselookup_cache_open:
+ * @file_name: cache file name
+ *
+ * Open (map) reverse lookup cache file. The file is created on first insert.
+ *
+ * Returns: a #RmLookupCache, free with reverselookup_cache_free()
+ */
+RmLookupCache *reverselookup_cache_open(const gchar *file_name)
+{
+	RmLookupCache *cache = g_slice_new0(RmLookupCache);
+
+	g_mutex_init(&cache->lock);
+	cache->file_name = g_strdup(file_name);
+
+	reverselookup_cache_map(cache);
+
+	return cache;
+}
+
+/**
+ * reverselookup_cache_free:
+ * @cache: a #RmLookupCache
+ *
+ * Close and free @cache.
+ */
+void reverselookup_cache_free(RmLookupCache *cache)
+{
+	if (!cache) {
+		return;
+	}
+
+	g_clear_pointer(&cache->map, g_mapped_file_unref);
+	g_free(cache->file_name);
+	g_mutex_clear(&cache->lock);
+
+	g_slice_free(RmLookupCache, cache);
+}
+
+/**
+ * reverselookup_cache_lookup:
+ * @cache: a #RmLookupCache
+ * @number: phone number
+ *
+ * Lookup @number in cache. Expired records are ignored.
+ *
+ * Returns: a new #RmContact with name and address, or %NULL if not found
+ */
+RmContact *reverselookup_cache_lookup(RmLookupCache *cache, const gchar *number)
+{
+	RmLookupCacheRecord record;
+	RmContact *contact = NULL;
+	guint32 bucket;
+
+	g_mutex_lock(&cache->lock);
+
+	if (reverselookup_cache_probe(cache, number, &bucket, &record) && g_get_real_time() / G_USEC_PER_SEC - record.timestamp <= REVERSELOOKUP_CACHE_TTL) {
+		contact = rm_contact_new();
+		contact->name = g_strdup(record.fields[1]);
+		contact->street = g_strdup(record.fields[2]);
+		contact->zip = g_strdup(record.fields[3]);
+		contact->city = g_strdup(record.fields[4]);
+	}
+
+	g_mutex_unlock(&cache->lock);
+
+	return contact;
+}
+
+/**
+ * reverselookup_cache_insert:
+ * @cache: a #RmLookupCache
+ * @number: phone number
+ * @contact: a #RmContact with lookup result
+ *
+ * Add or replace lookup result of @number in cache file. The file is compacted if required.
+ */
+void reverselookup_cache_insert(RmLookupCache *cache, const gchar *number, RmContact *contact)
+{
+	g_mutex_lock(&cache->lock);
+
+	if (!reverselookup_cache_update(cache, number, contact)) {
+		GHashTable *updates = g_hash_table_new(g_str_hash, g_str_equal);
+
+		g_hash_table_insert(updates, (gpointer)number, contact);
+		reverselookup_cache_write(cache, updates);
+		g_hash_table_destroy(updates);
+	}
+
+	g_mutex_unlock(&cache->lock);
+}
+
+/**
+ * reverselookup_cache_import:
+ * @dir_name: directory of old one-file-per-number cache
+ *
+ * Import old cache directory into @cache and remove it afterwards.
+ */
+void reverselookup_cache_import(RmLookupCache *cache, const gchar *dir_name)
+{
+	GHashTable *updates;
+	GSList *files = NULL;
+	GSList *list;
+	const gchar *file_name;
+	GDir *dir;
+	gboolean saved;
+
+	dir = g_dir_open(dir_name, 0, NULL);
+	if (!dir) {
+		return;
+	}
+
+	updates = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)rm_contact_free);
+
+	while ((file_name = g_dir_read_name(dir))) {
+		gchar *uri = g_build_filename(dir_name, file_name, NULL);
+		gchar *data = rm_file_load(uri, NULL);
+
+		if (data) {
+			gchar **split = g_strsplit(data, ";", -1);
+
+			if (g_strv_length(split) >= REVERSELOOKUP_CACHE_FIELDS) {
+				RmContact *contact = rm_contact_new();
+
+				contact->name = g_strdup(split[1]);
+				contact->street = g_strdup(split[2]);
+				contact->zip = g_strdup(split[3]);
+				contact->city = g_strstrip(g_strdup(split[4]));
+
+				g_hash_table_insert(updates, g_strdup(split[0]), contact);
+			}
+
+			g_strfreev(split);
+			g_free(data);
+		}
+
+		files = g_slist_prepend(files, uri);
+	}
+	g_dir_close(dir);
+
+	g_debug("%s(): Importing %u entries", __FUNCTION__, g_hash_table_size(updates));
+
+	g_mutex_lock(&cache->lock);
+	saved = reverselookup_cache_write(cache, updates);
+	g_mutex_unlock(&cache->lock);
+
+	/* Remove old cache once it has been imported */
+	if (saved) {
+		for (list = files; list != NULL; list = list->next) {
+			g_remove(list->data);
+		}
+		g_rmdir(dir_name);
+	}
+
+	g_slist_free_full(files, g_free);
+	g_hash_table_destroy(updates);
+}
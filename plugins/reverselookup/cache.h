@@ -0,0 +1,42 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef REVERSELOOKUP_CACHE_H
+#define REVERSELOOKUP_CACHE_H
+
+#include <glib.h>
+
+#include <rm/rm.h>
+
+G_BEGIN_DECLS
+
+/** Seconds a cached lookup result stays valid */
+#define REVERSELOOKUP_CACHE_TTL (90 * 24 * 60 * 60)
+
+typedef struct RmLookupCache RmLookupCache;
+
+RmLookupCache *reverselookup_cache_open(const gchar *file_name);
+void reverselookup_cache_free(RmLookupCache *cache);
+RmContact *reverselookup_cache_lookup(RmLookupCache *cache, const gchar *number);
+void reverselookup_cache_insert(RmLookupCache *cache, const gchar *number, RmContact *contact);
+void reverselookup_cache_import(RmLookupCache *cache, const gchar *dir_name);
+
+G_END_DECLS
+
+#endif
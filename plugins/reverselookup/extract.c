@@ -0,0 +1,216 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <libxml/HTMLparser.h>
+
+#include "extract.h"
+
+/** Size of chunks fed into the HTML push parser */
+#define REVERSELOOKUP_EXTRACT_CHUNK_SIZE 4096
+
+/**
+ * RmLookupExtract:
+ *
+ * SAX extraction state
+ */
+typedef struct {
+	gchar ***patterns;
+	htmlParserCtxtPtr ctxt;
+	/* Current element depth */
+	gint depth;
+	/* Depth of capturing element per field, 0 if not yet found and -1 if done */
+	gint capture[REVERSELOOKUP_FIELD_MAX];
+	GString *text[REVERSELOOKUP_FIELD_MAX];
+	/* Number of fields still missing */
+	gint missing;
+} RmLookupExtract;
+
+/**
+ * reverselookup_extract_start_element:
+ * @ctx: a #RmLookupExtract
+ * @name: element name
+ * @atts: attribute name/value pairs
+ *
+ * Start capturing every missing field whose element and attribute matches.
+ */
+static void reverselookup_extract_start_element(void *ctx, const xmlChar *name, const xmlChar **atts)
+{
+	RmLookupExtract *extract = ctx;
+	gint field;
+
+	extract->depth++;
+
+	for (field = 0; field < REVERSELOOKUP_FIELD_MAX; field++) {
+		gchar **pattern = extract->patterns[field];
+		gint idx;
+
+		if (!pattern || !pattern[1] || !pattern[2] || extract->capture[field] || strcmp((const gchar*)name, pattern[0])) {
+			continue;
+		}
+
+		for (idx = 0; atts && atts[idx]; idx += 2) {
+			if (atts[idx + 1] && !strcmp((const gchar*)atts[idx], pattern[1]) && !strcmp((const gchar*)atts[idx + 1], pattern[2])) {
+				extract->capture[field] = extract->depth;
+				extract->text[field] = g_string_new(NULL);
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * reverselookup_extract_end_element:
+ * @ctx: a #RmLookupExtract
+ * @name: element name
+ *
+ * Finish captures of closed element and stop parser once all fields are found.
+ */
+static void reverselookup_extract_end_element(void *ctx, const xmlChar *name)
+{
+	RmLookupExtract *extract = ctx;
+	gint field;
+
+	for (field = 0; field < REVERSELOOKUP_FIELD_MAX; field++) {
+		if (extract->capture[field] == extract->depth) {
+			extract->capture[field] = -1;
+			extract->missing--;
+		}
+	}
+
+	extract->depth--;
+
+	if (!extract->missing) {
+		xmlStopParser(extract->ctxt);
+	}
+}
+
+/**
+ * reverselookup_extract_characters:
+ * @ctx: a #RmLookupExtract
+ * @ch: character data
+ * @len: length of @ch
+ *
+ * Collect text which is a direct child of a capturing element.
+ */
+static void reverselookup_extract_characters(void *ctx, const xmlChar *ch, int len)
+{
+	RmLookupExtract *extract = ctx;
+	gint field;
+
+	for (field = 0; field < REVERSELOOKUP_FIELD_MAX; field++) {
+		if (extract->capture[field] > 0 && extract->capture[field] == extract->depth) {
+			g_string_append_len(extract->text[field], (const gchar*)ch, len);
+		}
+	}
+}
+
+/**
+ * reverselookup_extract_normalize:
+ * @text: captured text
+ *
+ * Collapse runs of spaces and strip leading/trailing whitespace.
+ *
+ * Returns: normalized text
+ */
+static gchar *reverselookup_extract_normalize(GString *text)
+{
+	gchar *str = g_string_free(text, FALSE);
+	gchar *out = str;
+	gchar *in;
+
+	for (in = str; *in; in++) {
+		if (*in == ' ' && out > str && out[-1] == ' ') {
+			continue;
+		}
+
+		*out++ = *in;
+	}
+	*out = '\0';
+
+	return g_strstrip(str);
+}
+
+/**
+ * reverselookup_extract:
+ * @patterns: per field element name, attribute name and attribute value, %NULL for unused fields
+ * @data: html data
+ * @len: length of @data
+ * @out: per field array to store extracted strings in (free with g_free())
+ *
+ * Extract all fields in a single streaming pass over @data. Text of the first element (in document order)
+ * matching a field pattern is used. Parsing stops as soon as all fields are found.
+ *
+ * Returns: %TRUE if all fields have been found
+ */
+gboolean reverselookup_extract(gchar **patterns[REVERSELOOKUP_FIELD_MAX], const gchar *data, gsize len, gchar *out[REVERSELOOKUP_FIELD_MAX])
+{
+	RmLookupExtract extract;
+	htmlSAXHandler sax;
+	gsize offset;
+	gint field;
+
+	memset(&extract, 0, sizeof(extract));
+	extract.patterns = patterns;
+
+	for (field = 0; field < REVERSELOOKUP_FIELD_MAX; field++) {
+		if (patterns[field]) {
+			extract.missing++;
+		}
+	}
+
+	memset(&sax, 0, sizeof(sax));
+	sax.startElement = reverselookup_extract_start_element;
+	sax.endElement = reverselookup_extract_end_element;
+	sax.characters = reverselookup_extract_characters;
+
+	extract.ctxt = htmlCreatePushParserCtxt(&sax, &extract, NULL, 0, NULL, XML_CHAR_ENCODING_UTF8);
+	if (!extract.ctxt) {
+		return FALSE;
+	}
+
+	htmlCtxtUseOptions(extract.ctxt, HTML_PARSE_NOBLANKS | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING | HTML_PARSE_NONET);
+
+	for (offset = 0; offset < len && extract.missing; offset += REVERSELOOKUP_EXTRACT_CHUNK_SIZE) {
+		gsize chunk = MIN(len - offset, REVERSELOOKUP_EXTRACT_CHUNK_SIZE);
+
+		htmlParseChunk(extract.ctxt, data + offset, chunk, 0);
+	}
+
+	if (extract.missing) {
+		htmlParseChunk(extract.ctxt, NULL, 0, 1);
+	}
+
+	htmlFreeParserCtxt(extract.ctxt);
+
+	for (field = 0; field < REVERSELOOKUP_FIELD_MAX; field++) {
+		if (extract.capture[field] == -1) {
+			out[field] = reverselookup_extract_normalize(extract.text[field]);
+		} else if (extract.text[field]) {
+			/* Document ended within element */
+			out[field] = reverselookup_extract_normalize(extract.text[field]);
+			extract.missing--;
+		}
+	}
+
+	return !extract.missing;
+}
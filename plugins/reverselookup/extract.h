@@ -0,0 +1,49 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef REVERSELOOKUP_EXTRACT_H
+#define REVERSELOOKUP_EXTRACT_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * RmLookupField:
+ * @REVERSELOOKUP_FIELD_NAME: contact name
+ * @REVERSELOOKUP_FIELD_STREET: street
+ * @REVERSELOOKUP_FIELD_CITY: city (optionally including zip)
+ * @REVERSELOOKUP_FIELD_ZIP: zip
+ * @REVERSELOOKUP_FIELD_MAX: number of fields
+ *
+ * Fields extracted out of a lookup result page
+ */
+typedef enum {
+	REVERSELOOKUP_FIELD_NAME,
+	REVERSELOOKUP_FIELD_STREET,
+	REVERSELOOKUP_FIELD_CITY,
+	REVERSELOOKUP_FIELD_ZIP,
+	REVERSELOOKUP_FIELD_MAX
+} RmLookupField;
+
+gboolean reverselookup_extract(gchar **patterns[REVERSELOOKUP_FIELD_MAX], const gchar *data, gsize len, gchar *out[REVERSELOOKUP_FIELD_MAX]);
+
+G_END_DECLS
+
+#endif
@@ -27,9 +27,8 @@
 
 #include <rm/rm.h>
 
-#include <libxml/HTMLparser.h>
-#include <libxml/tree.h>
-#include <libxml/parser.h>
+#include "cache.h"
+#include "extract.h"
 
 //#define RL_DEBUG 1
 
@@ -38,226 +37,560 @@ typedef struct {
 	GHashTable *table;
 } RmReverseLookupPlugin;
 
+/** Lookup results: number -> RmContact (empty name for unknown numbers) */
 static GHashTable *table = NULL;
+G_LOCK_DEFINE_STATIC(table);
+/** Persistent lookup results */
+static RmLookupCache *cache = NULL;
 /** Global lookup list */
 static GSList *lookup_list = NULL;
 /** Lookup country code hash table */
 static GHashTable *lookup_table = NULL;
 /** Lookup soup session */
 static SoupSession *rl_session = NULL;
+/** Worker running asynchronous lookups, keeps requests, parsing and cache I/O off the caller's context */
+static GThread *rl_thread = NULL;
+static GMainContext *rl_context = NULL;
+static GMainLoop *rl_loop = NULL;
 
 typedef struct _RmLookupEntry {
 	gboolean prefix;
 	gchar *service;
 	gchar *url;
+	/* Service url split at %NUMBER% */
+	gchar **url_parts;
 	gchar **name;
 	gchar **street;
 	gchar **zip;
 	gchar **city;
 	gint zip_len;
+
+	/* Service statistics, protected by services lock */
+	guint requests;
+	guint successes;
+	gint64 latency;
 } RmLookupEntry;
 
+G_LOCK_DEFINE_STATIC(services);
+
+/** Delay in ms after which the next service is queried in parallel */
+#define REVERSELOOKUP_HEDGE_DELAY 750
+
+/**
+ * RmLookupHedge:
+ *
+ * State of a hedged lookup of one number across all services of a country. It lives on the thread
+ * default context of the lookup.
+ */
+typedef struct {
+	GTask *task;
+	/* Services not queried yet, best first */
+	GSList *services;
+	gchar *number;
+	/* Running requests */
+	GList *requests;
+	/* Requests are being cancelled, completion is up to the canceller */
+	gboolean busy;
+	/* First successful result */
+	RmContact *result;
+	/* Hedge delay timer */
+	GSource *timer;
+	/* Cancellation of the lookup, %NULL if not cancellable */
+	GSource *cancel_source;
+} RmLookupHedge;
+
+/**
+ * RmLookupRequest:
+ *
+ * A single running service request of a hedged lookup.
+ */
+typedef struct {
+	RmLookupHedge *hedge;
+	RmLookupEntry *lookup;
+	SoupMessage *msg;
+	gint64 start;
+} RmLookupRequest;
+
 /**
  * reverselookup_replace_number:
- * @url: url string
+ * @lookup: a #RmLookupEntry
  * @full_number: full phone number
  *
- * Repleaces %NUMBER% within @url with @full_number.
+ * Replaces %NUMBER% within service url with @full_number.
  *
  * Returns: replaced string
  */
-static gchar *reverselookup_replace_number(gchar *url, gchar *full_number)
+static gchar *reverselookup_replace_number(RmLookupEntry *lookup, gchar *full_number)
+{
+	return g_strjoinv(full_number, lookup->url_parts);
+}
+
+/**
+ * reverselookup_parse:
+ * @lookup: a #RmLookupEntry
+ * @number: number to lookup
+ * @data: response data
+ * @len: length of @data
+ * @contact: a #RmContact to store data to
+ *
+ * Extracts contact data out of service response.
+ *
+ * Returns: %TRUE on success, otherwise %FALSE
+ */
+static gboolean reverselookup_parse(RmLookupEntry *lookup, gchar *number, const gchar *data, gsize len, RmContact *contact)
 {
-	GRegex *number = g_regex_new("%NUMBER%", G_REGEX_DOTALL | G_REGEX_OPTIMIZE, 0, NULL);
-	gchar *out = g_regex_replace_literal(number, url, -1, 0, full_number, 0, NULL);
+	gchar **patterns[REVERSELOOKUP_FIELD_MAX] = { lookup->name, lookup->street, lookup->city, lookup->zip };
+	gchar *fields[REVERSELOOKUP_FIELD_MAX] = { NULL };
+	gboolean result;
+
+	result = reverselookup_extract(patterns, data, len, fields);
+
+	contact->name = fields[REVERSELOOKUP_FIELD_NAME];
+	contact->street = fields[REVERSELOOKUP_FIELD_STREET];
+	contact->city = fields[REVERSELOOKUP_FIELD_CITY];
+	contact->zip = fields[REVERSELOOKUP_FIELD_ZIP];
+
+#ifdef RL_DEBUG
+	gchar *rdata = rm_convert_utf8(data, len);
+	gchar *tmp_file = g_strdup_printf("rl-%s%s-%s.html", result ? "found-" : "", lookup->service, number);
+	rm_log_save_data(tmp_file, rdata, len);
+	g_free(tmp_file);
+	g_free(rdata);
+#endif
+
+	if (!result) {
+		g_debug("%s(): Could not extract all fields of '%s'", __FUNCTION__, lookup->service);
+		return FALSE;
+	}
+
+	if (!lookup->zip && lookup->zip_len && strlen(contact->city) > lookup->zip_len) {
+		contact->zip = g_strndup(contact->city, lookup->zip_len);
+		memmove(contact->city, contact->city + lookup->zip_len + 1, strlen(contact->city) - lookup->zip_len);
+	}
 
-	g_regex_unref(number);
+	return TRUE;
+}
+
+/**
+ * reverselookup_store:
+ * @number: number to lookup
+ * @contact: a #RmContact with lookup result
+ *
+ * Remember lookup result in table and disk cache. Takes ownership of @contact.
+ */
+static void reverselookup_store(gchar *number, RmContact *contact)
+{
+	G_LOCK(table);
+#ifndef RL_DEBUG
+	reverselookup_cache_insert(cache, number, contact);
+#endif
+	g_hash_table_insert(table, g_strdup(number), contact);
+	G_UNLOCK(table);
+}
 
-	return out;
+/**
+ * reverselookup_store_unknown:
+ * @number: number to lookup
+ *
+ * Remember that no service knows @number for this session.
+ */
+static void reverselookup_store_unknown(gchar *number)
+{
+	G_LOCK(table);
+	g_hash_table_insert(table, g_strdup(number), rm_contact_new());
+	G_UNLOCK(table);
 }
 
 /**
- * reversellokup_extract_element:
- * @in: input string
- * @a_node: a #xmlNode
- * @out: output string
+ * reverselookup_table_lookup:
+ * @number: number to lookup
  *
- * Extracts a defined xml element of an xmlNode
+ * Lookup previous result of @number in table and disk cache.
  *
- * Returns: %TRUE if element could be extracted
+ * Returns: referenced #RmContact (with empty name for unknown numbers) or %NULL if number has not been looked up yet
  */
-static gboolean reverselookup_extract_element(gchar **in, xmlNode *a_node, gchar **out)
+static RmContact *reverselookup_table_lookup(gchar *number)
 {
-	xmlNode *cur_node = NULL;
-	gboolean ret = FALSE;
+	RmContact *rl_contact;
 
-	for (cur_node = a_node; cur_node && !ret; cur_node = cur_node->next) {
-		if (cur_node->type == XML_ELEMENT_NODE) {
-			if (!strcmp((gchar*)cur_node->name, in[0])) {
-				gchar *type = (gchar*)xmlGetProp(cur_node, (xmlChar*)in[1]);
+	G_LOCK(table);
+	rl_contact = g_hash_table_lookup(table, number);
+#ifndef RL_DEBUG
+	if (!rl_contact) {
+		/* Load persistent result lazily */
+		rl_contact = reverselookup_cache_lookup(cache, number);
+		if (rl_contact) {
+			g_hash_table_insert(table, g_strdup(number), rl_contact);
+		}
+	}
+#endif
+	if (rl_contact) {
+		g_object_ref(rl_contact);
+	}
+	G_UNLOCK(table);
 
-				if (type && !strcmp(type, in[2])) {
-					gchar *tmp;
-					xmlChar *name = xmlNodeListGetString(cur_node->doc, cur_node->children, TRUE);
-					GRegex *whitespace = g_regex_new("[ ]{2,}", G_REGEX_DOTALL | G_REGEX_OPTIMIZE, 0, NULL);
+	return rl_contact;
+}
+
+/**
+ * reverselookup_contact_set:
+ * @contact: a #RmContact to store data to
+ * @result: lookup result or %NULL
+ *
+ * Copy lookup @result to @contact.
+ *
+ * Returns: %TRUE if @result is a known number, otherwise %FALSE
+ */
+static gboolean reverselookup_contact_set(RmContact *contact, RmContact *result)
+{
+	if (!result || RM_EMPTY_STRING(result->name)) {
+		return FALSE;
+	}
 
-					tmp = g_regex_replace_literal(whitespace, (gchar*)name, -1, 0, " ", 0, NULL);
+	contact->name = g_strdup(result->name);
+	contact->street = g_strdup(result->street);
+	contact->zip = g_strdup(result->zip);
+	contact->city = g_strdup(result->city);
 
-					*out = g_strdup(g_strstrip(tmp));
-					g_free(tmp);
+	return TRUE;
+}
 
-					xmlFree(name);
-					return TRUE;
-				}
-			}
-		}
+/**
+ * reverselookup_service_compare:
+ * @a: a #RmLookupEntry
+ * @b: a #RmLookupEntry
+ *
+ * Orders services by success rate, services with equal rate by average latency.
+ * Must be called with services lock held.
+ *
+ * Returns: comparison result
+ */
+static gint reverselookup_service_compare(gconstpointer a, gconstpointer b)
+{
+	const RmLookupEntry *lookup_a = a;
+	const RmLookupEntry *lookup_b = b;
+	/* Laplace smoothed success rate in percent, new services start with 50% */
+	guint rate_a = (lookup_a->successes + 1) * 100 / (lookup_a->requests + 2);
+	guint rate_b = (lookup_b->successes + 1) * 100 / (lookup_b->requests + 2);
+
+	if (rate_a != rate_b) {
+		return rate_a > rate_b ? -1 : 1;
+	}
 
-		ret = reverselookup_extract_element(in, cur_node->children, out);
+	if (lookup_a->latency != lookup_b->latency) {
+		return lookup_a->latency < lookup_b->latency ? -1 : 1;
 	}
 
-	return ret;
+	return 0;
 }
 
 /**
- * reverselookup_do_entry:
+ * reverselookup_service_update:
  * @lookup: a #RmLookupEntry
- * @number: number to lookup
- * @contact: a #RmContact
+ * @success: whether service delivered a result
+ * @latency: response time in ms
  *
- * Internal reverse lookup function
+ * Update service statistics used for ordering.
+ */
+static void reverselookup_service_update(RmLookupEntry *lookup, gboolean success, gint64 latency)
+{
+	G_LOCK(services);
+	lookup->requests++;
+	if (success) {
+		lookup->successes++;
+	}
+
+	/* Exponential moving average, weight of new sample 1/4 */
+	lookup->latency = lookup->latency ? (3 * lookup->latency + latency) / 4 : latency;
+
+	g_debug("%s(): Service '%s': %u/%u successful, %" G_GINT64_FORMAT " ms", __FUNCTION__, lookup->service, lookup->successes, lookup->requests, lookup->latency);
+	G_UNLOCK(services);
+}
+
+static void reverselookup_response_cb(SoupSession *session, SoupMessage *msg, gpointer user_data);
+
+/**
+ * reverselookup_hedge_next:
+ * @hedge: a #RmLookupHedge
  *
- * Returns: %TRUE on success, otherwise %FALSE
+ * Query next service of @hedge.
+ *
+ * Returns: %TRUE if a new request has been started
  */
-static gboolean reverselookup_do_entry(RmLookupEntry *lookup, gchar *number, RmContact *contact)
+static gboolean reverselookup_hedge_next(RmLookupHedge *hedge)
 {
-	SoupMessage *msg;
-	const gchar *data;
-	gchar *rl_tmp;
-	RmContact *rl_contact;
-	gboolean result = FALSE;
+	RmLookupRequest *request;
+	RmLookupEntry *lookup;
+	SoupURI *uri;
 	gchar *full_number;
-	gchar *rdata = NULL;
-	gchar *file;
-	gsize len;
+	gchar *url;
 
-	/* get full number according to service preferences */
-	full_number = rm_number_full(number, lookup->prefix);
+	if (!hedge->services || hedge->result) {
+		return FALSE;
+	}
+
+	lookup = hedge->services->data;
+	hedge->services = g_slist_delete_link(hedge->services, hedge->services);
 
 #ifdef RL_DEBUG
-	g_debug("New lookup for '%s'", full_number);
+	g_debug("Using service '%s'", lookup->service);
 #endif
 
-	gchar *url = reverselookup_replace_number(lookup->url, full_number);
+	/* get full number according to service preferences */
+	full_number = rm_number_full(hedge->number, lookup->prefix);
+	url = reverselookup_replace_number(lookup, full_number);
+	g_free(full_number);
+
 #ifdef RL_DEBUG
 	g_debug("URL: %s", url);
 #endif
-	SoupURI *uri = soup_uri_new(url);
-	msg = soup_message_new_from_uri(SOUP_METHOD_GET, uri);
-	soup_message_headers_append(msg->request_headers, "User-Agent", "Mozilla/5.0 (compatible; MSIE 10.0; Windows NT 6.2; Trident/6.0)");
 
-	soup_session_send_message(rl_session, msg);
-	soup_uri_free(uri);
+	uri = soup_uri_new(url);
 	g_free(url);
-	if (msg->status_code != 200) {
-		//g_debug("Service: %s received status code: %d", lookup->service, msg->status_code);
-		g_object_unref(msg);
-		return FALSE;
+	if (!uri) {
+		return reverselookup_hedge_next(hedge);
+	}
+
+	request = g_slice_new0(RmLookupRequest);
+	request->hedge = hedge;
+	request->lookup = lookup;
+	request->start = g_get_monotonic_time();
+	request->msg = soup_message_new_from_uri(SOUP_METHOD_GET, uri);
+	soup_uri_free(uri);
+	soup_message_headers_append(request->msg->request_headers, "User-Agent", "Mozilla/5.0 (compatible; MSIE 10.0; Windows NT 6.2; Trident/6.0)");
+
+	hedge->requests = g_list_prepend(hedge->requests, request);
+
+	/* Session uses the thread default context of the lookup */
+	soup_session_queue_message(rl_session, request->msg, reverselookup_response_cb, request);
+
+	return TRUE;
+}
+
+/**
+ * reverselookup_hedge_complete:
+ * @hedge: a #RmLookupHedge
+ *
+ * All requests of @hedge have finished: remember and return result, then free @hedge.
+ */
+static void reverselookup_hedge_complete(RmLookupHedge *hedge)
+{
+	g_source_destroy(hedge->timer);
+	g_source_unref(hedge->timer);
+
+	if (hedge->cancel_source) {
+		g_source_destroy(hedge->cancel_source);
+		g_source_unref(hedge->cancel_source);
 	}
 
-	data = msg->response_body->data;
-	len = msg->response_body->length;
-	if (!len) {
-		goto end;
+	if (hedge->result) {
+		reverselookup_store(hedge->number, g_object_ref(hedge->result));
+		g_task_return_pointer(hedge->task, hedge->result, (GDestroyNotify)rm_contact_free);
+	} else if (!g_task_return_error_if_cancelled(hedge->task)) {
+		reverselookup_store_unknown(hedge->number);
+		g_task_return_pointer(hedge->task, NULL, NULL);
 	}
 
-	rdata = rm_convert_utf8(data, len);
+	g_object_unref(hedge->task);
+	g_slist_free(hedge->services);
+	g_free(hedge->number);
 
-	htmlDocPtr html;
-	xmlNodePtr node;
+	g_slice_free(RmLookupHedge, hedge);
+}
 
-	html = htmlReadMemory(data, len, lookup->url, "utf-8", HTML_PARSE_NOBLANKS | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING | HTML_PARSE_NONET);
+/**
+ * reverselookup_hedge_cancel_requests:
+ * @hedge: a #RmLookupHedge
+ *
+ * Cancel all running requests of @hedge. Their callbacks may be invoked right away, so the caller
+ * has to check for completion afterwards.
+ */
+static void reverselookup_hedge_cancel_requests(RmLookupHedge *hedge)
+{
+	GList *msgs = NULL;
+	GList *iter;
 
-	node = xmlDocGetRootElement(html);
+	for (iter = hedge->requests; iter != NULL; iter = iter->next) {
+		RmLookupRequest *request = iter->data;
 
-	if (!reverselookup_extract_element(lookup->name, node, &contact->name)) {
-#ifdef RL_DEBUG
-		gchar *tmp_file = g_strdup_printf("rl-%s-%s.html", lookup->service, number);
-		rm_log_save_data(tmp_file, rdata, len);
-		g_free(tmp_file);
-		g_debug("%s(): Could not extract name", __FUNCTION__);
-#endif
-		goto end;
+		msgs = g_list_prepend(msgs, g_object_ref(request->msg));
 	}
 
-	if (!reverselookup_extract_element(lookup->street, node, &contact->street)) {
-#ifdef RL_DEBUG
-		gchar *tmp_file = g_strdup_printf("rl-%s-%s.html", lookup->service, number);
-		rm_log_save_data(tmp_file, rdata, len);
-		g_free(tmp_file);
-		g_debug("%s(): Could not extract street", __FUNCTION__);
-#endif
-		goto end;
+	hedge->busy = TRUE;
+	for (iter = msgs; iter != NULL; iter = iter->next) {
+		soup_session_cancel_message(rl_session, iter->data, SOUP_STATUS_CANCELLED);
 	}
+	hedge->busy = FALSE;
 
-	if (!reverselookup_extract_element(lookup->city, node, &contact->city)) {
-#ifdef RL_DEBUG
-		gchar *tmp_file = g_strdup_printf("rl-%s-%s.html", lookup->service, number);
-		rm_log_save_data(tmp_file, rdata, len);
-		g_free(tmp_file);
-		g_debug("%s(): Could not extract city", __FUNCTION__);
-#endif
-		goto end;
-	}
-
-	if (lookup->zip) {
-		if (!reverselookup_extract_element(lookup->zip, node, &contact->zip)) {
-	#ifdef RL_DEBUG
-			gchar *tmp_file = g_strdup_printf("rl-%s-%s.html", lookup->service, number);
-			rm_log_save_data(tmp_file, rdata, len);
-			g_free(tmp_file);
-			g_debug("%s(): Could not extract zip", __FUNCTION__);
-	#endif
-			goto end;
+	g_list_free_full(msgs, g_object_unref);
+}
+
+/**
+ * reverselookup_response_cb:
+ * @session: a #SoupSession
+ * @msg: a #SoupMessage
+ * @user_data: a #RmLookupRequest
+ *
+ * Service response: parse it, cancel all other requests on success or query next service on failure.
+ */
+static void reverselookup_response_cb(SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	RmLookupRequest *request = user_data;
+	RmLookupHedge *hedge = request->hedge;
+
+	hedge->requests = g_list_remove(hedge->requests, request);
+
+	if (msg->status_code != SOUP_STATUS_CANCELLED) {
+		RmContact *contact = rm_contact_new();
+		gboolean success = FALSE;
+
+		if (msg->status_code == 200 && msg->response_body->length) {
+			success = reverselookup_parse(request->lookup, hedge->number, msg->response_body->data, msg->response_body->length, contact);
 		}
-	} else if (lookup->zip_len) {
-		contact->zip = g_strndup(contact->city, lookup->zip_len);
-		memmove(contact->city, contact->city + lookup->zip_len + 1, strlen(contact->city) - lookup->zip_len + 1);
-	}
-
-	rl_contact = g_slice_new0(RmContact);
-	rl_contact->name = g_strdup(contact->name);
-	rl_contact->street = g_strdup(contact->street);
-	rl_contact->zip = g_strdup(contact->zip);
-	rl_contact->city = g_strdup(contact->city);
-	g_hash_table_insert(table, number, rl_contact);
-	result = TRUE;
-
-	rl_tmp = g_strdup_printf("%s;%s;%s;%s;%s\n",
-				 number,
-				 rl_contact->name,
-				 rl_contact->street,
-				 rl_contact->zip,
-				 rl_contact->city);
-
-	file = g_build_filename(rm_get_user_cache_dir(), "reverselookup", number, NULL);
-	rm_file_save(file, rl_tmp, strlen(rl_tmp));
-	g_free(file);
-	g_free(rl_tmp);
 
-#ifdef RL_DEBUG
-	gchar *tmp_file = g_strdup_printf("rl-found-%s-%s.html", lookup->service, number);
-	rm_log_save_data(tmp_file, rdata, len);
-	g_free(tmp_file);
-#endif
+		reverselookup_service_update(request->lookup, success, (g_get_monotonic_time() - request->start) / 1000);
 
- end:
-	if (rdata) {
-		g_free(rdata);
+		if (success && !hedge->result) {
+			hedge->result = contact;
+
+			/* First result wins, cancel remaining requests */
+			reverselookup_hedge_cancel_requests(hedge);
+		} else {
+			rm_contact_free(contact);
+
+			/* Do not wait for hedge delay on failure */
+			reverselookup_hedge_next(hedge);
+		}
 	}
 
-	g_object_unref(msg);
+	g_slice_free(RmLookupRequest, request);
 
-	return result;
+	if (!hedge->requests && !hedge->busy) {
+		reverselookup_hedge_complete(hedge);
+	}
+}
+
+/**
+ * reverselookup_hedge_timeout_cb:
+ * @user_data: a #RmLookupHedge
+ *
+ * Hedge delay expired without result, query next service in parallel.
+ *
+ * Returns: %G_SOURCE_CONTINUE while services are left
+ */
+static gboolean reverselookup_hedge_timeout_cb(gpointer user_data)
+{
+	RmLookupHedge *hedge = user_data;
+
+	return reverselookup_hedge_next(hedge) ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+/**
+ * reverselookup_hedge_cancelled_cb:
+ * @cancellable: a #GCancellable
+ * @user_data: a #RmLookupHedge
+ *
+ * Lookup has been cancelled, stop querying services and cancel running requests.
+ *
+ * Returns: %G_SOURCE_REMOVE
+ */
+static gboolean reverselookup_hedge_cancelled_cb(GCancellable *cancellable, gpointer user_data)
+{
+	RmLookupHedge *hedge = user_data;
+
+	g_clear_pointer(&hedge->services, g_slist_free);
+	reverselookup_hedge_cancel_requests(hedge);
+
+	if (!hedge->requests) {
+		reverselookup_hedge_complete(hedge);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * reverselookup_hedge_start:
+ * @services: list of #RmLookupEntry
+ * @number: number to lookup
+ * @task: (transfer full): a #GTask to return the result with
+ *
+ * Hedged lookup: query the best service first and add the next one each time the hedge delay expires
+ * or a service fails. The first successful result is used and all other requests are cancelled.
+ * Requests run on the thread default context, the task result is a #RmContact or %NULL.
+ */
+static void reverselookup_hedge_start(GSList *services, gchar *number, GTask *task)
+{
+	GMainContext *context = g_main_context_get_thread_default();
+	GCancellable *cancellable = g_task_get_cancellable(task);
+	RmLookupHedge *hedge = g_slice_new0(RmLookupHedge);
+
+	hedge->task = task;
+	hedge->number = g_strdup(number);
+
+	G_LOCK(services);
+	hedge->services = g_slist_sort(g_slist_copy(services), reverselookup_service_compare);
+	G_UNLOCK(services);
+
+	hedge->timer = g_timeout_source_new(REVERSELOOKUP_HEDGE_DELAY);
+	g_source_set_callback(hedge->timer, reverselookup_hedge_timeout_cb, hedge, NULL);
+	g_source_attach(hedge->timer, context);
+
+	if (cancellable) {
+		hedge->cancel_source = g_cancellable_source_new(cancellable);
+		g_source_set_callback(hedge->cancel_source, (GSourceFunc)reverselookup_hedge_cancelled_cb, hedge, NULL);
+		g_source_attach(hedge->cancel_source, context);
+	}
+
+	if (!reverselookup_hedge_next(hedge)) {
+		reverselookup_hedge_complete(hedge);
+	}
+}
+
+/**
+ * reverselookup_do_services_cb:
+ * @source: unused
+ * @res: a #GAsyncResult
+ * @user_data: pointer to store @res in
+ *
+ * Synchronous hedged lookup has finished.
+ */
+static void reverselookup_do_services_cb(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GAsyncResult **result = user_data;
+
+	*result = g_object_ref(res);
+}
+
+/**
+ * reverselookup_do_services:
+ * @services: list of #RmLookupEntry
+ * @number: number to lookup
+ *
+ * Synchronous hedged lookup on a private main context, see reverselookup_hedge_start().
+ *
+ * Returns: a #RmContact or %NULL if no service knows @number
+ */
+static RmContact *reverselookup_do_services(GSList *services, gchar *number)
+{
+	GMainContext *context = g_main_context_new();
+	GAsyncResult *result = NULL;
+	RmContact *found;
+
+	g_main_context_push_thread_default(context);
+
+	reverselookup_hedge_start(services, number, g_task_new(NULL, NULL, reverselookup_do_services_cb, &result));
+	while (!result) {
+		g_main_context_iteration(context, TRUE);
+	}
+
+	g_main_context_pop_thread_default(context);
+
+	found = g_task_propagate_pointer(G_TASK(result), NULL);
+
+	g_object_unref(result);
+	g_main_context_unref(context);
+
+	return found;
 }
 
 /**
@@ -318,55 +651,25 @@ static gchar *reverselookup_get_country_code(const gchar *full_number)
 }
 
 /**
- * reverselookup_do:
+ * reverselookup_get_services:
  * @number: number to lookup
- * @contact: a #RmContact
  *
- * Reverse lookup function
+ * Get services which are able to lookup @number, based on its country code.
  *
- * Returns: %TRUE on success, otherwise %FALSE
+ * Returns: list of #RmLookupEntry or %NULL if number can not be looked up
  */
-static gboolean reverselookup_do(gchar *number, RmContact *contact)
+static GSList *reverselookup_get_services(gchar *number)
 {
-	RmLookupEntry *lookup = NULL;
+	RmProfile *profile = rm_profile_get_active();
 	GSList *list = NULL;
 	gchar *full_number = NULL;
 	gchar *country_code = NULL;
-	gboolean found = FALSE;
 	gint international_access_code_len;
-	RmProfile *profile = rm_profile_get_active();
-	RmContact *rl_contact;
-
-	if (!profile) {
-		return FALSE;
-	}
-
-	/* In case we do not have a number, abort */
-	if (RM_EMPTY_STRING(number) || !isdigit(number[0])) {
-		return FALSE;
-	}
-
-#ifdef RL_DEBUG
-	g_debug("Input number '%s'", number);
-#endif
-
-	rl_contact = g_hash_table_lookup(table, number);
-	if (rl_contact) {
-		if (!RM_EMPTY_STRING(rl_contact->name)) {
-			contact->name = g_strdup(rl_contact->name);
-			contact->street = g_strdup(rl_contact->street);
-			contact->zip = g_strdup(rl_contact->zip);
-			contact->city = g_strdup(rl_contact->city);
-			return TRUE;
-		}
-
-		return FALSE;
-	}
 
 	/* Get full number and extract country code if possible */
 	full_number = rm_number_full(number, TRUE);
 	if (!full_number) {
-		return FALSE;
+		return NULL;
 	}
 
 #ifdef RL_DEBUG
@@ -386,42 +689,178 @@ static gboolean reverselookup_do(gchar *number, RmContact *contact)
 #endif
 
 	if (!country_code) {
-		return FALSE;
+		return NULL;
 	}
 
-	if (strcmp(country_code + international_access_code_len, rm_router_get_country_code(rm_profile_get_active()))) {
+	if (strcmp(country_code + international_access_code_len, rm_router_get_country_code(profile))) {
 		/* if country code is not the same as the router country code, loop through country list */
 		list = reverselookup_get_lookup_list(country_code + international_access_code_len);
 	} else {
 		/* if country code is the same as the router country code, use default plugin */
-		list = reverselookup_get_lookup_list(rm_router_get_country_code(rm_profile_get_active()));
+		list = reverselookup_get_lookup_list(rm_router_get_country_code(profile));
 	}
 
 	g_free(country_code);
 
-	for (; list != NULL && list->data != NULL; list = list->next) {
-		lookup = list->data;
+	return list;
+}
+
+/**
+ * reverselookup_valid_number:
+ * @number: number to lookup
+ *
+ * Checks whether @number can be looked up at all.
+ *
+ * Returns: %TRUE if @number is valid for a reverse lookup
+ */
+static gboolean reverselookup_valid_number(gchar *number)
+{
+	if (!rm_profile_get_active()) {
+		return FALSE;
+	}
+
+	/* In case we do not have a number, abort */
+	if (RM_EMPTY_STRING(number) || !isdigit(number[0])) {
+		return FALSE;
+	}
 
 #ifdef RL_DEBUG
-		g_debug("Using service '%s'", lookup->service);
+	g_debug("Input number '%s'", number);
 #endif
 
-		found = reverselookup_do_entry(lookup, number, contact);
-		/* in case we found some valid data, break loop */
-		if (found) {
-			break;
-		}
+	return TRUE;
+}
+
+/**
+ * reverselookup_do:
+ * @number: number to lookup
+ * @contact: a #RmContact
+ *
+ * Reverse lookup function
+ *
+ * Returns: %TRUE on success, otherwise %FALSE
+ */
+static gboolean reverselookup_do(gchar *number, RmContact *contact)
+{
+	RmContact *result;
+	GSList *services;
+	gboolean found;
+
+	if (!reverselookup_valid_number(number)) {
+		return FALSE;
 	}
 
-	if (!found) {
-		rl_contact = g_slice_new0(RmContact);
+	result = reverselookup_table_lookup(number);
+	if (!result) {
+		services = reverselookup_get_services(number);
+		if (!services) {
+			return FALSE;
+		}
 
-		g_hash_table_insert(table, number, rl_contact);
+		result = reverselookup_do_services(services, number);
 	}
 
+	found = reverselookup_contact_set(contact, result);
+	rm_contact_free(result);
+
 	return found;
 }
 
+/**
+ * reverselookup_search_start_cb:
+ * @user_data: a #GTask with the number as task data
+ *
+ * Worker part of reverselookup_search_async(): check previous results and start a hedged lookup.
+ *
+ * Returns: %G_SOURCE_REMOVE
+ */
+static gboolean reverselookup_search_start_cb(gpointer user_data)
+{
+	GTask *task = user_data;
+	gchar *number = g_task_get_task_data(task);
+	RmContact *result = NULL;
+
+	if (g_task_return_error_if_cancelled(task)) {
+		g_object_unref(task);
+		return G_SOURCE_REMOVE;
+	}
+
+	if (reverselookup_valid_number(number)) {
+		result = reverselookup_table_lookup(number);
+		if (!result) {
+			GSList *services = reverselookup_get_services(number);
+
+			if (services) {
+				reverselookup_hedge_start(services, number, task);
+				return G_SOURCE_REMOVE;
+			}
+		}
+	}
+
+	g_task_return_pointer(task, result, (GDestroyNotify)rm_contact_free);
+	g_object_unref(task);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * reverselookup_search_async:
+ * @number: number to lookup
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: a #GAsyncReadyCallback
+ * @user_data: user data for @callback
+ *
+ * Asynchronous reverse lookup function. Services are queried on the reverse lookup worker, @callback is
+ * invoked on the caller's main context. Finish with reverselookup_search_finish().
+ */
+static void reverselookup_search_async(gchar *number, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+	GTask *task = g_task_new(NULL, cancellable, callback, user_data);
+
+	g_task_set_source_tag(task, reverselookup_search_async);
+	g_task_set_task_data(task, g_strdup(number), g_free);
+
+	g_main_context_invoke(rl_context, reverselookup_search_start_cb, task);
+}
+
+/**
+ * reverselookup_thread:
+ * @data: unused
+ *
+ * Reverse lookup worker, runs rl_context until plugin shutdown.
+ *
+ * Returns: %NULL
+ */
+static gpointer reverselookup_thread(gpointer data)
+{
+	g_main_context_push_thread_default(rl_context);
+	g_main_loop_run(rl_loop);
+	g_main_context_pop_thread_default(rl_context);
+
+	return NULL;
+}
+
+/**
+ * reverselookup_search_finish:
+ * @result: a #GAsyncResult
+ * @contact: a #RmContact to store data to
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finish reverse lookup started with reverselookup_search_async().
+ *
+ * Returns: %TRUE on success, otherwise %FALSE
+ */
+static gboolean reverselookup_search_finish(GAsyncResult *result, RmContact *contact, GError **error)
+{
+	RmContact *found = g_task_propagate_pointer(G_TASK(result), error);
+	gboolean ret;
+
+	ret = reverselookup_contact_set(contact, found);
+	rm_contact_free(found);
+
+	return ret;
+}
+
 /**
  * reverselookup_add:
  * @node: a #RmXmlNode
@@ -487,6 +926,7 @@ static void reverselookup_add(RmXmlNode *node)
 	lookup->service = service;
 	lookup->prefix = prefix[ 0 ] == '1';
 	lookup->url = url;
+	lookup->url_parts = g_strsplit(url, "%NUMBER%", -1);
 	lookup->name = name;
 	lookup->street = street;
 	lookup->city = city;
@@ -520,61 +960,11 @@ static void reverselookup_country_code_add(RmXmlNode *node)
 	g_hash_table_insert(lookup_table, (gpointer)atol(code), lookup_list);
 }
 
-/**
- * reverselookup_read_cache:
- * @dir_name: read cache file from @dir_name
- *
- * Read cached data (previous lookups with valid data)
- */
-static void reverselookup_read_cache(gchar *dir_name)
-{
-#ifndef RL_DEBUG
-	g_autoptr (GDir) dir = NULL;
-	GError *error = NULL;
-	const gchar *file_name;
-
-	if (!dir_name) {
-		return;
-	}
-
-	dir = g_dir_open(dir_name, 0, &error);
-	if (!dir) {
-		g_debug("Could not open lookup directory");
-		return;
-	}
-
-	while ((file_name = g_dir_read_name(dir))) {
-		gchar *data;
-		gchar *uri;
-		gchar **split;
-		RmContact *contact;
-
-		uri = g_build_filename(dir_name, file_name, NULL);
-		data = rm_file_load(uri, NULL);
-		g_free(uri);
-
-		g_assert(data != NULL);
-
-		split = g_strsplit(data, ";", -1);
-
-		contact = g_slice_new0(RmContact);
-
-		contact->name = g_strdup(split[1]);
-		contact->street = g_strdup(split[2]);
-		contact->zip = g_strdup(split[3]);
-		contact->city = g_strstrip(g_strdup(split[4]));
-
-		g_hash_table_insert(table, g_strdup(split[0]), contact);
-
-		g_free(data);
-		g_strfreev(split);
-	}
-#endif
-}
-
 RmLookup rl = {
 	"Reverse Lookup",
-	reverselookup_do
+	reverselookup_do,
+	reverselookup_search_async,
+	reverselookup_search_finish
 };
 
 /**
@@ -594,7 +984,7 @@ static gboolean reverselookup_plugin_init(RmPlugin *plugin)
 	plugin->priv = reverselookup_plugin;
 
 	reverselookup_plugin->table = g_hash_table_new(g_str_hash, g_str_equal);
-	table = g_hash_table_new(g_str_hash, g_str_equal);
+	table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)rm_contact_free);
 
 	file = g_build_filename(g_get_home_dir(), "lookup.xml", NULL);
 	if (!g_file_test(file, G_FILE_TEST_EXISTS)) {
@@ -620,15 +1010,25 @@ static gboolean reverselookup_plugin_init(RmPlugin *plugin)
 		reverselookup_country_code_add(child);
 	}
 
+	file = g_build_filename(rm_get_user_cache_dir(), "reverselookup.cache", NULL);
+	cache = reverselookup_cache_open(file);
+	g_free(file);
+
+	/* Import old one-file-per-number cache once */
 	file = g_build_filename(rm_get_user_cache_dir(), "reverselookup", NULL);
-	g_mkdir_with_parents(file, 0770);
-	reverselookup_read_cache(file);
+	if (g_file_test(file, G_FILE_TEST_IS_DIR)) {
+		reverselookup_cache_import(cache, file);
+	}
 	g_free(file);
 
 	rm_xmlnode_free(node);
 
 	rl_session = soup_session_new();
 
+	rl_context = g_main_context_new();
+	rl_loop = g_main_loop_new(rl_context, FALSE);
+	rl_thread = g_thread_new("reverselookup", reverselookup_thread, NULL);
+
 	rm_lookup_register(&rl);
 
 	return TRUE;
@@ -653,6 +1053,14 @@ static gboolean reverselookup_plugin_shutdown(RmPlugin *plugin)
 
 	rm_lookup_unregister(&rl);
 
+	/* Lookups still running on the worker are dropped, their callers time out or cancel */
+	g_main_loop_quit(rl_loop);
+	g_thread_join(g_steal_pointer(&rl_thread));
+	g_clear_pointer(&rl_loop, g_main_loop_unref);
+	g_clear_pointer(&rl_context, g_main_context_unref);
+
+	g_clear_pointer(&cache, reverselookup_cache_free);
+
 	return TRUE;
 }
 
@@ -23,6 +23,7 @@
 #define __RM_H_INSIDE__
 
 #include <rm/rmaction.h>
+#include <rm/rmcache.h>
 #include <rm/rmcallentry.h>
 #include <rm/rmcsv.h>
 #include <rm/rmfaxserver.h>
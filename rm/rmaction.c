@@ -95,6 +95,7 @@ gchar *rm_action_regex(gchar *str, RmConnection *connection)
 	reg = g_regex_new("%LINE%|%NUMBER%|%NAME%|%COMPANY%", 0, 0, NULL);
 	res = g_regex_replace_eval(reg, str, -1, 0, 0, rm_action_eval_cb, h, NULL);
 	g_hash_table_destroy(h);
+	rm_contact_free(contact);
 
 	return res;
 }
@@ -22,6 +22,7 @@
 #include <glib.h>
 
 #include <rm/rmaddressbook.h>
+#include <rm/rmcache.h>
 #include <rm/rmobject.h>
 #include <rm/rmobjectemit.h>
 #include <rm/rmcontact.h>
@@ -40,8 +41,36 @@
  */
 
 static guint rm_addressbook_contact_process_id = 0;
+static guint rm_addressbook_contacts_process_id = 0;
 static guint rm_addressbook_contacts_changed_id = 0;
-static GHashTable *rm_addressbook_table = NULL;
+static RmCache *rm_addressbook_cache = NULL;
+
+/** Maximum number of cached lookup results */
+#define RM_ADDRESSBOOK_CACHE_ENTRIES 1024
+/** Maximum memory of cached lookup results */
+#define RM_ADDRESSBOOK_CACHE_MEMORY (512 * 1024)
+/** Time to live of found contacts in seconds */
+#define RM_ADDRESSBOOK_CACHE_POSITIVE_TTL (60 * 60)
+/** Time to live of unknown numbers in seconds */
+#define RM_ADDRESSBOOK_CACHE_NEGATIVE_TTL (10 * 60)
+
+/** Number of trailing digits used as suffix index key */
+#define RM_ADDRESSBOOK_SUFFIX_LENGTH 7
+/** Maximum number of direct dial-in digits stripped for extension matching */
+#define RM_ADDRESSBOOK_EXTENSION_LENGTH 4
+
+/** Normalized number -> array of #RmContact of indexed address book */
+static GHashTable *rm_addressbook_index = NULL;
+/** Trailing digits of normalized number -> array of #RmContact */
+static GHashTable *rm_addressbook_index_suffix = NULL;
+/** Normalized base number of numbers with an extension -> array of #RmContact */
+static GHashTable *rm_addressbook_index_base = NULL;
+/** #RmContact -> array of its #RmAddressBookIndexEntry, needed to update contacts which are changed in place */
+static GHashTable *rm_addressbook_index_contacts = NULL;
+/** Number of lookups resolved by fuzzy matching */
+static guint rm_addressbook_fuzzy_matches = 0;
+/** Address book the index has been built for, %NULL if index needs to be rebuilt */
+static RmAddressBook *rm_addressbook_index_book = NULL;
 
 /** Internal address book list */
 static GList *rm_addressbook_plugins = NULL;
@@ -86,6 +115,333 @@ GList *rm_addressbook_get_contacts(RmAddressBook *book)
 	return NULL;
 }
 
+/**
+ * RmAddressBookIndexEntry:
+ * @table: index table
+ * @key: key of contact within @table
+ *
+ * Index entry of a contact, needed to remove contacts which are changed in place
+ */
+typedef struct {
+	GHashTable *table;
+	gchar *key;
+} RmAddressBookIndexEntry;
+
+/**
+ * rm_addressbook_index_entry_free:
+ * @data: a #RmAddressBookIndexEntry
+ *
+ * Frees index entry
+ */
+static void rm_addressbook_index_entry_free(gpointer data)
+{
+	RmAddressBookIndexEntry *entry = data;
+
+	g_free(entry->key);
+	g_slice_free(RmAddressBookIndexEntry, entry);
+}
+
+/**
+ * rm_addressbook_index_insert:
+ * @table: index table
+ * @key: index key
+ * @contact: a #RmContact
+ * @entries: index entries of @contact
+ *
+ * Add @contact to @table using @key.
+ */
+static void rm_addressbook_index_insert(GHashTable *table, const gchar *key, RmContact *contact, GPtrArray *entries)
+{
+	GPtrArray *contacts = g_hash_table_lookup(table, key);
+	RmAddressBookIndexEntry *entry;
+
+	if (!contacts) {
+		contacts = g_ptr_array_new();
+		g_hash_table_insert(table, g_strdup(key), contacts);
+	}
+
+	/* Numbers of a contact are added in a row, skip duplicates within the same contact */
+	if (contacts->len && g_ptr_array_index(contacts, contacts->len - 1) == contact) {
+		return;
+	}
+
+	/* Keep address book order, first contact wins */
+	g_ptr_array_add(contacts, contact);
+
+	entry = g_slice_new(RmAddressBookIndexEntry);
+	entry->table = table;
+	entry->key = g_strdup(key);
+	g_ptr_array_add(entries, entry);
+}
+
+/**
+ * rm_addressbook_index_remove:
+ * @contact: a #RmContact
+ *
+ * Remove all numbers of @contact from number index.
+ */
+static void rm_addressbook_index_remove(RmContact *contact)
+{
+	GPtrArray *entries = g_hash_table_lookup(rm_addressbook_index_contacts, contact);
+	guint idx;
+
+	if (!entries) {
+		return;
+	}
+
+	for (idx = 0; idx < entries->len; idx++) {
+		RmAddressBookIndexEntry *entry = g_ptr_array_index(entries, idx);
+		GPtrArray *contacts = g_hash_table_lookup(entry->table, entry->key);
+
+		if (contacts && g_ptr_array_remove(contacts, contact) && !contacts->len) {
+			g_hash_table_remove(entry->table, entry->key);
+		}
+	}
+
+	g_hash_table_remove(rm_addressbook_index_contacts, contact);
+}
+
+/**
+ * rm_addressbook_number_suffix:
+ * @number: normalized number
+ *
+ * Get trailing digits of @number used as suffix index key.
+ *
+ * Returns: suffix of @number or %NULL if number is too short
+ */
+static inline const gchar *rm_addressbook_number_suffix(const gchar *number)
+{
+	gsize len = strlen(number);
+
+	if (len < RM_ADDRESSBOOK_SUFFIX_LENGTH) {
+		return NULL;
+	}
+
+	return number + len - RM_ADDRESSBOOK_SUFFIX_LENGTH;
+}
+
+/**
+ * rm_addressbook_index_add:
+ * @contact: a #RmContact
+ *
+ * Add all numbers of @contact to number index. Numbers are normalized the same way as lookup numbers.
+ * Besides the exact number, the trailing digits and the base number of numbers with an
+ * extension ("030 12345-0") are indexed for fuzzy matching.
+ */
+static void rm_addressbook_index_add(RmContact *contact)
+{
+	GPtrArray *entries = g_ptr_array_new_with_free_func(rm_addressbook_index_entry_free);
+	GList *list;
+
+	for (list = contact->numbers; list != NULL; list = list->next) {
+		RmPhoneNumber *phone_number = list->data;
+		const gchar *suffix;
+		gchar *extension;
+		gchar *number;
+
+		if (RM_EMPTY_STRING(phone_number->number)) {
+			continue;
+		}
+
+		number = rm_number_full(phone_number->number, FALSE);
+		if (!number) {
+			continue;
+		}
+
+		rm_addressbook_index_insert(rm_addressbook_index, number, contact, entries);
+
+		suffix = rm_addressbook_number_suffix(number);
+		if (suffix) {
+			rm_addressbook_index_insert(rm_addressbook_index_suffix, suffix, contact, entries);
+		}
+
+		g_free(number);
+
+		/* Extension separator, callers from direct dial-in numbers share the base number */
+		extension = strrchr(phone_number->number, '-');
+		if (extension && extension != phone_number->number) {
+			gchar *base = g_strndup(phone_number->number, extension - phone_number->number);
+
+			number = rm_number_full(base, FALSE);
+			if (number && strlen(number) >= RM_ADDRESSBOOK_SUFFIX_LENGTH) {
+				rm_addressbook_index_insert(rm_addressbook_index_base, number, contact, entries);
+			}
+
+			g_free(number);
+			g_free(base);
+		}
+	}
+
+	g_hash_table_replace(rm_addressbook_index_contacts, contact, entries);
+}
+
+/**
+ * rm_addressbook_index_invalidate:
+ *
+ * Drop number index, it is rebuilt on next lookup.
+ */
+static void rm_addressbook_index_invalidate(void)
+{
+	if (rm_addressbook_index) {
+		g_hash_table_remove_all(rm_addressbook_index);
+		g_hash_table_remove_all(rm_addressbook_index_suffix);
+		g_hash_table_remove_all(rm_addressbook_index_base);
+		g_hash_table_remove_all(rm_addressbook_index_contacts);
+	}
+
+	rm_addressbook_index_book = NULL;
+}
+
+/**
+ * rm_addressbook_index_verify_suffix:
+ * @contact: a #RmContact
+ * @number: normalized number
+ *
+ * Verify a suffix index candidate: one of the normalized numbers of @contact and @number must end
+ * with the other one.
+ *
+ * Returns: %TRUE if @contact matches @number
+ */
+static gboolean rm_addressbook_index_verify_suffix(RmContact *contact, const gchar *number)
+{
+	GPtrArray *entries = g_hash_table_lookup(rm_addressbook_index_contacts, contact);
+	gsize len = strlen(number);
+	guint idx;
+
+	for (idx = 0; entries && idx < entries->len; idx++) {
+		RmAddressBookIndexEntry *entry = g_ptr_array_index(entries, idx);
+		gsize entry_len;
+
+		if (entry->table != rm_addressbook_index) {
+			continue;
+		}
+
+		entry_len = strlen(entry->key);
+		if (entry_len >= len ? !strcmp(entry->key + entry_len - len, number) : !strcmp(number + len - entry_len, entry->key)) {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * rm_addressbook_index_lookup_fuzzy:
+ * @number: normalized number
+ *
+ * Lookup contact by trailing digits or as direct dial-in number of an extension base number.
+ * Ambiguous matches are rejected.
+ *
+ * Returns: a #RmContact or %NULL if not found
+ */
+static RmContact *rm_addressbook_index_lookup_fuzzy(const gchar *number)
+{
+	const gchar *suffix = rm_addressbook_number_suffix(number);
+	RmContact *match = NULL;
+	GPtrArray *contacts;
+	gsize len;
+	guint idx;
+
+	if (!suffix) {
+		return NULL;
+	}
+
+	contacts = g_hash_table_lookup(rm_addressbook_index_suffix, suffix);
+	for (idx = 0; contacts && idx < contacts->len; idx++) {
+		RmContact *contact = g_ptr_array_index(contacts, idx);
+
+		if (!rm_addressbook_index_verify_suffix(contact, number)) {
+			continue;
+		}
+
+		if (match && match != contact) {
+			g_debug("%s(): Ambiguous suffix match", __FUNCTION__);
+			return NULL;
+		}
+
+		match = contact;
+	}
+
+	if (match) {
+		return match;
+	}
+
+	/* Strip up to RM_ADDRESSBOOK_EXTENSION_LENGTH digits of a direct dial-in extension */
+	len = strlen(number);
+	for (idx = 1; idx <= RM_ADDRESSBOOK_EXTENSION_LENGTH && len - idx >= RM_ADDRESSBOOK_SUFFIX_LENGTH; idx++) {
+		gchar *base = g_strndup(number, len - idx);
+
+		contacts = g_hash_table_lookup(rm_addressbook_index_base, base);
+		g_free(base);
+
+		if (contacts && contacts->len > 1) {
+			g_debug("%s(): Ambiguous extension match", __FUNCTION__);
+			return NULL;
+		}
+
+		if (contacts) {
+			return g_ptr_array_index(contacts, 0);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * rm_addressbook_index_lookup:
+ * @book: a #RmAddressBook
+ * @number: normalized number
+ *
+ * Lookup contact owning @number in @book, building the number index if needed.
+ *
+ * Returns: a #RmContact or %NULL if not found
+ */
+static RmContact *rm_addressbook_index_lookup(RmAddressBook *book, const gchar *number)
+{
+	GPtrArray *contacts;
+	RmContact *contact;
+
+	if (rm_addressbook_index_book != book) {
+		GList *list;
+
+		rm_addressbook_index_invalidate();
+
+		for (list = rm_addressbook_get_contacts(book); list != NULL; list = list->next) {
+			rm_addressbook_index_add(list->data);
+		}
+
+		rm_addressbook_index_book = book;
+		g_debug("%s(): Indexed %u numbers", __FUNCTION__, g_hash_table_size(rm_addressbook_index));
+	}
+
+	contacts = g_hash_table_lookup(rm_addressbook_index, number);
+	if (contacts) {
+		return g_ptr_array_index(contacts, 0);
+	}
+
+	contact = rm_addressbook_index_lookup_fuzzy(number);
+	if (contact) {
+		/* Without a local match this number would have been passed to reverse lookup */
+		rm_addressbook_fuzzy_matches++;
+		g_debug("%s(): Fuzzy match, %u reverse lookups saved so far", __FUNCTION__, rm_addressbook_fuzzy_matches);
+	}
+
+	return contact;
+}
+
+/**
+ * rm_addressbook_get_fuzzy_matches:
+ *
+ * Get number of lookups resolved by suffix or extension matching. These would have been passed
+ * to reverse lookup otherwise.
+ *
+ * Returns: number of fuzzy matches
+ */
+guint rm_addressbook_get_fuzzy_matches(void)
+{
+	return rm_addressbook_fuzzy_matches;
+}
+
 /**
  * rm_addressbook_remove_contact:
  * @book: a #RmAddressBook
@@ -97,11 +453,28 @@ GList *rm_addressbook_get_contacts(RmAddressBook *book)
  */
 gboolean rm_addressbook_remove_contact(RmAddressBook *book, RmContact *contact)
 {
-	if (book && book->remove_contact) {
-		return book->remove_contact(contact);
+	gboolean ret;
+
+	if (!book || !book->remove_contact) {
+		return FALSE;
 	}
 
-	return FALSE;
+	/* Contact may be freed by address book */
+	if (rm_addressbook_index && rm_addressbook_index_book == book) {
+		rm_addressbook_index_remove(contact);
+	}
+
+	ret = book->remove_contact(contact);
+
+	if (!ret && rm_addressbook_index && rm_addressbook_index_book == book) {
+		rm_addressbook_index_add(contact);
+	}
+
+	if (rm_addressbook_cache) {
+		rm_cache_remove_all(rm_addressbook_cache);
+	}
+
+	return ret;
 }
 
 /**
@@ -115,11 +488,25 @@ gboolean rm_addressbook_remove_contact(RmAddressBook *book, RmContact *contact)
  */
 gboolean rm_addressbook_save_contact(RmAddressBook *book, RmContact *contact)
 {
-	if (book && book->save_contact) {
-		return book->save_contact(contact);
+	gboolean ret;
+
+	if (!book || !book->save_contact) {
+		return FALSE;
 	}
 
-	return FALSE;
+	ret = book->save_contact(contact);
+
+	/* Contact numbers may have been changed in place, update index entries */
+	if (rm_addressbook_index && rm_addressbook_index_book == book) {
+		rm_addressbook_index_remove(contact);
+		rm_addressbook_index_add(contact);
+	}
+
+	if (rm_addressbook_cache) {
+		rm_cache_remove_all(rm_addressbook_cache);
+	}
+
+	return ret;
 }
 
 /**
@@ -140,29 +527,42 @@ gboolean rm_addressbook_can_save(RmAddressBook *book)
 }
 
 /**
- * rm_address_book_number_in_contact:
- * @a: a #RmContact
- * @b: a number
+ * rm_addressbook_lookup:
+ * @book: a #RmAddressBook
+ * @number: number to lookup
  *
- * Checks if number @b is within contact @a.
+ * Lookup @number in @book. Results are cached as immutable snapshots carrying @number, hits just
+ * take a reference to it.
  *
- * Returns: 0 if present, -1 otherwise
+ * Returns: (transfer full): shared #RmContact which must not be modified, or %NULL if not found
  */
-static gint rm_addressbook_number_in_contact(gconstpointer a, gconstpointer b)
+static RmContact *rm_addressbook_lookup(RmAddressBook *book, const gchar *number)
 {
-	RmContact *contact = (RmContact*)a;
-	gchar *number = (gchar*)b;
-	GList *list;
+	RmContact *contact;
+	gchar *full_number;
 
-	for (list = contact->numbers; list != NULL; list = list->next) {
-		RmPhoneNumber *phone_number = list->data;
+	if (rm_cache_lookup(rm_addressbook_cache, number, (gpointer*)&contact)) {
+		/* Either a cached snapshot or a previous lookup without result */
+		return contact;
+	}
 
-		if (g_strcmp0(phone_number->number, number) == 0) {
-			return 0;
-		}
+	full_number = rm_number_full(number, FALSE);
+
+	contact = rm_addressbook_index_lookup(book, full_number);
+	if (contact) {
+		contact = rm_contact_dup(contact);
+		g_free(contact->number);
+		contact->number = g_strdup(number);
+
+		rm_cache_insert(rm_addressbook_cache, number, g_object_ref(contact));
+	} else {
+		/* We have found no entry, remember it to speedup further lookups until negative ttl expires */
+		rm_cache_insert(rm_addressbook_cache, number, NULL);
 	}
 
-	return -1;
+	g_free(full_number);
+
+	return contact;
 }
 
 /**
@@ -171,54 +571,64 @@ static gint rm_addressbook_number_in_contact(gconstpointer a, gconstpointer b)
  * @contact: a #RmContact
  * @user_data: user data
  *
- * On contact-process signal, try to lookup contact in addressbook
+ * On contact-process signal, try to lookup contact in addressbook. The signal hands over @contact
+ * to be filled in, so the result is copied into it.
  */
 static void rm_addressbook_contact_process_cb(RmObject *obj, RmContact *contact, gpointer user_data)
 {
 	RmAddressBook *book = rm_profile_get_addressbook(rm_profile_get_active());
-	RmContact *tmp_contact;
-	GList *contacts;
+	RmContact *found;
 	gchar *number = contact->number;
 
-	if (RM_EMPTY_STRING(contact->number)) {
-		/* Contact number is not present, abort */
+	if (RM_EMPTY_STRING(contact->number) || !rm_addressbook_get_contacts(book)) {
 		return;
 	}
 
-	contacts = rm_addressbook_get_contacts(book);
-	if (!contacts) {
+	found = rm_addressbook_lookup(book, contact->number);
+	if (!found) {
 		return;
 	}
 
-	tmp_contact = g_hash_table_lookup(rm_addressbook_table, contact->number);
-	if (tmp_contact) {
-		if (!RM_EMPTY_STRING(tmp_contact->name)) {
-			rm_contact_copy(tmp_contact, contact);
-		} else {
-			/* Previous lookup done but no result found */
-			return;
-		}
-	} else {
-		GList *list;
-		gchar *full_number = rm_number_full(contact->number, FALSE);
+	/* rm_contact_copy() duplicates the number, keep the one owned by the caller */
+	rm_contact_copy(found, contact);
+	rm_contact_free(found);
 
-		list = g_list_find_custom(contacts, full_number, rm_addressbook_number_in_contact);
-		if (list) {
-			tmp_contact = list->data;
+	g_free(contact->number);
+	contact->number = number;
+}
 
-			g_hash_table_insert(rm_addressbook_table, g_strdup(contact->number), rm_contact_dup(tmp_contact));
+/**
+ * rm_addressbook_contacts_process_cb:
+ * @obj: a #RmObject
+ * @contacts: array of #RmContact
+ * @user_data: user data
+ *
+ * On contacts-process signal, try to lookup all contacts in addressbook. Found contacts are replaced
+ * by a reference to the cached result instead of copying it.
+ */
+static void rm_addressbook_contacts_process_cb(RmObject *obj, GPtrArray *contacts, gpointer user_data)
+{
+	RmAddressBook *book = rm_profile_get_addressbook(rm_profile_get_active());
+	guint idx;
 
-			rm_contact_copy(tmp_contact, contact);
-		} else {
-			/* We have found no entry, mark it in rm_addressbook_table to speedup further lookup */
-			tmp_contact = g_malloc0(sizeof(RmContact));
-			g_hash_table_insert(rm_addressbook_table, g_strdup(contact->number), tmp_contact);
+	if (!rm_addressbook_get_contacts(book)) {
+		return;
+	}
+
+	for (idx = 0; idx < contacts->len; idx++) {
+		RmContact *contact = g_ptr_array_index(contacts, idx);
+		RmContact *found;
+
+		if (RM_EMPTY_STRING(contact->number)) {
+			continue;
 		}
 
-		g_free(full_number);
+		found = rm_addressbook_lookup(book, contact->number);
+		if (found) {
+			rm_contact_free(contact);
+			g_ptr_array_index(contacts, idx) = found;
+		}
 	}
-
-	contact->number = number;
 }
 
 /**
@@ -226,22 +636,64 @@ static void rm_addressbook_contact_process_cb(RmObject *obj, RmContact *contact,
  * @obj: a #RmObject
  * @user_data: user data
  *
- * Contacts have changed (new, deleted contacts or new address book). Clear address book hash table.
+ * Contacts have changed (new, deleted contacts or new address book). Clear lookup cache and number index.
  */
 static void rm_addressbook_contacts_changed_cb(RmObject *obj, gpointer user_data)
 {
-	g_hash_table_remove_all(rm_addressbook_table);
+	rm_cache_remove_all(rm_addressbook_cache);
+	rm_addressbook_index_invalidate();
 }
 
 /**
- * rm_addressbook_table_free:
+ * rm_addressbook_cache_size:
  * @data: a #RmContact
  *
- * Frees contact data.
+ * Estimate memory used by a cached contact.
+ *
+ * Returns: size in bytes
  */
-static void rm_addressbook_table_free(void *data)
+static gsize rm_addressbook_cache_size(gconstpointer data)
 {
-	rm_contact_free(data);
+	const RmContact *contact = data;
+	gsize size = sizeof(RmContact);
+	GList *list;
+
+	size += contact->name ? strlen(contact->name) + 1 : 0;
+	size += contact->company ? strlen(contact->company) + 1 : 0;
+	size += contact->number ? strlen(contact->number) + 1 : 0;
+	size += contact->street ? strlen(contact->street) + 1 : 0;
+	size += contact->zip ? strlen(contact->zip) + 1 : 0;
+	size += contact->city ? strlen(contact->city) + 1 : 0;
+
+	for (list = contact->numbers; list != NULL; list = list->next) {
+		RmPhoneNumber *phone_number = list->data;
+
+		size += sizeof(RmPhoneNumber) + (phone_number->number ? strlen(phone_number->number) + 1 : 0);
+	}
+
+	size += g_list_length(contact->addresses) * sizeof(RmContactAddress);
+
+	if (contact->image) {
+		size += gdk_pixbuf_get_byte_length(contact->image);
+	}
+
+	return size;
+}
+
+/**
+ * rm_addressbook_get_cache_stats:
+ * @stats: pointer to store statistics in
+ *
+ * Get statistics of address book lookup cache.
+ */
+void rm_addressbook_get_cache_stats(RmCacheStats *stats)
+{
+	if (!rm_addressbook_cache) {
+		memset(stats, 0, sizeof(RmCacheStats));
+		return;
+	}
+
+	rm_cache_get_stats(rm_addressbook_cache, stats);
 }
 
 /**
@@ -255,8 +707,14 @@ void rm_addressbook_register(RmAddressBook *book)
 	rm_addressbook_plugins = g_list_prepend(rm_addressbook_plugins, book);
 
 	if (!rm_addressbook_contact_process_id) {
-		rm_addressbook_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, rm_addressbook_table_free);
-		rm_addressbook_contact_process_id = g_signal_connect(G_OBJECT(rm_object), "contact-process", G_CALLBACK(rm_addressbook_contact_process_cb), NULL);
+		rm_addressbook_cache = rm_cache_new(RM_ADDRESSBOOK_CACHE_ENTRIES, RM_ADDRESSBOOK_CACHE_MEMORY, (GBoxedCopyFunc)g_object_ref, g_object_unref, rm_addressbook_cache_size);
+		rm_cache_set_ttl(rm_addressbook_cache, RM_ADDRESSBOOK_CACHE_POSITIVE_TTL, RM_ADDRESSBOOK_CACHE_NEGATIVE_TTL);
+		rm_addressbook_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_ptr_array_unref);
+		rm_addressbook_index_suffix = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_ptr_array_unref);
+		rm_addressbook_index_base = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_ptr_array_unref);
+		rm_addressbook_index_contacts = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_ptr_array_unref);
+		rm_addressbook_contact_process_id = g_signal_connect(G_OBJECT(rm_object), "contact-process::single", G_CALLBACK(rm_addressbook_contact_process_cb), NULL);
+		rm_addressbook_contacts_process_id = g_signal_connect(G_OBJECT(rm_object), "contacts-process", G_CALLBACK(rm_addressbook_contacts_process_cb), NULL);
 		rm_addressbook_contacts_changed_id = g_signal_connect(G_OBJECT(rm_object), "contacts-changed", G_CALLBACK(rm_addressbook_contacts_changed_cb), NULL);
 	}
 }
@@ -273,9 +731,22 @@ void rm_addressbook_unregister(RmAddressBook *book)
 
 	if (g_list_length(rm_addressbook_plugins) < 1) {
 		g_signal_handler_disconnect(G_OBJECT(rm_object), rm_addressbook_contact_process_id);
+		g_signal_handler_disconnect(G_OBJECT(rm_object), rm_addressbook_contacts_process_id);
 		g_signal_handler_disconnect(G_OBJECT(rm_object), rm_addressbook_contacts_changed_id);
-		g_hash_table_destroy(rm_addressbook_table);
-		rm_addressbook_table = NULL;
+		rm_addressbook_contact_process_id = 0;
+		rm_addressbook_contacts_process_id = 0;
+		rm_addressbook_contacts_changed_id = 0;
+		rm_cache_free(rm_addressbook_cache);
+		rm_addressbook_cache = NULL;
+		g_hash_table_destroy(rm_addressbook_index);
+		rm_addressbook_index = NULL;
+		g_hash_table_destroy(rm_addressbook_index_suffix);
+		rm_addressbook_index_suffix = NULL;
+		g_hash_table_destroy(rm_addressbook_index_base);
+		rm_addressbook_index_base = NULL;
+		g_hash_table_destroy(rm_addressbook_index_contacts);
+		rm_addressbook_index_contacts = NULL;
+		rm_addressbook_index_book = NULL;
 	}
 }
 
@@ -24,6 +24,7 @@
 #error "Only <rm/rm.h> can be included directly."
 #endif
 
+#include <rm/rmcache.h>
 #include <rm/rmcontact.h>
 
 G_BEGIN_DECLS
@@ -57,6 +58,8 @@ gchar *rm_addressbook_get_sub_name(RmAddressBook *book);
 gchar **rm_addressbook_get_sub_books(RmAddressBook *book);
 void rm_addressbook_set_sub_book(RmAddressBook *book, gchar *name);
 GList *rm_addressbook_get_plugins(void);
+guint rm_addressbook_get_fuzzy_matches(void);
+void rm_addressbook_get_cache_stats(RmCacheStats *stats);
 
 G_END_DECLS
 
@@ -0,0 +1,272 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <rm/rmcache.h>
+
+/**
+ * SECTION:rmcache
+ * @title: RmCache
+ * @short_description: Bounded lookup cache
+ *
+ * Thread safe least recently used cache with separate time to live values for positive and
+ * negative (%NULL value) entries and memory accounting.
+ */
+
+/**
+ * RmCacheEntry:
+ *
+ * Cache entry, linked in lru queue
+ */
+typedef struct {
+	GList link;
+	gchar *key;
+	gpointer value;
+	gint64 expires;
+	gsize size;
+} RmCacheEntry;
+
+/**
+ * rm_cache_entry_free:
+ * @cache: a #RmCache
+ * @entry: a #RmCacheEntry
+ *
+ * Remove @entry from lru queue and free it. Hash table entry must be removed by caller.
+ */
+static void rm_cache_entry_free(RmCache *cache, RmCacheEntry *entry)
+{
+	g_queue_unlink(&cache->lru, &entry->link);
+
+	cache->stats.entries--;
+	cache->stats.memory -= entry->size;
+
+	if (entry->value && cache->value_destroy) {
+		cache->value_destroy(entry->value);
+	}
+
+	g_free(entry->key);
+	g_slice_free(RmCacheEntry, entry);
+}
+
+/**
+ * rm_cache_remove_entry:
+ * @cache: a #RmCache
+ * @entry: a #RmCacheEntry
+ *
+ * Remove @entry from cache.
+ */
+static void rm_cache_remove_entry(RmCache *cache, RmCacheEntry *entry)
+{
+	g_hash_table_remove(cache->table, entry->key);
+	rm_cache_entry_free(cache, entry);
+}
+
+/**
+ * rm_cache_new:
+ * @max_entries: maximum number of entries
+ * @max_memory: maximum estimated memory of all entries in bytes, 0 for no limit
+ * @value_copy: function to copy values on lookup, or %NULL to return cached value itself
+ * @value_destroy: function to free values, or %NULL
+ * @value_size: function estimating memory of values, or %NULL
+ *
+ * Create a new cache. Time to live is unlimited until set with rm_cache_set_ttl().
+ *
+ * Returns: new #RmCache
+ */
+RmCache *rm_cache_new(guint max_entries, gsize max_memory, GBoxedCopyFunc value_copy, GDestroyNotify value_destroy, RmCacheSizeFunc value_size)
+{
+	RmCache *cache = g_slice_new0(RmCache);
+
+	g_mutex_init(&cache->lock);
+	cache->table = g_hash_table_new(g_str_hash, g_str_equal);
+	g_queue_init(&cache->lru);
+
+	cache->max_entries = max_entries;
+	cache->max_memory = max_memory;
+	cache->value_copy = value_copy;
+	cache->value_destroy = value_destroy;
+	cache->value_size = value_size;
+
+	return cache;
+}
+
+/**
+ * rm_cache_free:
+ * @cache: a #RmCache
+ *
+ * Free @cache including all entries.
+ */
+void rm_cache_free(RmCache *cache)
+{
+	if (!cache) {
+		return;
+	}
+
+	rm_cache_remove_all(cache);
+
+	g_hash_table_destroy(cache->table);
+	g_mutex_clear(&cache->lock);
+
+	g_slice_free(RmCache, cache);
+}
+
+/**
+ * rm_cache_set_ttl:
+ * @cache: a #RmCache
+ * @positive_ttl: time to live of entries with value in seconds, 0 for unlimited
+ * @negative_ttl: time to live of entries without value in seconds, 0 for unlimited
+ *
+ * Set time to live of new entries.
+ */
+void rm_cache_set_ttl(RmCache *cache, guint positive_ttl, guint negative_ttl)
+{
+	g_mutex_lock(&cache->lock);
+	cache->positive_ttl = (gint64)positive_ttl * G_USEC_PER_SEC;
+	cache->negative_ttl = (gint64)negative_ttl * G_USEC_PER_SEC;
+	g_mutex_unlock(&cache->lock);
+}
+
+/**
+ * rm_cache_lookup:
+ * @cache: a #RmCache
+ * @key: key to lookup
+ * @value: pointer to store value in (copied if cache has a copy function), %NULL for negative entries
+ *
+ * Lookup @key in @cache. Expired entries are dropped.
+ *
+ * Returns: %TRUE if a valid (positive or negative) entry is present, otherwise %FALSE
+ */
+gboolean rm_cache_lookup(RmCache *cache, const gchar *key, gpointer *value)
+{
+	RmCacheEntry *entry;
+
+	*value = NULL;
+
+	g_mutex_lock(&cache->lock);
+
+	entry = g_hash_table_lookup(cache->table, key);
+	if (entry && entry->expires && entry->expires < g_get_monotonic_time()) {
+		cache->stats.expirations++;
+		rm_cache_remove_entry(cache, entry);
+		entry = NULL;
+	}
+
+	if (!entry) {
+		cache->stats.misses++;
+		g_mutex_unlock(&cache->lock);
+
+		return FALSE;
+	}
+
+	cache->stats.hits++;
+
+	/* Move to head of lru queue */
+	g_queue_unlink(&cache->lru, &entry->link);
+	g_queue_push_head_link(&cache->lru, &entry->link);
+
+	if (entry->value) {
+		*value = cache->value_copy ? cache->value_copy(entry->value) : entry->value;
+	}
+
+	g_mutex_unlock(&cache->lock);
+
+	return TRUE;
+}
+
+/**
+ * rm_cache_insert:
+ * @cache: a #RmCache
+ * @key: key of entry
+ * @value: value (transfer full), or %NULL for a negative entry
+ *
+ * Insert or replace entry of @key. Least recently used entries are evicted if limits are exceeded.
+ */
+void rm_cache_insert(RmCache *cache, const gchar *key, gpointer value)
+{
+	RmCacheEntry *entry;
+	gint64 ttl;
+
+	g_mutex_lock(&cache->lock);
+
+	entry = g_hash_table_lookup(cache->table, key);
+	if (entry) {
+		rm_cache_remove_entry(cache, entry);
+	}
+
+	entry = g_slice_new0(RmCacheEntry);
+	entry->link.data = entry;
+	entry->key = g_strdup(key);
+	entry->value = value;
+	entry->size = sizeof(RmCacheEntry) + strlen(key) + 1;
+	if (value && cache->value_size) {
+		entry->size += cache->value_size(value);
+	}
+
+	ttl = value ? cache->positive_ttl : cache->negative_ttl;
+	entry->expires = ttl ? g_get_monotonic_time() + ttl : 0;
+
+	g_hash_table_insert(cache->table, entry->key, entry);
+	g_queue_push_head_link(&cache->lru, &entry->link);
+
+	cache->stats.entries++;
+	cache->stats.memory += entry->size;
+
+	/* Evict least recently used entries, but keep the new one */
+	while (cache->lru.length > 1 && (cache->lru.length > cache->max_entries || (cache->max_memory && cache->stats.memory > cache->max_memory))) {
+		cache->stats.evictions++;
+		rm_cache_remove_entry(cache, cache->lru.tail->data);
+	}
+
+	g_mutex_unlock(&cache->lock);
+}
+
+/**
+ * rm_cache_remove_all:
+ * @cache: a #RmCache
+ *
+ * Remove all entries of @cache. Statistics are kept.
+ */
+void rm_cache_remove_all(RmCache *cache)
+{
+	g_mutex_lock(&cache->lock);
+
+	g_hash_table_remove_all(cache->table);
+	while (cache->lru.head) {
+		rm_cache_entry_free(cache, cache->lru.head->data);
+	}
+
+	g_mutex_unlock(&cache->lock);
+}
+
+/**
+ * rm_cache_get_stats:
+ * @cache: a #RmCache
+ * @stats: pointer to store statistics in
+ *
+ * Get statistics of @cache.
+ */
+void rm_cache_get_stats(RmCache *cache, RmCacheStats *stats)
+{
+	g_mutex_lock(&cache->lock);
+	*stats = cache->stats;
+	g_mutex_unlock(&cache->lock);
+}
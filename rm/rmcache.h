@@ -0,0 +1,95 @@
+/*
+ * The rm project
+ * Copyright (c) 2012-2017 Jan-Michael Brummer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __RM_CACHE_H__
+#define __RM_CACHE_H__
+
+#if !defined (__RM_H_INSIDE__) && !defined(RM_COMPILATION)
+#error "Only <rm/rm.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * RmCacheSizeFunc:
+ * @value: cached value
+ *
+ * Estimates memory used by @value
+ *
+ * Returns: size of @value in bytes
+ */
+typedef gsize (*RmCacheSizeFunc)(gconstpointer value);
+
+/**
+ * RmCacheStats:
+ * @hits: number of successful lookups
+ * @misses: number of lookups without a (valid) entry
+ * @evictions: number of entries dropped due to size limits
+ * @expirations: number of entries dropped due to their age
+ * @entries: current number of entries
+ * @memory: estimated memory used by current entries
+ *
+ * Cache statistics
+ */
+typedef struct {
+	guint hits;
+	guint misses;
+	guint evictions;
+	guint expirations;
+	guint entries;
+	gsize memory;
+} RmCacheStats;
+
+/**
+ * RmCache:
+ *
+ * The #RmCache-struct contains only private fileds and should not be directly accessed.
+ */
+typedef struct {
+	/*< private >*/
+	GMutex lock;
+	GHashTable *table;
+	/* Entries, most recently used first */
+	GQueue lru;
+
+	guint max_entries;
+	gsize max_memory;
+	gint64 positive_ttl;
+	gint64 negative_ttl;
+
+	GBoxedCopyFunc value_copy;
+	GDestroyNotify value_destroy;
+	RmCacheSizeFunc value_size;
+
+	RmCacheStats stats;
+} RmCache;
+
+RmCache *rm_cache_new(guint max_entries, gsize max_memory, GBoxedCopyFunc value_copy, GDestroyNotify value_destroy, RmCacheSizeFunc value_size);
+void rm_cache_free(RmCache *cache);
+void rm_cache_set_ttl(RmCache *cache, guint positive_ttl, guint negative_ttl);
+gboolean rm_cache_lookup(RmCache *cache, const gchar *key, gpointer *value);
+void rm_cache_insert(RmCache *cache, const gchar *key, gpointer value);
+void rm_cache_remove_all(RmCache *cache);
+void rm_cache_get_stats(RmCache *cache, RmCacheStats *stats);
+
+G_END_DECLS
+
+#endif
@@ -17,6 +17,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -36,6 +37,49 @@
  * Call entry keeps track of all call entries.
  */
 
+/** Julian day (as used by #GDate) of 01.01.1970 */
+#define RM_CALL_ENTRY_JULIAN_EPOCH 719163
+
+/**
+ * rm_call_entry_parse_date_time:
+ * @date_time: date and time string in the form "dd.mm.yy hh:mm" (time and century are optional)
+ *
+ * Converts a journal date/time string into a numeric timestamp, so entries can be sorted and
+ * filtered using integer compares.
+ *
+ * Returns: seconds since 01.01.1970 00:00 of the given wall clock time, or 0 if @date_time is invalid
+ */
+gint64 rm_call_entry_parse_date_time(const gchar *date_time)
+{
+	GDate date;
+	gint day;
+	gint month;
+	gint year;
+	gint hour = 0;
+	gint minute = 0;
+
+	if (RM_EMPTY_STRING(date_time)) {
+		return 0;
+	}
+
+	if (sscanf(date_time, "%d.%d.%d %d:%d", &day, &month, &year, &hour, &minute) < 3) {
+		return 0;
+	}
+
+	if (year < 100) {
+		year += 2000;
+	}
+
+	if (!g_date_valid_dmy(day, month, year) || hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+		return 0;
+	}
+
+	g_date_clear(&date, 1);
+	g_date_set_dmy(&date, day, month, year);
+
+	return ((gint64)g_date_get_julian(&date) - RM_CALL_ENTRY_JULIAN_EPOCH) * 86400 + hour * 3600 + minute * 60;
+}
+
 /**
  * rm_call_entry_new:
  * @type: call entry type
@@ -61,11 +105,11 @@ RmCallEntry *rm_call_entry_new(RmCallEntryTypes type, const gchar *date_time, co
 	/* Set entries */
 	call_entry->type = type;
 	call_entry->date_time = date_time ? g_strdup(date_time) : g_strdup("");
-	call_entry->remote = g_slice_new0(RmContact);
-	call_entry->remote->image = NULL;
+	call_entry->timestamp = rm_call_entry_parse_date_time(call_entry->date_time);
+	call_entry->remote = rm_contact_new();
 	call_entry->remote->name = remote_name ? rm_convert_utf8(remote_name, -1) : g_strdup("");
 	call_entry->remote->number = remote_number ? g_strdup(remote_number) : g_strdup("");
-	call_entry->local = g_slice_new0(RmContact);
+	call_entry->local = rm_contact_new();
 	call_entry->local->name = local_name ? rm_convert_utf8(local_name, -1) : g_strdup("");
 	call_entry->local->number = local_number ? g_strdup(local_number) : g_strdup("");
 	call_entry->duration = duration ? g_strdup(duration) : g_strdup("");
@@ -110,18 +154,11 @@ RmCallEntry *rm_call_entry_dup (RmCallEntry *src)
 	/* Set entries */
 	call_entry->type = src->type;
 	call_entry->date_time = g_strdup(src->date_time);
-	call_entry->remote = g_slice_new0(RmContact);
-	call_entry->remote->image = NULL;
-	call_entry->remote->name = g_strdup (src->remote->name);
-	call_entry->remote->number = g_strdup(src->remote->number);
-	call_entry->local = g_slice_new0(RmContact);
-	call_entry->local->name = g_strdup (src->local->name);
-	call_entry->local->number = g_strdup (src->local->number);
+	call_entry->timestamp = src->timestamp;
+	/* Contacts are shared, use rm_contact_make_writable() before modifying them */
+	call_entry->remote = g_object_ref(src->remote);
+	call_entry->local = g_object_ref(src->local);
 	call_entry->duration = g_strdup (src->duration);
-
-	/* Extended */
-	call_entry->remote->company = g_strdup("");
-	call_entry->remote->city = g_strdup("");
 	call_entry->priv = src->priv;
 
 	return call_entry;
@@ -64,6 +64,8 @@ typedef struct {
 	/*< private >*/
 	RmCallEntryTypes type;
 	gchar *date_time;
+	/* date_time as seconds since 01.01.1970 00:00 (wall clock), 0 if unknown */
+	gint64 timestamp;
 	gchar *duration;
 
 	RmContact *remote;
@@ -76,6 +78,7 @@ typedef struct {
 RmCallEntry *rm_call_entry_new(RmCallEntryTypes type, const gchar *date_time, const gchar *remote_name, const gchar *remote_number, const gchar *local_name, const gchar *local_number, const gchar *duration, gpointer priv);
 void rm_call_entry_free(gpointer data);
 RmCallEntry *rm_call_entry_dup (RmCallEntry *src);
+gint64 rm_call_entry_parse_date_time(const gchar *date_time);
 
 G_END_DECLS
 
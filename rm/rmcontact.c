@@ -34,6 +34,14 @@ G_DEFINE_TYPE(RmContact, rm_contact, G_TYPE_OBJECT);
  * @short_description: Contact handling functions
  *
  * Contacts represents entries within an address book.
+ *
+ * Contacts are reference counted. A contact reachable from more than one owner (e.g. call entries
+ * created by rm_call_entry_dup() or the address book lookup cache) must be treated as immutable, use
+ * rm_contact_make_writable() to get a private copy before modifying it.
+ *
+ * Resolvers follow this as well: contacts-process handlers replace entries of the array instead of
+ * writing to them, contact-process handlers and lookup providers fill in a contact which has been made
+ * writable by the emitter.
  */
 
 /**
@@ -151,7 +159,8 @@ void rm_contact_copy(RmContact *src, RmContact *dst)
 	dst->name = g_strdup(src->name);
 
 	if (src->image) {
-		dst->image = gdk_pixbuf_copy(src->image);
+		/* Pixbufs are never modified in place, share it */
+		dst->image = g_object_ref(src->image);
 	} else {
 		dst->image = NULL;
 	}
@@ -187,13 +196,37 @@ void rm_contact_copy(RmContact *src, RmContact *dst)
  */
 RmContact *rm_contact_dup(RmContact *src)
 {
-	RmContact *dst = g_slice_new0(RmContact);
+	RmContact *dst = rm_contact_new();
 
 	rm_contact_copy(src, dst);
 
 	return dst;
 }
 
+/**
+ * rm_contact_make_writable:
+ * @contact: (transfer full): a #RmContact
+ *
+ * Copy-on-write helper. Takes over the reference of @contact and returns a contact which is exclusively
+ * owned by the caller. If @contact is not shared it is returned as is, otherwise a copy is returned and
+ * the reference to @contact is dropped.
+ *
+ * Returns: (transfer full): a #RmContact which can be modified
+ */
+RmContact *rm_contact_make_writable(RmContact *contact)
+{
+	RmContact *copy;
+
+	if (g_atomic_int_get(&G_OBJECT(contact)->ref_count) == 1) {
+		return contact;
+	}
+
+	copy = rm_contact_dup(contact);
+	g_object_unref(contact);
+
+	return copy;
+}
+
 /**
  * rm_contact_name_compare:
  * @a: pointer to first #RmContact
@@ -217,17 +250,17 @@ gint rm_contact_name_compare(gconstpointer a, gconstpointer b)
  *
  * Try to find a contact by it's number
  *
- * Returns: a #RmContact if number has been found, or %NULL% if not.
+ * Returns: a #RmContact if number has been found, or %NULL% if not. Release it with rm_contact_free().
  */
 RmContact *rm_contact_find_by_number(gchar *number)
 {
-	RmContact *contact = g_slice_new0(RmContact);
+	RmContact *contact = rm_contact_new();
 	GList *numbers;
 	GList *addresses;
 	gint type = -1;
 
 	/** Ask for contact information */
-	contact->number = number;
+	contact->number = g_strdup(number);
 	rm_object_emit_contact_process(contact);
 
 	/* Depending on the number set the active address */
@@ -274,15 +307,14 @@ RmContact *rm_contact_find_by_number(gchar *number)
 }
 
 /**
- * rm_contact_free:
- * @contact: a #RmContact
+ * rm_contact_finalize:
+ * @object: a #RmContact
  *
- * Frees a #RmContact.
+ * Frees contact data once the last reference is dropped.
  */
-void rm_contact_free(RmContact *contact)
+static void rm_contact_finalize(GObject *object)
 {
-	if (!contact)
-		return;
+	RmContact *contact = RM_CONTACT(object);
 
 	g_clear_pointer(&contact->name, g_free);
 	g_clear_pointer(&contact->company, g_free);
@@ -290,16 +322,30 @@ void rm_contact_free(RmContact *contact)
 	g_clear_pointer(&contact->street, g_free);
 	g_clear_pointer(&contact->zip, g_free);
 	g_clear_pointer(&contact->city, g_free);
-	if (contact->image) {
-		g_object_unref(contact->image);
-	}
+	g_clear_object(&contact->image);
 
 	if (contact->addresses) {
-		g_list_free_full(contact->addresses, rm_contact_free_address);
+		g_list_free_full(g_steal_pointer(&contact->addresses), rm_contact_free_address);
 	}
 	if (contact->numbers) {
-		g_list_free_full(contact->numbers, rm_contact_free_number);
+		g_list_free_full(g_steal_pointer(&contact->numbers), rm_contact_free_number);
 	}
+
+	G_OBJECT_CLASS(rm_contact_parent_class)->finalize(object);
+}
+
+/**
+ * rm_contact_free:
+ * @contact: a #RmContact
+ *
+ * Drops a reference of a #RmContact, contact data is freed with the last reference.
+ */
+void rm_contact_free(RmContact *contact)
+{
+	if (!contact)
+		return;
+
+	g_object_unref(contact);
 }
 
 /**
@@ -327,14 +373,24 @@ void rm_contact_set_image_from_file(RmContact *contact, gchar *file)
 
 static void rm_contact_class_init(RmContactClass *klass)
 {
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
+
+	object_class->finalize = rm_contact_finalize;
 }
 
 static void rm_contact_init(RmContact *widget)
 {
 }
 
-GObject *rm_contact_new(void)
+/**
+ * rm_contact_new:
+ *
+ * Creates a new empty #RmContact.
+ *
+ * Returns: (transfer full): new #RmContact, release with rm_contact_free()
+ */
+RmContact *rm_contact_new(void)
 {
-        return g_object_new(RM_TYPE_CONTACT, NULL);
+	return g_object_new(RM_TYPE_CONTACT, NULL);
 }
 
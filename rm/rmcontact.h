@@ -82,8 +82,10 @@ struct _RmContact {
 
 G_DECLARE_FINAL_TYPE(RmContact, rm_contact, RM, CONTACT, GObject)
 
+RmContact *rm_contact_new(void);
 void rm_contact_copy(RmContact *src, RmContact *dst);
 RmContact *rm_contact_dup(RmContact *src);
+RmContact *rm_contact_make_writable(RmContact *contact);
 gint rm_contact_name_compare(gconstpointer a, gconstpointer b);
 RmContact *rm_contact_find_by_number(gchar *number);
 void rm_contact_free(RmContact *contact);
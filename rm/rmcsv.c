@@ -36,6 +36,303 @@
  * CSV files are used for journals and address book plugins.
  */
 
+/** Size of chunks read from input streams */
+#define RM_CSV_CHUNK_SIZE 16384
+
+/**
+ * RmCsvState:
+ * @RM_CSV_STATE_SEPARATOR: optional "sep=" line expected
+ * @RM_CSV_STATE_HEADER: header line expected
+ * @RM_CSV_STATE_DATA: data lines
+ * @RM_CSV_STATE_INVALID: header mismatch, remaining data is ignored
+ *
+ * Parser state
+ */
+typedef enum {
+	RM_CSV_STATE_SEPARATOR,
+	RM_CSV_STATE_HEADER,
+	RM_CSV_STATE_DATA,
+	RM_CSV_STATE_INVALID
+} RmCsvState;
+
+/**
+ * RmCsvParser:
+ *
+ * Incremental csv parser. Complete records are tokenized in place within @buffer, so fields are
+ * handed out as slices without further allocations.
+ */
+typedef struct {
+	GByteArray *buffer;
+	GArray *fields;
+	const gchar * const *headers;
+	gint *dialect;
+	RmCsvParseLineFunc csv_parse_line;
+	gpointer ptr;
+	RmCsvState state;
+	gchar sep;
+} RmCsvParser;
+
+/**
+ * rm_csv_parser_init:
+ * @parser: a #RmCsvParser
+ * @headers: %NULL terminated array of accepted header lines
+ * @dialect: pointer to store index of matching header in, or %NULL
+ * @csv_parse_line: a function pointer
+ * @ptr: user pointer
+ *
+ * Initialize @parser.
+ */
+static void rm_csv_parser_init(RmCsvParser *parser, const gchar * const *headers, gint *dialect, RmCsvParseLineFunc csv_parse_line, gpointer ptr)
+{
+	parser->buffer = g_byte_array_new();
+	parser->fields = g_array_sized_new(FALSE, FALSE, sizeof(RmCsvField), 16);
+	parser->headers = headers;
+	parser->dialect = dialect;
+	parser->csv_parse_line = csv_parse_line;
+	parser->ptr = ptr;
+	parser->state = RM_CSV_STATE_SEPARATOR;
+	parser->sep = ',';
+}
+
+/**
+ * rm_csv_parser_clear:
+ * @parser: a #RmCsvParser
+ *
+ * Free internal buffers of @parser.
+ *
+ * Returns: user pointer or %NULL if header did not match
+ */
+static gpointer rm_csv_parser_clear(RmCsvParser *parser)
+{
+	g_byte_array_free(parser->buffer, TRUE);
+	g_array_free(parser->fields, TRUE);
+
+	if (parser->state != RM_CSV_STATE_DATA) {
+		return NULL;
+	}
+
+	return parser->ptr;
+}
+
+/**
+ * rm_csv_parser_find_record:
+ * @parser: a #RmCsvParser
+ * @data: data to scan
+ * @len: length of @data
+ * @eof: whether there is no more data after @data
+ *
+ * Find end of first record within @data. Line breaks within quoted fields are part of the record.
+ *
+ * Returns: length of record including line terminator, or 0 if more data is needed
+ */
+static gsize rm_csv_parser_find_record(RmCsvParser *parser, const gchar *data, gsize len, gboolean eof)
+{
+	gboolean quoted = FALSE;
+	gboolean field_start = TRUE;
+	gsize idx;
+
+	for (idx = 0; idx < len; idx++) {
+		gchar c = data[idx];
+
+		if (quoted) {
+			if (c == '"') {
+				if (idx + 1 == len && !eof) {
+					/* Could be an escaped quote */
+					return 0;
+				}
+
+				if (idx + 1 < len && data[idx + 1] == '"') {
+					idx++;
+				} else {
+					quoted = FALSE;
+				}
+			}
+			continue;
+		}
+
+		if (c == '\n') {
+			return idx + 1;
+		}
+
+		/* Quotes are only special at the beginning of a field */
+		if (c == '"' && field_start) {
+			quoted = TRUE;
+		}
+
+		field_start = c == parser->sep;
+	}
+
+	return eof ? len : 0;
+}
+
+/**
+ * rm_csv_parser_tokenize:
+ * @parser: a #RmCsvParser
+ * @record: record data without line terminator, followed by a writable byte
+ * @len: length of @record
+ *
+ * Split @record into fields. Quoted fields are unescaped in place and each field is NUL terminated.
+ */
+static void rm_csv_parser_tokenize(RmCsvParser *parser, gchar *record, gsize len)
+{
+	gchar *pos = record;
+	gchar *end = record + len;
+
+	g_array_set_size(parser->fields, 0);
+
+	while (TRUE) {
+		RmCsvField field;
+		gchar *out = pos;
+
+		field.str = pos;
+
+		if (*pos == '"') {
+			pos++;
+
+			while (pos < end) {
+				if (*pos == '"') {
+					if (pos + 1 == end || pos[1] != '"') {
+						pos++;
+						break;
+					}
+
+					pos++;
+				}
+
+				*out++ = *pos++;
+			}
+
+			/* Keep characters between closing quote and separator */
+			while (pos < end && *pos != parser->sep) {
+				*out++ = *pos++;
+			}
+		} else {
+			while (pos < end && *pos != parser->sep) {
+				pos++;
+			}
+			out = pos;
+		}
+
+		field.len = out - field.str;
+		g_array_append_val(parser->fields, field);
+
+		if (pos == end) {
+			*out = '\0';
+			break;
+		}
+
+		*out = '\0';
+		pos++;
+	}
+}
+
+/**
+ * rm_csv_parser_record:
+ * @parser: a #RmCsvParser
+ * @record: record data including line terminator, followed by a writable byte
+ * @len: length of @record
+ */
+static void rm_csv_parser_record(RmCsvParser *parser, gchar *record, gsize len)
+{
+	gchar *pos;
+
+	/* Strip LF/CRLF */
+	if (len && record[len - 1] == '\n') {
+		len--;
+	}
+	if (len && record[len - 1] == '\r') {
+		len--;
+	}
+	record[len] = '\0';
+
+	switch (parser->state) {
+	case RM_CSV_STATE_SEPARATOR:
+		parser->state = RM_CSV_STATE_HEADER;
+
+		/* Check for separator */
+		pos = g_strstr_len(record, len, "sep=");
+		if (pos && pos[4] != '\0') {
+			parser->sep = pos[4];
+			break;
+		}
+		/* fall through */
+	case RM_CSV_STATE_HEADER: {
+		gint idx;
+
+		/* Check header against all known dialects */
+		for (idx = 0; parser->headers[idx]; idx++) {
+			if (!strncmp(record, parser->headers[idx], strlen(parser->headers[idx]))) {
+				break;
+			}
+		}
+
+		if (!parser->headers[idx]) {
+			g_debug("%s(): Unknown CSV-Header = '%s'", __FUNCTION__, record);
+			parser->state = RM_CSV_STATE_INVALID;
+			break;
+		}
+
+		if (parser->dialect) {
+			*parser->dialect = idx;
+		}
+
+		parser->state = RM_CSV_STATE_DATA;
+		break;
+	}
+	case RM_CSV_STATE_DATA:
+		if (!len) {
+			break;
+		}
+
+		rm_csv_parser_tokenize(parser, record, len);
+		parser->ptr = parser->csv_parse_line(parser->ptr, (RmCsvField*)parser->fields->data, parser->fields->len);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * rm_csv_parser_feed:
+ * @parser: a #RmCsvParser
+ * @data: data chunk
+ * @len: length of @data
+ * @eof: whether @data is the last chunk
+ *
+ * Append @data to parser buffer and process all complete records.
+ *
+ * Returns: %TRUE if parsing should continue, %FALSE on header mismatch
+ */
+static gboolean rm_csv_parser_feed(RmCsvParser *parser, const gchar *data, gsize len, gboolean eof)
+{
+	gchar *buffer;
+	gsize buffer_len;
+	gsize offset = 0;
+	gsize record_len;
+
+	g_byte_array_append(parser->buffer, (const guint8*)data, len);
+
+	/* Terminating byte, allows NUL termination of the last field in place */
+	buffer_len = parser->buffer->len;
+	g_byte_array_append(parser->buffer, (const guint8*)"", 1);
+	buffer = (gchar*)parser->buffer->data;
+
+	while (offset < buffer_len && parser->state != RM_CSV_STATE_INVALID) {
+		record_len = rm_csv_parser_find_record(parser, buffer + offset, buffer_len - offset, eof);
+		if (!record_len) {
+			break;
+		}
+
+		rm_csv_parser_record(parser, buffer + offset, record_len);
+		offset += record_len;
+	}
+
+	g_byte_array_set_size(parser->buffer, buffer_len);
+	g_byte_array_remove_range(parser->buffer, 0, offset);
+
+	return parser->state != RM_CSV_STATE_INVALID;
+}
+
 /**
  * rm_csv_parse_data:
  * @data: raw data to parse
@@ -43,53 +340,74 @@
  * @csv_parse_line: a function pointer
  * @ptr: user pointer
  *
- * Parse data as csv.
+ * Parse data as csv. Fields may be quoted according to RFC 4180, lines may end with LF or CRLF.
  *
- * Returns: user pointer
+ * Returns: user pointer or %NULL if header did not match
  */
 gpointer rm_csv_parse_data(const gchar *data, const gchar *header, RmCsvParseLineFunc csv_parse_line, gpointer ptr)
 {
-	gint index = 0;
-	gchar sep[2];
-	gchar **lines = NULL;
-	gchar *pos;
-	gpointer data_ptr = ptr;
+	const gchar *headers[] = { header, NULL };
+
+	return rm_csv_parse_data_full(data, headers, NULL, csv_parse_line, ptr);
+}
+
+/**
+ * rm_csv_parse_data_full:
+ * @data: raw data to parse
+ * @headers: %NULL terminated array of accepted header lines
+ * @dialect: pointer to store index of matching header in, or %NULL
+ * @csv_parse_line: a function pointer
+ * @ptr: user pointer
+ *
+ * Parse data as csv with one of several header dialects. The header is detected once, @dialect is
+ * set before the first line is passed to @csv_parse_line.
+ *
+ * Returns: user pointer or %NULL if no header did match
+ */
+gpointer rm_csv_parse_data_full(const gchar *data, const gchar * const *headers, gint *dialect, RmCsvParseLineFunc csv_parse_line, gpointer ptr)
+{
+	RmCsvParser parser;
 
 	/* Safety check */
 	g_assert(data != NULL);
 
-	/* Split data to lines */
-	lines = g_strsplit(data, "\n", -1);
-
-	/* Check for separator */
-	pos = g_strstr_len(lines[index], -1, "sep=");
-	if (pos) {
-		sep[0] = pos[4];
-		index++;
-	} else {
-		sep[0] = ',';
-	}
-	sep[1] = '\0';
+	rm_csv_parser_init(&parser, headers, dialect, csv_parse_line, ptr);
+	rm_csv_parser_feed(&parser, data, strlen(data), TRUE);
 
-	/* Check header */
-	if (strncmp(lines[index], header, strlen(header))) {
-		g_debug("%s(): Unknown CSV-Header = '%s'", __FUNCTION__, lines[index]);
-		data_ptr = NULL;
-		goto end;
-	}
+	return rm_csv_parser_clear(&parser);
+}
 
-	/* Parse each line, split it and use parse function */
-	while (lines[++index] != NULL) {
-		gchar **split = g_strsplit(lines[index], sep, -1);
+/**
+ * rm_csv_parse_stream:
+ * @stream: a #GInputStream
+ * @header: expected header line
+ * @csv_parse_line: a function pointer
+ * @ptr: user pointer
+ * @cancellable: a #GCancellable or %NULL
+ * @error: a #GError or %NULL
+ *
+ * Parse @stream as csv chunk by chunk, see rm_csv_parse_data().
+ *
+ * Returns: user pointer or %NULL if header did not match or reading failed
+ */
+gpointer rm_csv_parse_stream(GInputStream *stream, const gchar *header, RmCsvParseLineFunc csv_parse_line, gpointer ptr, GCancellable *cancellable, GError **error)
+{
+	RmCsvParser parser;
+	const gchar *headers[] = { header, NULL };
+	gchar chunk[RM_CSV_CHUNK_SIZE];
+	gssize len;
 
-		data_ptr = csv_parse_line(data_ptr, split);
+	g_return_val_if_fail(G_IS_INPUT_STREAM(stream), NULL);
 
-		g_strfreev(split);
-	}
+	rm_csv_parser_init(&parser, headers, NULL, csv_parse_line, ptr);
 
- end:
-	g_strfreev(lines);
+	do {
+		len = g_input_stream_read(stream, chunk, sizeof(chunk), cancellable, error);
+		if (len < 0) {
+			rm_csv_parser_clear(&parser);
+			return NULL;
+		}
+	} while (rm_csv_parser_feed(&parser, chunk, len, len == 0) && len > 0);
 
-	/* Return ptr */
-	return data_ptr;
+	return rm_csv_parser_clear(&parser);
 }
@@ -24,20 +24,37 @@
 #error "Only <rm/rm.h> can be included directly."
 #endif
 
+#include <gio/gio.h>
+
 G_BEGIN_DECLS
 
+/**
+ * RmCsvField:
+ * @str: field content, unquoted and NUL terminated
+ * @len: length of @str
+ *
+ * A single csv field. It points into the parser buffer and is only valid within #RmCsvParseLineFunc.
+ */
+typedef struct {
+	const gchar *str;
+	gsize len;
+} RmCsvField;
+
 /**
  * RmCsvParseLineFunc:
  * @ptr: pointer to csv data
- * @split: string array
+ * @fields: fields of current line
+ * @count: number of @fields
  *
  * Parses a line within csv data
  *
  * Returns: new pointer to parsed data
  */
-typedef gpointer (*RmCsvParseLineFunc)(gpointer ptr, gchar **split);
+typedef gpointer (*RmCsvParseLineFunc)(gpointer ptr, const RmCsvField *fields, guint count);
 
 gpointer rm_csv_parse_data(const gchar *data, const gchar *header, RmCsvParseLineFunc csv_parse_line, gpointer ptr);
+gpointer rm_csv_parse_data_full(const gchar *data, const gchar * const *headers, gint *dialect, RmCsvParseLineFunc csv_parse_line, gpointer ptr);
+gpointer rm_csv_parse_stream(GInputStream *stream, const gchar *header, RmCsvParseLineFunc csv_parse_line, gpointer ptr, GCancellable *cancellable, GError **error);
 
 G_END_DECLS
 
@@ -32,48 +32,122 @@
  * Offers convenient file loading and storing functionallity
  */
 
+/** Attempts to find an unused temporary file name */
+#define RM_FILE_TEMP_ATTEMPTS 10
+
 /**
- * rm_file_save:
+ * rm_file_create_temp:
+ * @name: file name the temporary file is meant for
+ * @temp: return location for the temporary #GFile
+ * @error: return location for a #GError, or %NULL
+ *
+ * Create a private temporary file next to @name, so it can be renamed onto @name.
+ *
+ * Returns: output stream of @temp or %NULL on error
+ */
+static GFileOutputStream *rm_file_create_temp(const gchar *name, GFile **temp, GError **error)
+{
+	gint attempt;
+
+	for (attempt = 0; attempt < RM_FILE_TEMP_ATTEMPTS; attempt++) {
+		gchar *temp_name = g_strdup_printf("%s.%08x", name, g_random_int());
+		GFileOutputStream *stream;
+		GError *create_error = NULL;
+
+		*temp = g_file_new_for_path(temp_name);
+		g_free(temp_name);
+
+		stream = g_file_create(*temp, G_FILE_CREATE_PRIVATE, NULL, &create_error);
+		if (stream) {
+			return stream;
+		}
+
+		g_clear_object(temp);
+
+		if (!g_error_matches(create_error, G_IO_ERROR, G_IO_ERROR_EXISTS) || attempt == RM_FILE_TEMP_ATTEMPTS - 1) {
+			g_propagate_error(error, create_error);
+			break;
+		}
+
+		g_error_free(create_error);
+	}
+
+	return NULL;
+}
+
+/**
+ * rm_file_save_full:
  * @name: file name
  * @data: data pointer
  * @len: length of data
+ * @error: return location for a #GError, or %NULL
  *
- * Save @data of length @len to file @name.
+ * Save @data of length @len to file @name. The data is written to a temporary file which is
+ * renamed onto @name, so @name is replaced atomically and never left incomplete.
+ *
+ * Returns: %TRUE if @data has been saved completely, otherwise %FALSE
  */
-void rm_file_save(gchar *name, const gchar *data, gsize len)
+gboolean rm_file_save_full(gchar *name, const gchar *data, gsize len, GError **error)
 {
-	GFile *file = g_file_new_for_path(name);
-	GError *error = NULL;
+	GFile *temp = NULL;
 	GFileOutputStream *stream;
+	gchar *dirname;
+	gboolean ret = FALSE;
 
-	if (!data) {
-		g_warning("%s(): data is NULL", __FUNCTION__);
-		return;
-	}
+	g_return_val_if_fail(data != NULL, FALSE);
 
 	if (len == -1) {
 		len = strlen(data);
 	}
 
-	if (g_file_query_exists(file, NULL)) {
-		stream = g_file_replace(file, NULL, FALSE, G_FILE_CREATE_PRIVATE, NULL, &error);
-	} else {
-		gchar *dirname = g_path_get_dirname(name);
-		g_mkdir_with_parents(dirname, 0700);
-		g_free(dirname);
+	dirname = g_path_get_dirname(name);
+	g_mkdir_with_parents(dirname, 0700);
+	g_free(dirname);
 
-		stream = g_file_create(file, G_FILE_CREATE_PRIVATE, NULL, &error);
+	stream = rm_file_create_temp(name, &temp, error);
+	if (!stream) {
+		return FALSE;
 	}
 
-	g_object_unref(file);
+	if (g_output_stream_write_all(G_OUTPUT_STREAM(stream), data, len, NULL, NULL, error) &&
+	    g_output_stream_close(G_OUTPUT_STREAM(stream), NULL, error)) {
+		GFile *file = g_file_new_for_path(name);
 
-	if (stream != NULL) {
-		g_output_stream_write(G_OUTPUT_STREAM(stream), data, len, NULL, NULL);
-		g_output_stream_flush(G_OUTPUT_STREAM(stream), NULL, NULL);
+		ret = g_file_move(temp, file, G_FILE_COPY_OVERWRITE | G_FILE_COPY_NO_FALLBACK_FOR_MOVE, NULL, NULL, NULL, error);
+		g_object_unref(file);
+	}
+
+	/* Drop the incomplete temporary file, the old file stays untouched */
+	if (!ret) {
 		g_output_stream_close(G_OUTPUT_STREAM(stream), NULL, NULL);
+		g_file_delete(temp, NULL, NULL);
+	}
+
+	g_object_unref(stream);
+
+	g_object_unref(temp);
+
+	return ret;
+}
+
+/**
+ * rm_file_save:
+ * @name: file name
+ * @data: data pointer
+ * @len: length of data
+ *
+ * Save @data of length @len to file @name.
+ */
+void rm_file_save(gchar *name, const gchar *data, gsize len)
+{
+	GError *error = NULL;
+
+	if (!data) {
+		g_warning("%s(): data is NULL", __FUNCTION__);
+		return;
+	}
 
-		g_object_unref(stream);
-	} else {
+	if (!rm_file_save_full(name, data, len, &error)) {
 		g_warning("%s", error->message);
 		g_error_free(error);
 	}
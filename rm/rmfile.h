@@ -27,6 +27,7 @@
 G_BEGIN_DECLS
 
 void rm_file_save(gchar *name, const gchar *data, gsize len);
+gboolean rm_file_save_full(gchar *name, const gchar *data, gsize len, GError **error);
 gchar *rm_file_load(gchar *name, gsize *size);
 
 G_END_DECLS
@@ -137,10 +137,8 @@ gboolean rm_filter_rule_match(RmFilter *filter, RmCallEntry *call)
 
 			break;
 		case RM_FILTER_DATE_TIME: {
-			/* Date/Time */
-			gchar *number_a = rule->entry;
-			gchar *number_b = call->date_time;
-			gint ret = 0;
+			/* Date/Time, compared on day granularity */
+			gint64 call_day = call->timestamp / 86400;
 
 			if (!rule->entry) {
 				break;
@@ -150,74 +148,24 @@ gboolean rm_filter_rule_match(RmFilter *filter, RmCallEntry *call)
 
 			switch (rule->sub_type) {
 			case RM_FILTER_IS:
-				/* Compare year */
-				ret = strncmp(number_a + 6, number_b + 6, 2);
-				if (ret == 0) {
-					/* Compare month */
-					ret = strncmp(number_a + 3, number_b + 3, 2);
-					if (ret == 0) {
-						/* Compare day */
-						ret = strncmp(number_a, number_b, 2);
-						if (ret == 0) {
-							dates_valid++;
-						}
-					}
+				if (call_day == rule->day) {
+					dates_valid++;
 				}
 				break;
 			case RM_FILTER_IS_NOT:
-				/* Compare year */
-				ret = strncmp(number_a + 6, number_b + 6, 2);
-				if (ret == 0) {
-					/* Compare month */
-					ret = strncmp(number_a + 3, number_b + 3, 2);
-					if (ret == 0) {
-						/* Compare day */
-						ret = strncmp(number_a, number_b, 2);
-						if (ret != 0) {
-							dates_valid++;
-						}
-					} else {
-						dates_valid++;
-					}
-				} else {
+				if (call_day != rule->day) {
 					dates_valid++;
 				}
 				break;
 			case RM_FILTER_STARTS_WITH:
-				/* Compare year */
-				ret = strncmp(number_a + 6, number_b + 6, 2);
-				if (ret >= 0) {
-					/* Compare month */
-					ret = strncmp(number_a + 3, number_b + 3, 2);
-					if (ret >= 0) {
-						/* Compare day */
-						ret = strncmp(number_a, number_b, 2);
-						if (ret < 0) {
-							dates_valid++;
-						}
-					} else {
-						dates_valid++;
-					}
-				} else {
+				/* Call is after date */
+				if (call_day > rule->day) {
 					dates_valid++;
 				}
 				break;
 			case RM_FILTER_CONTAINS:
-				/* Compare year */
-				ret = strncmp(number_a + 6, number_b + 6, 2);
-				if (ret <= 0) {
-					/* Compare month */
-					ret = strncmp(number_a + 3, number_b + 3, 2);
-					if (ret <= 0) {
-						/* Compare day */
-						ret = strncmp(number_a, number_b, 2);
-						if (ret < 0) {
-							dates_valid++;
-						}
-					} else {
-						dates_valid++;
-					}
-				} else {
+				/* Call is before date */
+				if (call_day < rule->day) {
 					dates_valid++;
 				}
 				break;
@@ -309,6 +257,7 @@ void rm_filter_rule_add(RmFilter *filter, gint type, gint sub_type, gchar *entry
 	rule->type = type;
 	rule->sub_type = sub_type;
 	rule->entry = g_strdup(entry);
+	rule->day = type == RM_FILTER_DATE_TIME ? rm_call_entry_parse_date_time(entry) / 86400 : 0;
 
 	filter->rules = g_list_append(filter->rules, rule);
 }
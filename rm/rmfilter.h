@@ -63,6 +63,8 @@ typedef struct {
 	gint type;
 	gint sub_type;
 	gchar *entry;
+	/* Day of entry for RM_FILTER_DATE_TIME rules (see rm_call_entry_parse_date_time()) */
+	gint64 day;
 } RmFilterRule;
 
 /**
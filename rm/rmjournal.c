@@ -20,8 +20,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 
 #include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
 
 #include <rm/rmcsv.h>
 #include <rm/rmcallentry.h>
@@ -43,6 +46,51 @@
 /** This is our private header, not the one used by the router! */
 #define RM_JOURNAL_HEADER "Typ;Datum;Name;Rufnummer;Nebenstelle;Eigene Rufnummer;Dauer"
 
+/**
+ * Binary journal store: file header followed by appended records. Records are never changed in place,
+ * a voice/fax upgrade of a stored call is appended as update record of the same call and merged into
+ * it again on load.
+ */
+#define RM_JOURNAL_STORE_MAGIC "RMJRNL01"
+#define RM_JOURNAL_STORE_MAGIC_LEN 8
+#define RM_JOURNAL_STORE_FILE "journal.db"
+/** Suffix an unreadable journal store is renamed to */
+#define RM_JOURNAL_STORE_BAD_SUFFIX ".bad"
+/** Minimum number of update records before the store is compacted */
+#define RM_JOURNAL_STORE_COMPACT_MIN 64
+
+/** String fields of a journal store record */
+enum {
+	RM_JOURNAL_FIELD_DATE_TIME,
+	RM_JOURNAL_FIELD_REMOTE_NAME,
+	RM_JOURNAL_FIELD_REMOTE_NUMBER,
+	RM_JOURNAL_FIELD_LOCAL_NAME,
+	RM_JOURNAL_FIELD_LOCAL_NUMBER,
+	RM_JOURNAL_FIELD_DURATION,
+	RM_JOURNAL_FIELD_MAX
+};
+
+/** Record flag: string table is followed by the NUL terminated private data (voice/fax file name) */
+#define RM_JOURNAL_RECORD_FLAG_PRIV (1 << 0)
+
+/**
+ * RmJournalRecord:
+ *
+ * Fixed size record header (little endian) of the binary journal store. It is followed by a string
+ * table holding all fields (NUL terminated, in field order) and padding up to @size.
+ */
+typedef struct {
+	/* Size of record including header, string table and padding (multiple of 8) */
+	guint32 size;
+	guint32 type;
+	gint64 timestamp;
+	/* String lengths without NUL */
+	guint16 lengths[RM_JOURNAL_FIELD_MAX];
+	guint32 flags;
+} RmJournalRecord;
+
+G_STATIC_ASSERT(sizeof(RmJournalRecord) == 32);
+
 /**
  * rm_journal_save_as:
  * @journal: journal list pointer
@@ -94,17 +142,270 @@ gboolean rm_journal_save_as(GList *journal, gchar *file_name)
 	return TRUE;
 }
 
+/**
+ * rm_journal_store_persistent:
+ * @call: a #RmCallEntry
+ *
+ * Checks whether @call is kept in the local journal store. Fax report and record entries refer to
+ * local files and are rebuilt on every refresh.
+ *
+ * Returns: %TRUE if call is stored locally, otherwise %FALSE
+ */
+static inline gboolean rm_journal_store_persistent(RmCallEntry *call)
+{
+	return call->type != RM_CALL_ENTRY_TYPE_FAX_REPORT && call->type != RM_CALL_ENTRY_TYPE_RECORD;
+}
+
+/**
+ * rm_journal_store_add_record:
+ * @buffer: a #GByteArray to append record to
+ * @call: a #RmCallEntry
+ *
+ * Serialize @call as journal store record.
+ */
+static void rm_journal_store_add_record(GByteArray *buffer, RmCallEntry *call)
+{
+	static const guint8 padding[8] = { 0 };
+	const gchar *fields[RM_JOURNAL_FIELD_MAX];
+	gsize lengths[RM_JOURNAL_FIELD_MAX];
+	RmJournalRecord record;
+	gsize size = sizeof(record);
+	gsize priv_len = 0;
+	gsize padded;
+	gint idx;
+
+	fields[RM_JOURNAL_FIELD_DATE_TIME] = call->date_time;
+	fields[RM_JOURNAL_FIELD_REMOTE_NAME] = call->remote->name;
+	fields[RM_JOURNAL_FIELD_REMOTE_NUMBER] = call->remote->number;
+	fields[RM_JOURNAL_FIELD_LOCAL_NAME] = call->local->name;
+	fields[RM_JOURNAL_FIELD_LOCAL_NUMBER] = call->local->number;
+	fields[RM_JOURNAL_FIELD_DURATION] = call->duration;
+
+	memset(&record, 0, sizeof(record));
+
+	for (idx = 0; idx < RM_JOURNAL_FIELD_MAX; idx++) {
+		if (!fields[idx]) {
+			fields[idx] = "";
+		}
+
+		lengths[idx] = MIN(strlen(fields[idx]), G_MAXUINT16);
+		record.lengths[idx] = GUINT16_TO_LE(lengths[idx]);
+		size += lengths[idx] + 1;
+	}
+
+	if (!RM_EMPTY_STRING(call->priv)) {
+		priv_len = strlen(call->priv);
+		size += priv_len + 1;
+		record.flags = GUINT32_TO_LE(RM_JOURNAL_RECORD_FLAG_PRIV);
+	}
+
+	padded = (size + 7) & ~7;
+
+	record.size = GUINT32_TO_LE(padded);
+	record.type = GUINT32_TO_LE(call->type);
+	record.timestamp = GINT64_TO_LE(call->timestamp);
+
+	g_byte_array_append(buffer, (const guint8*)&record, sizeof(record));
+
+	for (idx = 0; idx < RM_JOURNAL_FIELD_MAX; idx++) {
+		g_byte_array_append(buffer, (const guint8*)fields[idx], lengths[idx]);
+		g_byte_array_append(buffer, padding, 1);
+	}
+
+	if (priv_len) {
+		g_byte_array_append(buffer, (const guint8*)call->priv, priv_len + 1);
+	}
+
+	g_byte_array_append(buffer, padding, padded - size);
+}
+
+/**
+ * rm_journal_store_write:
+ * @journal: journal list
+ * @file_name: journal store file name
+ * @error: a #GError
+ *
+ * Write a complete journal store, replacing the previous one atomically.
+ *
+ * Returns: %TRUE on success, otherwise %FALSE
+ */
+static gboolean rm_journal_store_write(GList *journal, const gchar *file_name, GError **error)
+{
+	GByteArray *buffer = g_byte_array_new();
+	GList *list;
+	gboolean ret;
+
+	g_byte_array_append(buffer, (const guint8*)RM_JOURNAL_STORE_MAGIC, RM_JOURNAL_STORE_MAGIC_LEN);
+
+	for (list = journal; list != NULL; list = list->next) {
+		RmCallEntry *call = list->data;
+
+		if (rm_journal_store_persistent(call)) {
+			rm_journal_store_add_record(buffer, call);
+		}
+	}
+
+	ret = g_file_set_contents(file_name, (const gchar*)buffer->data, buffer->len, error);
+
+	g_byte_array_free(buffer, TRUE);
+
+	return ret;
+}
+
+/**
+ * rm_journal_store_append:
+ * @buffer: serialized records
+ * @file_name: journal store file name
+ * @error: a #GError
+ *
+ * Append records to an existing journal store. A partially written record is detected and
+ * dropped on next read.
+ *
+ * Returns: %TRUE on success, otherwise %FALSE
+ */
+static gboolean rm_journal_store_append(GByteArray *buffer, const gchar *file_name, GError **error)
+{
+	FILE *file;
+	gboolean ret;
+
+	if (!buffer->len) {
+		return TRUE;
+	}
+
+	file = fopen(file_name, "ab");
+	if (!file) {
+		gint saved_errno = errno;
+
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno), "Could not open journal store %s: %s", file_name, g_strerror(saved_errno));
+		return FALSE;
+	}
+
+	ret = fwrite(buffer->data, 1, buffer->len, file) == buffer->len;
+	ret &= fclose(file) == 0;
+
+	if (!ret) {
+		gint saved_errno = errno;
+
+		g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno), "Could not append to journal store %s: %s", file_name, g_strerror(saved_errno));
+	}
+
+	return ret;
+}
+
+/**
+ * rm_journal_store_read:
+ * @journal: a #RmJournal
+ * @file_name: journal store file name
+ * @valid: pointer to store whether the store can be appended to as is
+ * @error: a #GError
+ *
+ * Map journal store into memory and add all records to @journal. The store is reported as not
+ * @valid if it ends with a truncated or broken record, or if update records make up a large part
+ * of it and it should be compacted.
+ *
+ * Returns: %TRUE if journal store could be read, otherwise %FALSE and @error is set
+ */
+static gboolean rm_journal_store_read(RmJournal *journal, const gchar *file_name, gboolean *valid, GError **error)
+{
+	GMappedFile *map;
+	const gchar *data;
+	gsize len;
+	gsize offset;
+	guint records = 0;
+	guint updates = 0;
+
+	*valid = FALSE;
+
+	map = g_mapped_file_new(file_name, FALSE, error);
+	if (!map) {
+		return FALSE;
+	}
+
+	data = g_mapped_file_get_contents(map);
+	len = g_mapped_file_get_length(map);
+
+	if (len < RM_JOURNAL_STORE_MAGIC_LEN || memcmp(data, RM_JOURNAL_STORE_MAGIC, RM_JOURNAL_STORE_MAGIC_LEN)) {
+		g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Unknown journal store format in %s", file_name);
+		g_mapped_file_unref(map);
+		return FALSE;
+	}
+
+	for (offset = RM_JOURNAL_STORE_MAGIC_LEN; offset + sizeof(RmJournalRecord) <= len;) {
+		RmJournalRecord record;
+		const gchar *fields[RM_JOURNAL_FIELD_MAX];
+		const gchar *str = data + offset + sizeof(record);
+		const gchar *priv = NULL;
+		gsize size;
+		gsize used = sizeof(record);
+		RmCallEntry *call;
+		gint idx;
+
+		/* Mapping gives no alignment guarantee for the record header, copy it out */
+		memcpy(&record, data + offset, sizeof(record));
+		size = GUINT32_FROM_LE(record.size);
+
+		if (size < sizeof(record) || size > len - offset) {
+			break;
+		}
+
+		for (idx = 0; idx < RM_JOURNAL_FIELD_MAX; idx++) {
+			gsize field_len = GUINT16_FROM_LE(record.lengths[idx]);
+
+			if (used + field_len + 1 > size || str[field_len] != '\0') {
+				break;
+			}
+
+			fields[idx] = str;
+			str += field_len + 1;
+			used += field_len + 1;
+		}
+
+		if (idx != RM_JOURNAL_FIELD_MAX) {
+			break;
+		}
+
+		if (GUINT32_FROM_LE(record.flags) & RM_JOURNAL_RECORD_FLAG_PRIV) {
+			if (!memchr(str, '\0', size - used)) {
+				break;
+			}
+
+			priv = str;
+		}
+
+		call = rm_call_entry_new(GUINT32_FROM_LE(record.type), fields[RM_JOURNAL_FIELD_DATE_TIME], fields[RM_JOURNAL_FIELD_REMOTE_NAME],
+					 fields[RM_JOURNAL_FIELD_REMOTE_NUMBER], fields[RM_JOURNAL_FIELD_LOCAL_NAME], fields[RM_JOURNAL_FIELD_LOCAL_NUMBER],
+					 fields[RM_JOURNAL_FIELD_DURATION], g_strdup(priv));
+		if (!rm_journal_add(journal, call)) {
+			updates++;
+		}
+
+		records++;
+		offset += size;
+	}
+
+	*valid = offset == len;
+	g_mapped_file_unref(map);
+
+	if (updates >= RM_JOURNAL_STORE_COMPACT_MIN && updates * 4 >= records) {
+		g_debug("%s(): %u of %u records are updates, compacting store", __FUNCTION__, updates, records);
+		*valid = FALSE;
+	}
+
+	return TRUE;
+}
+
 /**
  * rm_journal_save:
  * @journal: journal list pointer
  *
- * Save journal to local storage.
+ * Save journal to local storage, replacing the complete journal store.
  *
  * Returns: %TRUE on success, otherwise %FALSE
  */
 gboolean rm_journal_save(GList *journal)
 {
 	RmProfile *profile = rm_profile_get_active();
+	GError *error = NULL;
 	gchar *dir;
 	gchar *file_name;
 	gboolean ret;
@@ -113,9 +414,13 @@ gboolean rm_journal_save(GList *journal)
 	dir = g_build_filename(rm_get_user_data_dir(), profile->name, NULL);
 	g_mkdir_with_parents(dir, 0700);
 
-	file_name = g_build_filename(dir, "journal.csv", NULL);
+	file_name = g_build_filename(dir, RM_JOURNAL_STORE_FILE, NULL);
 
-	ret = rm_journal_save_as(journal, file_name);
+	ret = rm_journal_store_write(journal, file_name, &error);
+	if (!ret) {
+		g_warning("%s(): Could not write journal store: %s", __FUNCTION__, error->message);
+		g_error_free(error);
+	}
 
 	g_free(dir);
 	g_free(file_name);
@@ -126,67 +431,163 @@ gboolean rm_journal_save(GList *journal)
 /**
  * rm_journal_csv_parse_rm:
  * @ptr: pointer to journal
- * @split: splitted line
+ * @fields: fields of current line
+ * @count: number of fields
  *
  * Parse rm csv.
  *
  * Returns: pointer to journal with attached call line
  */
-static inline gpointer rm_journal_csv_parse_rm(gpointer ptr, gchar **split)
+static inline gpointer rm_journal_csv_parse_rm(gpointer ptr, const RmCsvField *fields, guint count)
 {
-	GList *list = ptr;
+	RmJournal *journal = ptr;
 
-	if (g_strv_length(split) == 7) {
-		RmCallEntry *call = rm_call_entry_new(atoi(split[0]), split[1], split[2], split[3], split[4], split[5], split[6], NULL);
+	if (count == 7) {
+		RmCallEntry *call = rm_call_entry_new(atoi(fields[0].str), fields[1].str, fields[2].str, fields[3].str, fields[4].str, fields[5].str, fields[6].str, NULL);
 
-		list = rm_journal_add_call_entry(list, call);
+		rm_journal_add(journal, call);
 	}
 
-	return list;
+	return journal;
 }
 
 /**
- * rm_journal_csv_parse:
- * @list: journal list
- * @data: raw data to parse
+ * rm_journal_migrate:
+ * @journal: a #RmJournal
+ * @dir: profile data directory
  *
- * Parse journal data as csv.
+ * Add calls of an old journal.csv (if present) to @journal. The caller writes a new journal store
+ * afterwards, so this happens only once.
+ */
+static void rm_journal_migrate(RmJournal *journal, const gchar *dir)
+{
+	gchar *csv_name = g_build_filename(dir, "journal.csv", NULL);
+	GFile *csv_file = g_file_new_for_path(csv_name);
+	GFileInputStream *stream = g_file_read(csv_file, NULL, NULL);
+
+	if (stream) {
+		g_debug("%s(): Migrating %s", __FUNCTION__, csv_name);
+		rm_csv_parse_stream(G_INPUT_STREAM(stream), RM_JOURNAL_HEADER, rm_journal_csv_parse_rm, journal, NULL, NULL);
+		g_object_unref(stream);
+	}
+
+	g_object_unref(csv_file);
+
+	g_free(csv_name);
+}
+
+/**
+ * rm_journal_has_store:
+ * @profile: a #RmProfile
+ *
+ * Checks whether a local journal store exists for @profile. Router plugins can use this to decide
+ * whether an incremental journal update is sufficient.
  *
- * Returns: new journal call list
+ * Returns: %TRUE if local journal store is present, otherwise %FALSE
  */
-static GList *rm_journal_csv_parse(GList *list, const gchar *data)
+gboolean rm_journal_has_store(RmProfile *profile)
 {
-	list = rm_csv_parse_data(data, RM_JOURNAL_HEADER, rm_journal_csv_parse_rm, list);
+	gchar *file_name;
+	gboolean ret;
 
-	/* Return call list */
-	return list;
+	if (!profile) {
+		return FALSE;
+	}
+
+	file_name = g_build_filename(rm_get_user_data_dir(), profile->name, RM_JOURNAL_STORE_FILE, NULL);
+	ret = g_file_test(file_name, G_FILE_TEST_EXISTS);
+	g_free(file_name);
+
+	return ret;
 }
 
 /**
  * rm_journal_load:
  * @journal: list pointer to fill
+ * @error: a #GError
+ *
+ * Load saved journal and merge it into @journal. The list passed in is consumed. Calls of @journal
+ * which are not stored yet are appended to the local journal store, so the cost of a refresh
+ * depends on the number of new calls only.
  *
- * Load saved journal
+ * If the journal store could not be read or updated, @error is set and callers must not treat the
+ * new calls as persisted. A store which exists but cannot be read is never replaced: it is left in
+ * place if mapping fails, or renamed to journal.db.bad if its format is unknown. In that case the
+ * returned list holds the calls of @journal only.
  *
  * Returns: filled journal list
  */
-GList *rm_journal_load(GList *journal)
+GList *rm_journal_load(GList *journal, GError **error)
 {
-	gchar *file_name;
-	gchar *file_data;
-	GList *list = journal;
 	RmProfile *profile = rm_profile_get_active();
+	RmJournal *container;
+	GByteArray *buffer;
+	GList *list;
+	gchar *dir;
+	gchar *file_name;
+	gboolean valid = FALSE;
+	gboolean readable = TRUE;
+	GError *read_error = NULL;
 
-	file_name = g_build_filename(rm_get_user_data_dir(), profile->name, "journal.csv", NULL);
-	file_data = rm_file_load(file_name, NULL);
-	g_free(file_name);
+	dir = g_build_filename(rm_get_user_data_dir(), profile->name, NULL);
+	g_mkdir_with_parents(dir, 0700);
+	file_name = g_build_filename(dir, RM_JOURNAL_STORE_FILE, NULL);
 
-	if (file_data) {
-		list = rm_journal_csv_parse(journal, file_data);
-		g_free(file_data);
+	/* Load history first, through the hash indexed container duplicate detection is O(1) per call */
+	container = rm_journal_new();
+
+	if (!g_file_test(file_name, G_FILE_TEST_EXISTS)) {
+		/* No store yet, start over from journal.csv */
+		rm_journal_migrate(container, dir);
+	} else if (!rm_journal_store_read(container, file_name, &valid, &read_error)) {
+		/* Never write over a store we could not read, it may still hold the whole history */
+		g_warning("%s(): Could not read journal store: %s", __FUNCTION__, read_error->message);
+		readable = FALSE;
+
+		if (g_error_matches(read_error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA)) {
+			gchar *bad_name = g_strconcat(file_name, RM_JOURNAL_STORE_BAD_SUFFIX, NULL);
+
+			/* Move it aside, next refresh starts with a new store */
+			if (g_rename(file_name, bad_name)) {
+				g_warning("%s(): Could not rename journal store to %s: %s", __FUNCTION__, bad_name, g_strerror(errno));
+			}
+
+			g_free(bad_name);
+		}
+
+		g_propagate_error(error, read_error);
 	}
 
-	return list;
+	/* Merge new calls and collect those we need to append */
+	buffer = g_byte_array_new();
+
+	for (list = journal; list != NULL; list = list->next) {
+		RmCallEntry *call = list->data;
+
+		/* Either a new call or a voice/fax upgrade of a known one: both are appended, an upgrade
+		 * is merged into the stored call by rm_journal_add() when the store is read again */
+		if (rm_journal_store_persistent(call) && !rm_journal_contains(container, call)) {
+			rm_journal_store_add_record(buffer, call);
+		}
+
+		rm_journal_add(container, call);
+	}
+	g_list_free(journal);
+
+	if (readable && valid) {
+		rm_journal_store_append(buffer, file_name, error);
+	} else if (readable) {
+		/* Store is missing, broken (e.g. truncated write) or needs compaction, rewrite it from what we have got */
+		list = rm_journal_get_list(container);
+		rm_journal_store_write(list, file_name, error);
+		g_list_free(list);
+	}
+
+	g_byte_array_free(buffer, TRUE);
+	g_free(file_name);
+	g_free(dir);
+
+	return rm_journal_steal_list(container);
 }
 
 
@@ -195,55 +596,47 @@ GList *rm_journal_load(GList *journal)
  * @a: a #RmCallEntry
  * @b: a #RmCallEntry
  *
- * Sort journal calls (compares two calls based on date/time).
+ * Sort journal calls (compares two calls based on their timestamp, newest first).
  *
- * Returns: see strncmp
+ * Returns: negative value if @a is newer than @b, 0 if equal, positive value otherwise
  */
 gint rm_journal_sort_by_date(gconstpointer a, gconstpointer b)
 {
-	RmCallEntry *call_a = (RmCallEntry*)a;
-	RmCallEntry *call_b = (RmCallEntry*)b;
-	gchar *number_a = NULL;
-	gchar *number_b = NULL;
-	gchar part_time_a[7];
-	gchar part_time_b[7];
-	gint ret = 0;
+	const RmCallEntry *call_a = a;
+	const RmCallEntry *call_b = b;
 
 	if (!call_a || !call_b) {
 		return 0;
 	}
 
-	if (call_a) {
-		number_a = call_a->date_time;
-	}
-
-	if (call_b) {
-		number_b = call_b->date_time;
+	if (call_a->timestamp == call_b->timestamp) {
+		return 0;
 	}
 
-	/* Compare year */
-	ret = strncmp(number_a + 6, number_b + 6, 2);
-	if (ret == 0) {
-		/* Compare month */
-		ret = strncmp(number_a + 3, number_b + 3, 2);
-		if (ret == 0) {
-			/* Compare day */
-			ret = strncmp(number_a, number_b, 2);
-			if (ret == 0) {
-				/* Extract time */
-				memset(part_time_a, 0, sizeof(part_time_a));
-				g_strlcpy(part_time_a, number_a + 9, 6);
+	return call_a->timestamp > call_b->timestamp ? -1 : 1;
+}
 
-				/* Extract time */
-				memset(part_time_b, 0, sizeof(part_time_b));
-				g_strlcpy(part_time_b, number_b + 9, 6);
+/**
+ * rm_journal_entry_same_call:
+ * @a: a #RmCallEntry
+ * @b: a #RmCallEntry
+ *
+ * Checks whether @a and @b have been placed at the same time from/to the same remote number.
+ * Entries without a valid timestamp fall back to a date/time string compare.
+ *
+ * Returns: %TRUE if the calls match, otherwise %FALSE
+ */
+static inline gboolean rm_journal_entry_same_call(const RmCallEntry *a, const RmCallEntry *b)
+{
+	if (a->timestamp != b->timestamp) {
+		return FALSE;
+	}
 
-				ret = g_utf8_collate(part_time_a, part_time_b);
-			}
-		}
+	if (!a->timestamp && strcmp(a->date_time, b->date_time)) {
+		return FALSE;
 	}
 
-	return -ret;
+	return !strcmp(a->remote->number, b->remote->number);
 }
 
 /**
@@ -251,7 +644,8 @@ gint rm_journal_sort_by_date(gconstpointer a, gconstpointer b)
  * @journal: call list
  * @call: a #RmCallEntry
  *
- * Add call to journal
+ * Add call to journal. This scans the whole list for duplicates, use a #RmJournal
+ * when merging larger amounts of calls.
  *
  * Returns: new call list with appended call structure
  */
@@ -265,7 +659,7 @@ GList *rm_journal_add_call_entry(GList *journal, RmCallEntry *call)
 		journal_call = list->data;
 
 		/* Easier compare method, we are just interested in the complete date_time, remote_number and type field */
-		if (!strcmp(journal_call->date_time, call->date_time) && !strcmp(journal_call->remote->number, call->remote->number)) {
+		if (rm_journal_entry_same_call(journal_call, call)) {
 			if (journal_call->type == call->type) {
 				/* Call with the same type already exists, return unchanged journal */
 				rm_call_entry_free (call);
@@ -275,6 +669,7 @@ GList *rm_journal_add_call_entry(GList *journal, RmCallEntry *call)
 			/* Found same call with different type (voice/fax): merge them */
 			if (call->type == RM_CALL_ENTRY_TYPE_VOICE || call->type == RM_CALL_ENTRY_TYPE_FAX) {
 				journal_call->type = call->type;
+				g_free(journal_call->priv);
 				journal_call->priv = g_strdup (call->priv);
 
 				rm_call_entry_free (call);
@@ -290,6 +685,310 @@ GList *rm_journal_add_call_entry(GList *journal, RmCallEntry *call)
 	return list;
 }
 
+/**
+ * rm_journal_entry_hash:
+ * @key: a #RmCallEntry
+ *
+ * Hash a call entry on its duplicate relevant fields (timestamp, remote number and type).
+ *
+ * Returns: hash value
+ */
+static guint rm_journal_entry_hash(gconstpointer key)
+{
+	const RmCallEntry *call = key;
+	guint hash;
+
+	hash = g_int64_hash(&call->timestamp);
+	hash = hash * 31 + g_str_hash(call->remote->number);
+	hash = hash * 31 + call->type;
+
+	return hash;
+}
+
+/**
+ * rm_journal_entry_equal:
+ * @a: a #RmCallEntry
+ * @b: a #RmCallEntry
+ *
+ * Checks whether two call entries describe the same call.
+ *
+ * Returns: %TRUE if both are equal, otherwise %FALSE
+ */
+static gboolean rm_journal_entry_equal(gconstpointer a, gconstpointer b)
+{
+	const RmCallEntry *call_a = a;
+	const RmCallEntry *call_b = b;
+
+	return call_a->type == call_b->type && rm_journal_entry_same_call(call_a, call_b);
+}
+
+/**
+ * rm_journal_entry_lookup:
+ * @journal: a #RmJournal
+ * @call: a #RmCallEntry providing date/time and remote number
+ * @type: call type to look for
+ *
+ * Lookup a journal call matching @call with given @type.
+ *
+ * Returns: matching #RmCallEntry or %NULL
+ */
+static RmCallEntry *rm_journal_entry_lookup(RmJournal *journal, RmCallEntry *call, RmCallEntryTypes type)
+{
+	RmCallEntry probe;
+
+	probe.type = type;
+	probe.date_time = call->date_time;
+	probe.timestamp = call->timestamp;
+	probe.remote = call->remote;
+
+	return g_hash_table_lookup(journal->index, &probe);
+}
+
+/**
+ * rm_journal_sort_entries_by_date:
+ * @a: pointer to a #RmCallEntry pointer
+ * @b: pointer to a #RmCallEntry pointer
+ *
+ * #GPtrArray variant of rm_journal_sort_by_date().
+ *
+ * Returns: see rm_journal_sort_by_date()
+ */
+static gint rm_journal_sort_entries_by_date(gconstpointer a, gconstpointer b)
+{
+	return rm_journal_sort_by_date(*(RmCallEntry**)a, *(RmCallEntry**)b);
+}
+
+/**
+ * rm_journal_sort:
+ * @journal: a #RmJournal
+ *
+ * Sort all calls of @journal by date (newest first) in one pass. Accessors call this
+ * implicitly, so a batch of additions is only sorted once.
+ */
+void rm_journal_sort(RmJournal *journal)
+{
+	g_return_if_fail(journal != NULL);
+
+	if (journal->sorted) {
+		return;
+	}
+
+	g_ptr_array_sort(journal->entries, rm_journal_sort_entries_by_date);
+	journal->sorted = TRUE;
+}
+
+/**
+ * rm_journal_new:
+ *
+ * Creates a new, empty #RmJournal. Duplicate detection is done using a hash index,
+ * sorting is deferred until entries are requested.
+ *
+ * Returns: new #RmJournal
+ */
+RmJournal *rm_journal_new(void)
+{
+	RmJournal *journal = g_slice_new0(RmJournal);
+
+	journal->entries = g_ptr_array_new_with_free_func(rm_call_entry_free);
+	journal->index = g_hash_table_new(rm_journal_entry_hash, rm_journal_entry_equal);
+	journal->sorted = TRUE;
+
+	return journal;
+}
+
+/**
+ * rm_journal_new_from_list:
+ * @list: journal list
+ *
+ * Creates a new #RmJournal and adds all calls of @list. The call entries are owned by the
+ * new journal afterwards and @list itself is freed.
+ *
+ * Returns: new #RmJournal
+ */
+RmJournal *rm_journal_new_from_list(GList *list)
+{
+	RmJournal *journal = rm_journal_new();
+	GList *iter;
+
+	for (iter = list; iter != NULL; iter = iter->next) {
+		rm_journal_add(journal, iter->data);
+	}
+
+	g_list_free(list);
+
+	return journal;
+}
+
+/**
+ * rm_journal_destroy:
+ * @journal: a #RmJournal
+ *
+ * Frees @journal including all of its call entries.
+ */
+void rm_journal_destroy(RmJournal *journal)
+{
+	if (!journal) {
+		return;
+	}
+
+	g_hash_table_destroy(journal->index);
+	g_ptr_array_free(journal->entries, TRUE);
+
+	g_slice_free(RmJournal, journal);
+}
+
+/**
+ * rm_journal_add:
+ * @journal: a #RmJournal
+ * @call: a #RmCallEntry
+ *
+ * Add @call to @journal. Ownership of @call is transferred to @journal: in case it is a duplicate
+ * or has been merged (voice/fax) into an existing call, @call is freed.
+ *
+ * Returns: %TRUE if @call has been added as new entry, otherwise %FALSE
+ */
+gboolean rm_journal_add(RmJournal *journal, RmCallEntry *call)
+{
+	RmCallEntry *journal_call;
+	gint type;
+
+	g_return_val_if_fail(journal != NULL, FALSE);
+	g_return_val_if_fail(call != NULL, FALSE);
+
+	/* Call with the same type already exists, keep journal unchanged */
+	if (g_hash_table_contains(journal->index, call)) {
+		rm_call_entry_free(call);
+		return FALSE;
+	}
+
+	/* Found same call with different type (voice/fax): merge them */
+	if (call->type == RM_CALL_ENTRY_TYPE_VOICE || call->type == RM_CALL_ENTRY_TYPE_FAX) {
+		for (type = RM_CALL_ENTRY_TYPE_INCOMING; type <= RM_CALL_ENTRY_TYPE_BLOCKED; type++) {
+			if (type == call->type) {
+				continue;
+			}
+
+			journal_call = rm_journal_entry_lookup(journal, call, type);
+			if (journal_call) {
+				/* Type is part of the hash key, so re-index the merged entry */
+				g_hash_table_remove(journal->index, journal_call);
+				journal_call->type = call->type;
+				g_free(journal_call->priv);
+				journal_call->priv = g_strdup(call->priv);
+				g_hash_table_add(journal->index, journal_call);
+
+				rm_call_entry_free(call);
+				return FALSE;
+			}
+		}
+	}
+
+	g_ptr_array_add(journal->entries, call);
+	g_hash_table_add(journal->index, call);
+	journal->sorted = FALSE;
+
+	return TRUE;
+}
+
+/**
+ * rm_journal_contains:
+ * @journal: a #RmJournal
+ * @call: a #RmCallEntry
+ *
+ * Checks whether a call with the same timestamp, remote number and type is already part of @journal.
+ *
+ * Returns: %TRUE if @call is known, otherwise %FALSE
+ */
+gboolean rm_journal_contains(RmJournal *journal, RmCallEntry *call)
+{
+	g_return_val_if_fail(journal != NULL, FALSE);
+	g_return_val_if_fail(call != NULL, FALSE);
+
+	return g_hash_table_contains(journal->index, call);
+}
+
+/**
+ * rm_journal_get_length:
+ * @journal: a #RmJournal
+ *
+ * Get number of calls within @journal.
+ *
+ * Returns: number of calls
+ */
+guint rm_journal_get_length(RmJournal *journal)
+{
+	return journal ? journal->entries->len : 0;
+}
+
+/**
+ * rm_journal_get_entry:
+ * @journal: a #RmJournal
+ * @index: index of call
+ *
+ * Get call at position @index (sorted by date, newest first).
+ *
+ * Returns: a #RmCallEntry owned by @journal or %NULL if out of range
+ */
+RmCallEntry *rm_journal_get_entry(RmJournal *journal, guint index)
+{
+	g_return_val_if_fail(journal != NULL, NULL);
+
+	if (index >= journal->entries->len) {
+		return NULL;
+	}
+
+	rm_journal_sort(journal);
+
+	return g_ptr_array_index(journal->entries, index);
+}
+
+/**
+ * rm_journal_get_list:
+ * @journal: a #RmJournal
+ *
+ * Get sorted calls of @journal as list. The call entries are still owned by @journal, free the list with #g_list_free.
+ *
+ * Returns: new journal list
+ */
+GList *rm_journal_get_list(RmJournal *journal)
+{
+	GList *list = NULL;
+	guint index;
+
+	g_return_val_if_fail(journal != NULL, NULL);
+
+	rm_journal_sort(journal);
+
+	for (index = journal->entries->len; index > 0; index--) {
+		list = g_list_prepend(list, g_ptr_array_index(journal->entries, index - 1));
+	}
+
+	return list;
+}
+
+/**
+ * rm_journal_steal_list:
+ * @journal: a #RmJournal
+ *
+ * Converts @journal into a sorted journal list. Ownership of all call entries is transferred to the list
+ * and @journal is freed.
+ *
+ * Returns: journal list, free with rm_journal_free()
+ */
+GList *rm_journal_steal_list(RmJournal *journal)
+{
+	GList *list;
+
+	g_return_val_if_fail(journal != NULL, NULL);
+
+	list = rm_journal_get_list(journal);
+
+	g_ptr_array_set_free_func(journal->entries, NULL);
+	rm_journal_destroy(journal);
+
+	return list;
+}
+
 static gpointer copy_journal_data(gconstpointer src, gpointer data)
 {
 	return rm_call_entry_dup ((RmCallEntry *)src);
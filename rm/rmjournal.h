@@ -28,10 +28,36 @@
 
 G_BEGIN_DECLS
 
+/**
+ * RmJournal:
+ *
+ * The #RmJournal-struct contains only private fileds and should not be directly accessed.
+ */
+typedef struct {
+	/*< private >*/
+	/* Call entries, sorted by date on demand */
+	GPtrArray *entries;
+	/* Duplicate index: (timestamp, remote number, type) -> #RmCallEntry */
+	GHashTable *index;
+	gboolean sorted;
+} RmJournal;
+
+RmJournal *rm_journal_new(void);
+RmJournal *rm_journal_new_from_list(GList *list);
+void rm_journal_destroy(RmJournal *journal);
+gboolean rm_journal_add(RmJournal *journal, RmCallEntry *call);
+gboolean rm_journal_contains(RmJournal *journal, RmCallEntry *call);
+void rm_journal_sort(RmJournal *journal);
+guint rm_journal_get_length(RmJournal *journal);
+RmCallEntry *rm_journal_get_entry(RmJournal *journal, guint index);
+GList *rm_journal_get_list(RmJournal *journal);
+GList *rm_journal_steal_list(RmJournal *journal);
+
 GList *rm_journal_add_call_entry(GList *journal, RmCallEntry *call);
 gboolean rm_journal_save_as(GList *journal, gchar *file_name);
 gboolean rm_journal_save(GList *journal);
-GList *rm_journal_load(GList *journal);
+GList *rm_journal_load(GList *journal, GError **error);
+gboolean rm_journal_has_store(RmProfile *profile);
 gint rm_journal_sort_by_date(gconstpointer a, gconstpointer b);
 GList *rm_journal_dup(GList *journal);
 void rm_journal_free(GList *journal);
@@ -17,11 +17,6 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-/**
- * TODO:
- *  - Asynchronous lookup
- */
-
 #include <string.h>
 
 #include <glib.h>
@@ -34,12 +29,100 @@
  * @short_description: Reverse lookup
  * @stability: Stable
  *
- * Reverse lookup of telephone numbers using online services
+ * Reverse lookup of telephone numbers using online services. All registered lookup plugins are queried
+ * concurrently, plugins implementing search_async() on the caller's main context, synchronous plugins in
+ * a small bounded worker pool. Concurrent lookups of the same number share a single set of requests.
  */
 
 /** Lookup function list */
 static GSList *rm_lookup_plugins = NULL;
 
+/**
+ * RmLookupState:
+ * @RM_LOOKUP_STATE_RUNNING: provider has not answered yet
+ * @RM_LOOKUP_STATE_FAILED: provider did not find the number
+ * @RM_LOOKUP_STATE_FOUND: provider found the number
+ *
+ * State of a provider within a lookup.
+ */
+typedef enum {
+	RM_LOOKUP_STATE_RUNNING,
+	RM_LOOKUP_STATE_FAILED,
+	RM_LOOKUP_STATE_FOUND
+} RmLookupState;
+
+/**
+ * RmLookupFlight:
+ *
+ * An in-flight lookup of a number shared by all concurrent callers. Provider state is only accessed from
+ * @context, waiter list and done flag are protected by rm_lookup_lock.
+ */
+typedef struct {
+	/*< private >*/
+	gint ref_count;
+	gchar *number;
+	GMainContext *context;
+	GCancellable *cancellable;
+	GList *waiters;
+	gboolean done;
+	/* Per provider RmLookup, result and RmLookupState */
+	GPtrArray *providers;
+	GPtrArray *results;
+	GArray *states;
+} RmLookupFlight;
+
+/**
+ * RmLookupWaiter:
+ *
+ * A caller waiting for the result of a #RmLookupFlight.
+ */
+typedef struct {
+	/*< private >*/
+	GTask *task;
+	GCancellable *cancellable;
+	gulong handler;
+	RmLookupFlight *flight;
+	gboolean cancelled;
+} RmLookupWaiter;
+
+/**
+ * RmLookupCall:
+ *
+ * A running provider request of a #RmLookupFlight.
+ */
+typedef struct {
+	/*< private >*/
+	RmLookupFlight *flight;
+	guint index;
+} RmLookupCall;
+
+/**
+ * RmLookupSync:
+ *
+ * Task data of a synchronous provider running in a worker thread.
+ */
+typedef struct {
+	/*< private >*/
+	RmLookup *lookup;
+	gchar *number;
+} RmLookupSync;
+
+/** Maximum number of concurrently running synchronous providers */
+#define RM_LOOKUP_SYNC_THREADS 2
+/** Maximum number of queued synchronous provider requests, further requests fail right away */
+#define RM_LOOKUP_SYNC_QUEUE 16
+
+/** Protects in-flight table, context table, waiters and worker pool creation */
+static GMutex rm_lookup_lock;
+/** Worker pool for synchronous providers */
+static GThreadPool *rm_lookup_sync_pool = NULL;
+/** In-flight lookups: number -> RmLookupFlight */
+static GHashTable *rm_lookup_flights = NULL;
+/** Number of unfinished flights per main context: GMainContext -> count */
+static GHashTable *rm_lookup_contexts = NULL;
+/** Number of lookups served by another in-flight lookup */
+static guint rm_lookup_coalesced = 0;
+
 /**
  * rm_lookup_get:
  * @name: name of address book to lookup
@@ -68,28 +151,604 @@ RmLookup *rm_lookup_get(gchar *name)
 	return NULL;
 }
 
+/**
+ * rm_lookup_contact_set:
+ * @dst: destination string
+ * @src: source string
+ *
+ * Replace @dst with a copy of @src in case @src is set.
+ */
+static void rm_lookup_contact_set(gchar **dst, const gchar *src)
+{
+	if (src) {
+		g_free(*dst);
+		*dst = g_strdup(src);
+	}
+}
+
+/**
+ * rm_lookup_flight_unref:
+ * @flight: a #RmLookupFlight
+ *
+ * Drops a reference of @flight, must be called from flight context.
+ */
+static void rm_lookup_flight_unref(RmLookupFlight *flight)
+{
+	guint count;
+
+	if (--flight->ref_count) {
+		return;
+	}
+
+	g_mutex_lock(&rm_lookup_lock);
+	count = GPOINTER_TO_UINT(g_hash_table_lookup(rm_lookup_contexts, flight->context)) - 1;
+	if (count) {
+		g_hash_table_insert(rm_lookup_contexts, flight->context, GUINT_TO_POINTER(count));
+	} else {
+		g_hash_table_remove(rm_lookup_contexts, flight->context);
+	}
+	g_mutex_unlock(&rm_lookup_lock);
+
+	g_ptr_array_free(flight->providers, TRUE);
+	g_ptr_array_free(flight->results, TRUE);
+	g_array_free(flight->states, TRUE);
+	g_object_unref(flight->cancellable);
+	g_main_context_unref(flight->context);
+	g_free(flight->number);
+
+	g_slice_free(RmLookupFlight, flight);
+}
+
+/**
+ * rm_lookup_flight_cancel_idle:
+ * @user_data: flight #GCancellable
+ *
+ * Cancel flight providers from flight context.
+ *
+ * Returns: %G_SOURCE_REMOVE
+ */
+static gboolean rm_lookup_flight_cancel_idle(gpointer user_data)
+{
+	g_cancellable_cancel(user_data);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * rm_lookup_flight_detach_waiter:
+ * @flight: a #RmLookupFlight
+ * @waiter: a #RmLookupWaiter
+ *
+ * Remove a cancelled @waiter from @flight and stop all providers once no waiter is left.
+ * Must be called with rm_lookup_lock held.
+ *
+ * Returns: %TRUE if @waiter has been detached, %FALSE if @flight is already completing it
+ */
+static gboolean rm_lookup_flight_detach_waiter(RmLookupFlight *flight, RmLookupWaiter *waiter)
+{
+	GSource *source;
+	GList *link = g_list_find(flight->waiters, waiter);
+
+	if (!link) {
+		return FALSE;
+	}
+
+	flight->waiters = g_list_delete_link(flight->waiters, link);
+	waiter->flight = NULL;
+
+	if (flight->done || flight->waiters) {
+		return TRUE;
+	}
+
+	/* Not from within cancellation handler as providers may finish synchronously */
+	source = g_idle_source_new();
+	g_source_set_callback(source, rm_lookup_flight_cancel_idle, g_object_ref(flight->cancellable), g_object_unref);
+	g_source_attach(source, flight->context);
+	g_source_unref(source);
+
+	return TRUE;
+}
+
+/**
+ * rm_lookup_waiter_cancel_idle:
+ * @user_data: a detached #RmLookupWaiter
+ *
+ * Return %G_IO_ERROR_CANCELLED to a cancelled waiter. Runs on the context of the waiter task, as the
+ * cancellation handler can not be disconnected from within itself.
+ *
+ * Returns: %G_SOURCE_REMOVE
+ */
+static gboolean rm_lookup_waiter_cancel_idle(gpointer user_data)
+{
+	RmLookupWaiter *waiter = user_data;
+
+	if (waiter->cancellable) {
+		g_cancellable_disconnect(waiter->cancellable, waiter->handler);
+		g_object_unref(waiter->cancellable);
+	}
+
+	g_task_return_new_error(waiter->task, G_IO_ERROR, G_IO_ERROR_CANCELLED, "Lookup of number has been cancelled");
+	g_object_unref(waiter->task);
+
+	g_slice_free(RmLookupWaiter, waiter);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * rm_lookup_waiter_return_cancelled:
+ * @waiter: a detached #RmLookupWaiter
+ *
+ * Schedule cancellation result of @waiter on its task context.
+ */
+static void rm_lookup_waiter_return_cancelled(RmLookupWaiter *waiter)
+{
+	GSource *source = g_idle_source_new();
+
+	g_source_set_callback(source, rm_lookup_waiter_cancel_idle, waiter, NULL);
+	g_source_attach(source, g_task_get_context(waiter->task));
+	g_source_unref(source);
+}
+
+/**
+ * rm_lookup_waiter_cancelled_cb:
+ * @cancellable: a #GCancellable
+ * @user_data: a #RmLookupWaiter
+ *
+ * Caller has cancelled its lookup: detach it from its flight and return right away instead of waiting
+ * for the providers.
+ */
+static void rm_lookup_waiter_cancelled_cb(GCancellable *cancellable, gpointer user_data)
+{
+	RmLookupWaiter *waiter = user_data;
+	gboolean detached = FALSE;
+
+	g_mutex_lock(&rm_lookup_lock);
+	waiter->cancelled = TRUE;
+	if (waiter->flight) {
+		detached = rm_lookup_flight_detach_waiter(waiter->flight, waiter);
+	}
+	g_mutex_unlock(&rm_lookup_lock);
+
+	/* Waiters which have not joined a flight yet are returned by rm_lookup_search_async() */
+	if (detached) {
+		rm_lookup_waiter_return_cancelled(waiter);
+	}
+}
+
+/**
+ * rm_lookup_flight_complete:
+ * @flight: a #RmLookupFlight
+ * @result: a #RmContact or %NULL if number has not been found
+ *
+ * Return @result to all waiters and cancel providers which are still running.
+ */
+static void rm_lookup_flight_complete(RmLookupFlight *flight, RmContact *result)
+{
+	GList *waiters;
+	GList *list;
+
+	g_mutex_lock(&rm_lookup_lock);
+	g_hash_table_remove(rm_lookup_flights, flight->number);
+	flight->done = TRUE;
+	waiters = g_steal_pointer(&flight->waiters);
+	g_mutex_unlock(&rm_lookup_lock);
+
+	for (list = waiters; list != NULL; list = list->next) {
+		RmLookupWaiter *waiter = list->data;
+
+		if (waiter->cancellable) {
+			g_cancellable_disconnect(waiter->cancellable, waiter->handler);
+			g_object_unref(waiter->cancellable);
+		}
+
+		g_task_return_pointer(waiter->task, result ? g_object_ref(result) : NULL, (GDestroyNotify)rm_contact_free);
+		g_object_unref(waiter->task);
+
+		g_slice_free(RmLookupWaiter, waiter);
+	}
+	g_list_free(waiters);
+
+	g_cancellable_cancel(flight->cancellable);
+
+	/* Drop reference held until completion */
+	rm_lookup_flight_unref(flight);
+}
+
+/**
+ * rm_lookup_flight_check:
+ * @flight: a #RmLookupFlight
+ *
+ * Complete @flight as soon as the result is known: Providers keep their registration order, so the result
+ * of the first provider which found the number is used once all providers before it have failed.
+ */
+static void rm_lookup_flight_check(RmLookupFlight *flight)
+{
+	guint index;
+
+	for (index = 0; index < flight->providers->len; index++) {
+		RmLookupState state = g_array_index(flight->states, RmLookupState, index);
+
+		if (state == RM_LOOKUP_STATE_RUNNING) {
+			return;
+		}
+
+		if (state == RM_LOOKUP_STATE_FOUND) {
+			rm_lookup_flight_complete(flight, g_ptr_array_index(flight->results, index));
+			return;
+		}
+	}
+
+	rm_lookup_flight_complete(flight, NULL);
+}
+
+/**
+ * rm_lookup_provider_cb:
+ * @source: unused
+ * @res: a #GAsyncResult
+ * @user_data: a #RmLookupCall
+ *
+ * Provider has finished.
+ */
+static void rm_lookup_provider_cb(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	RmLookupCall *call = user_data;
+	RmLookupFlight *flight = call->flight;
+	RmLookup *lookup = g_ptr_array_index(flight->providers, call->index);
+	RmContact *contact = NULL;
+	GError *error = NULL;
+
+	if (lookup->search_async) {
+		contact = rm_contact_new();
+
+		if (!lookup->search_finish(res, contact, &error)) {
+			g_clear_object(&contact);
+		}
+	} else {
+		contact = g_task_propagate_pointer(G_TASK(res), &error);
+	}
+
+	if (error) {
+		if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_debug("%s(): %s: %s", __FUNCTION__, lookup->name, error->message);
+		}
+		g_error_free(error);
+	}
+
+	g_array_index(flight->states, RmLookupState, call->index) = contact ? RM_LOOKUP_STATE_FOUND : RM_LOOKUP_STATE_FAILED;
+	g_ptr_array_index(flight->results, call->index) = contact;
+
+	if (!flight->done) {
+		rm_lookup_flight_check(flight);
+	}
+
+	rm_lookup_flight_unref(flight);
+	g_slice_free(RmLookupCall, call);
+}
+
+/**
+ * rm_lookup_sync_free:
+ * @data: a #RmLookupSync
+ *
+ * Frees synchronous provider task data.
+ */
+static void rm_lookup_sync_free(gpointer data)
+{
+	RmLookupSync *sync = data;
+
+	g_free(sync->number);
+	g_slice_free(RmLookupSync, sync);
+}
+
+/**
+ * rm_lookup_sync_func:
+ * @data: a #GTask
+ * @user_data: unused
+ *
+ * Compatibility shim: run synchronous provider in the lookup worker pool. Requests which have been
+ * cancelled while being queued are skipped.
+ */
+static void rm_lookup_sync_func(gpointer data, gpointer user_data)
+{
+	GTask *task = data;
+	RmLookupSync *sync = g_task_get_task_data(task);
+	RmContact *contact;
+
+	if (g_task_return_error_if_cancelled(task)) {
+		g_object_unref(task);
+		return;
+	}
+
+	contact = rm_contact_new();
+
+	if (sync->lookup->search(sync->number, contact)) {
+		g_task_return_pointer(task, contact, (GDestroyNotify)rm_contact_free);
+	} else {
+		rm_contact_free(contact);
+		g_task_return_pointer(task, NULL, NULL);
+	}
+
+	g_object_unref(task);
+}
+
+/**
+ * rm_lookup_sync_push:
+ * @task: a #GTask with #RmLookupSync task data (transfer full)
+ *
+ * Queue synchronous provider request. In case the queue is full the provider is treated as not having
+ * found the number.
+ */
+static void rm_lookup_sync_push(GTask *task)
+{
+	gboolean full;
+
+	g_mutex_lock(&rm_lookup_lock);
+	if (!rm_lookup_sync_pool) {
+		rm_lookup_sync_pool = g_thread_pool_new(rm_lookup_sync_func, NULL, RM_LOOKUP_SYNC_THREADS, FALSE, NULL);
+	}
+
+	full = g_thread_pool_unprocessed(rm_lookup_sync_pool) >= RM_LOOKUP_SYNC_QUEUE;
+	if (!full) {
+		g_thread_pool_push(rm_lookup_sync_pool, task, NULL);
+	}
+	g_mutex_unlock(&rm_lookup_lock);
+
+	if (full) {
+		g_warning("%s(): Lookup queue is full, skipping %s", __FUNCTION__, ((RmLookupSync*)g_task_get_task_data(task))->lookup->name);
+		g_task_return_pointer(task, NULL, NULL);
+		g_object_unref(task);
+	}
+}
+
+/**
+ * rm_lookup_provider_start:
+ * @flight: a #RmLookupFlight
+ * @index: provider index
+ *
+ * Start provider @index of @flight.
+ */
+static void rm_lookup_provider_start(RmLookupFlight *flight, guint index)
+{
+	RmLookup *lookup = g_ptr_array_index(flight->providers, index);
+	RmLookupCall *call = g_slice_new(RmLookupCall);
+
+	call->flight = flight;
+	call->index = index;
+	flight->ref_count++;
+
+	if (lookup->search_async) {
+		lookup->search_async(flight->number, flight->cancellable, rm_lookup_provider_cb, call);
+	} else {
+		RmLookupSync *sync = g_slice_new(RmLookupSync);
+		GTask *task = g_task_new(NULL, flight->cancellable, rm_lookup_provider_cb, call);
+
+		sync->lookup = lookup;
+		sync->number = g_strdup(flight->number);
+		g_task_set_task_data(task, sync, rm_lookup_sync_free);
+		rm_lookup_sync_push(task);
+	}
+}
+
+/**
+ * rm_lookup_search_async:
+ * @number: number to lookup
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: a #GAsyncReadyCallback
+ * @user_data: user data for @callback
+ *
+ * Lookup @number using all registered lookup plugins concurrently. Concurrent lookups of the same number are
+ * coalesced into one set of provider requests. A cancelled caller gets %G_IO_ERROR_CANCELLED right away,
+ * providers are cancelled once all callers cancelled their lookup. Finish with rm_lookup_search_finish().
+ */
+void rm_lookup_search_async(gchar *number, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+	RmLookupWaiter *waiter = g_slice_new0(RmLookupWaiter);
+	RmLookupFlight *flight;
+	GSList *list;
+	gboolean leader = FALSE;
+	guint index;
+
+	g_return_if_fail(number != NULL);
+
+	waiter->task = g_task_new(NULL, cancellable, callback, user_data);
+	g_task_set_source_tag(waiter->task, rm_lookup_search_async);
+
+	if (cancellable) {
+		waiter->cancellable = g_object_ref(cancellable);
+		waiter->handler = g_cancellable_connect(cancellable, G_CALLBACK(rm_lookup_waiter_cancelled_cb), waiter, NULL);
+	}
+
+	g_mutex_lock(&rm_lookup_lock);
+
+	if (!rm_lookup_flights) {
+		rm_lookup_flights = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		rm_lookup_contexts = g_hash_table_new(g_direct_hash, g_direct_equal);
+	}
+
+	if (waiter->cancelled) {
+		/* Cancelled before joining a flight */
+		g_mutex_unlock(&rm_lookup_lock);
+		rm_lookup_waiter_return_cancelled(waiter);
+		return;
+	}
+
+	flight = g_hash_table_lookup(rm_lookup_flights, number);
+	if (flight) {
+		/* Join in-flight lookup */
+		rm_lookup_coalesced++;
+	} else {
+		flight = g_slice_new0(RmLookupFlight);
+		flight->ref_count = 1;
+		flight->number = g_strdup(number);
+		flight->context = g_main_context_ref_thread_default();
+		flight->cancellable = g_cancellable_new();
+		flight->providers = g_ptr_array_new();
+		flight->results = g_ptr_array_new_with_free_func((GDestroyNotify)rm_contact_free);
+		flight->states = g_array_new(FALSE, TRUE, sizeof(RmLookupState));
+
+		for (list = rm_lookup_plugins; list != NULL; list = list->next) {
+			g_ptr_array_add(flight->providers, list->data);
+		}
+		g_ptr_array_set_size(flight->results, flight->providers->len);
+		g_array_set_size(flight->states, flight->providers->len);
+
+		g_hash_table_insert(rm_lookup_flights, g_strdup(number), flight);
+		g_hash_table_insert(rm_lookup_contexts, flight->context, GUINT_TO_POINTER(GPOINTER_TO_UINT(g_hash_table_lookup(rm_lookup_contexts, flight->context)) + 1));
+		leader = TRUE;
+	}
+
+	flight->waiters = g_list_prepend(flight->waiters, waiter);
+	waiter->flight = flight;
+
+	g_mutex_unlock(&rm_lookup_lock);
+
+	if (!leader) {
+		return;
+	}
+
+	/* Keep flight alive while starting providers */
+	flight->ref_count++;
+
+	for (index = 0; index < flight->providers->len; index++) {
+		rm_lookup_provider_start(flight, index);
+	}
+
+	if (!flight->providers->len) {
+		rm_lookup_flight_check(flight);
+	}
+
+	rm_lookup_flight_unref(flight);
+}
+
+/**
+ * rm_lookup_search_finish:
+ * @result: a #GAsyncResult
+ * @contact: a #RmContact to store data to, must not be shared
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finish lookup started with rm_lookup_search_async() and copy name/company/address to @contact.
+ *
+ * Returns: %TRUE is lookup data has been found, otherwise %FALSE
+ */
+gboolean rm_lookup_search_finish(GAsyncResult *result, RmContact *contact, GError **error)
+{
+	RmContact *found;
+
+	g_return_val_if_fail(g_task_is_valid(result, NULL), FALSE);
+
+	found = g_task_propagate_pointer(G_TASK(result), error);
+	if (!found) {
+		return FALSE;
+	}
+
+	rm_lookup_contact_set(&contact->name, found->name);
+	rm_lookup_contact_set(&contact->company, found->company);
+	rm_lookup_contact_set(&contact->street, found->street);
+	rm_lookup_contact_set(&contact->zip, found->zip);
+	rm_lookup_contact_set(&contact->city, found->city);
+
+	rm_contact_free(found);
+
+	return TRUE;
+}
+
+/**
+ * rm_lookup_search_sync_cb:
+ * @source: unused
+ * @res: a #GAsyncResult
+ * @user_data: pointer to store @res in
+ *
+ * Synchronous lookup has finished.
+ */
+static void rm_lookup_search_sync_cb(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GAsyncResult **result = user_data;
+
+	*result = g_object_ref(res);
+}
+
+/**
+ * rm_lookup_context_busy:
+ * @context: a #GMainContext
+ *
+ * Check whether flights started on @context are still unfinished.
+ *
+ * Returns: %TRUE if @context is still needed by a flight
+ */
+static gboolean rm_lookup_context_busy(GMainContext *context)
+{
+	gboolean busy;
+
+	g_mutex_lock(&rm_lookup_lock);
+	busy = g_hash_table_contains(rm_lookup_contexts, context);
+	g_mutex_unlock(&rm_lookup_lock);
+
+	return busy;
+}
+
 /**
  * rm_lookup_search:
  * @number: number to lookup
  * @contact: a #RmContact to store data to
  *
- * Lookup number and return name/address/zip/city
+ * Lookup number and return name/address/zip/city. Synchronous wrapper around rm_lookup_search_async().
+ * If the calling thread owns its thread default main context (e.g. the main thread), that context is
+ * iterated while waiting, so flights led by it keep running and its other sources are dispatched
+ * meanwhile. Otherwise a private main context is used. Prefer rm_lookup_search_async() on the main thread.
  *
  * Returns: %TRUE is lookup data has been found, otherwise %FALSE
  */
 gboolean rm_lookup_search(gchar *number, RmContact *contact)
 {
-	GSList *list;
+	GMainContext *context = g_main_context_ref_thread_default();
+	GAsyncResult *result = NULL;
+	gboolean private_context = FALSE;
+	gboolean found;
 
-	for (list = rm_lookup_plugins; list != NULL; list = list->next) {
-		RmLookup *lookup = list->data;
+	if (!g_main_context_acquire(context)) {
+		g_main_context_unref(context);
+		context = g_main_context_new();
+		g_main_context_acquire(context);
+		g_main_context_push_thread_default(context);
+		private_context = TRUE;
+	}
 
-		if (lookup->search(number, contact)) {
-			return TRUE;
-		}
+	rm_lookup_search_async(number, NULL, rm_lookup_search_sync_cb, &result);
+
+	/* Also wait for flights led by a private context to release it */
+	while (!result || (private_context && rm_lookup_context_busy(context))) {
+		g_main_context_iteration(context, TRUE);
+	}
+
+	if (private_context) {
+		g_main_context_pop_thread_default(context);
 	}
+	g_main_context_release(context);
+
+	found = rm_lookup_search_finish(result, contact, NULL);
+
+	g_object_unref(result);
+	g_main_context_unref(context);
+
+	return found;
+}
+
+/**
+ * rm_lookup_get_coalesced:
+ *
+ * Get number of lookups which have been served by an already running lookup of the same number.
+ *
+ * Returns: number of coalesced lookups
+ */
+guint rm_lookup_get_coalesced(void)
+{
+	guint coalesced;
+
+	g_mutex_lock(&rm_lookup_lock);
+	coalesced = rm_lookup_coalesced;
+	g_mutex_unlock(&rm_lookup_lock);
 
-	return FALSE;
+	return coalesced;
 }
 
 /**
@@ -36,11 +36,18 @@ G_BEGIN_DECLS
 typedef struct {
 	/*< private >*/
 	gchar *name;
+	/* search() and search_finish() fill in a new contact owned by the lookup core */
 	gboolean (*search)(gchar *number, RmContact *contact);
+	/* Optional asynchronous variant, preferred over search() if set */
+	void (*search_async)(gchar *number, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+	gboolean (*search_finish)(GAsyncResult *result, RmContact *contact, GError **error);
 } RmLookup;
 
 RmLookup *rm_lookup_get(gchar *name);
 gboolean rm_lookup_search(gchar *number, RmContact *contact);
+void rm_lookup_search_async(gchar *number, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+gboolean rm_lookup_search_finish(GAsyncResult *result, RmContact *contact, GError **error);
+guint rm_lookup_get_coalesced(void);
 gboolean rm_lookup_register(RmLookup *lookup);
 gboolean rm_lookup_unregister(RmLookup *lookup);
 
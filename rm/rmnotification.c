@@ -49,6 +49,36 @@ static gint rm_notification_signal_id = 0;
 static GList *rm_notification_messages = NULL;
 static RmVoxPlayback *vox = NULL;
 
+/** Maximum number of concurrent reverse lookups */
+#define RM_NOTIFICATION_LOOKUP_THREADS 2
+/** Maximum number of queued reverse lookups, further requests are dropped */
+#define RM_NOTIFICATION_LOOKUP_QUEUE 16
+/** Seconds after which a reverse lookup result is no longer of interest */
+#define RM_NOTIFICATION_LOOKUP_TIMEOUT 15
+
+/**
+ * RmNotificationLookup:
+ *
+ * A queued or running reverse lookup of an incoming connection.
+ */
+typedef struct {
+	/*< private >*/
+	RmConnection *connection;
+	gchar *number;
+	GCancellable *cancellable;
+	guint timeout_id;
+	gboolean expired;
+	gboolean running;
+} RmNotificationLookup;
+
+/** Pending reverse lookups: connection -> RmNotificationLookup, main thread only */
+static GHashTable *rm_notification_lookups = NULL;
+/** Reverse lookups waiting for one of the RM_NOTIFICATION_LOOKUP_THREADS slots, main thread only */
+static GQueue rm_notification_lookup_queue = G_QUEUE_INIT;
+/** Reverse lookup statistics */
+static RmNotificationLookupStats rm_notification_lookup_stats;
+G_LOCK_DEFINE_STATIC(rm_notification_lookup_stats);
+
 /**
  * rm_notification_play_ringtone:
  *
@@ -191,30 +221,234 @@ RmNotification *rm_notification_get(gchar *name)
 }
 
 /**
- * rm_notification_reverse_lookup_thread:
- * @data: a #RmConnection
+ * rm_notification_lookup_free:
+ * @lookup: a #RmNotificationLookup
  *
- * Reverse lookup of connection data and notification redraw
+ * Frees reverse lookup request.
+ */
+static void rm_notification_lookup_free(RmNotificationLookup *lookup)
+{
+	if (lookup->timeout_id) {
+		g_source_remove(lookup->timeout_id);
+	}
+
+	g_object_unref(lookup->cancellable);
+	g_free(lookup->number);
+
+	g_slice_free(RmNotificationLookup, lookup);
+}
+
+/**
+ * rm_notification_lookup_unqueue:
+ * @lookup: a queued #RmNotificationLookup
  *
- * Returns: %NULL
+ * Drop a lookup which has been cancelled or expired before it got a slot.
  */
-static gpointer rm_notification_reverse_lookup_thread(gpointer data)
+static void rm_notification_lookup_unqueue(RmNotificationLookup *lookup)
 {
-	RmConnection *connection = data;
-	RmContact contact;
-	gchar *number;
+	g_queue_remove(&rm_notification_lookup_queue, lookup);
 
-	number = connection->remote_number;
+	G_LOCK(rm_notification_lookup_stats);
+	rm_notification_lookup_stats.queued--;
+	if (lookup->expired) {
+		rm_notification_lookup_stats.expired++;
+	} else {
+		rm_notification_lookup_stats.cancelled++;
+	}
+	G_UNLOCK(rm_notification_lookup_stats);
 
-	if (rm_lookup_search(number, &contact)) {
-		RmNotificationMessage *message = rm_notification_message_get(connection);
+	if (rm_notification_lookups && g_hash_table_lookup(rm_notification_lookups, lookup->connection) == lookup) {
+		g_hash_table_remove(rm_notification_lookups, lookup->connection);
+	}
 
-		if (message) {
-			rm_notification_update_message(message, &contact);
+	rm_notification_lookup_free(lookup);
+}
+
+/**
+ * rm_notification_lookup_timeout_cb:
+ * @data: a #RmNotificationLookup
+ *
+ * Reverse lookup took too long, result is no longer of interest.
+ *
+ * Returns: %G_SOURCE_REMOVE
+ */
+static gboolean rm_notification_lookup_timeout_cb(gpointer data)
+{
+	RmNotificationLookup *lookup = data;
+
+	lookup->timeout_id = 0;
+	lookup->expired = TRUE;
+
+	if (lookup->running) {
+		g_cancellable_cancel(lookup->cancellable);
+	} else {
+		rm_notification_lookup_unqueue(lookup);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static void rm_notification_lookup_dispatch(void);
+
+/**
+ * rm_notification_lookup_cb:
+ * @source: unused
+ * @res: a #GAsyncResult
+ * @user_data: a #RmNotificationLookup
+ *
+ * Reverse lookup has finished: Update notification message if lookup is still of interest and start
+ * the next queued one.
+ */
+static void rm_notification_lookup_cb(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	RmNotificationLookup *lookup = user_data;
+	RmContact *contact = rm_contact_new();
+	GError *error = NULL;
+	gboolean found;
+
+	found = rm_lookup_search_finish(res, contact, &error);
+
+	G_LOCK(rm_notification_lookup_stats);
+	rm_notification_lookup_stats.active--;
+	if (lookup->expired) {
+		rm_notification_lookup_stats.expired++;
+	} else if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		rm_notification_lookup_stats.cancelled++;
+	} else {
+		rm_notification_lookup_stats.completed++;
+	}
+	G_UNLOCK(rm_notification_lookup_stats);
+
+	/* Superseded, cancelled and shut down lookups are no longer registered */
+	if (rm_notification_lookups && g_hash_table_lookup(rm_notification_lookups, lookup->connection) == lookup) {
+		g_hash_table_remove(rm_notification_lookups, lookup->connection);
+
+		if (found) {
+			RmNotificationMessage *message = rm_notification_message_get(lookup->connection);
+
+			if (message) {
+				rm_notification_update_message(message, contact);
+			}
 		}
 	}
 
-	return NULL;
+	g_clear_error(&error);
+	rm_contact_free(contact);
+	rm_notification_lookup_free(lookup);
+
+	rm_notification_lookup_dispatch();
+}
+
+/**
+ * rm_notification_lookup_dispatch:
+ *
+ * Start queued lookups while less than RM_NOTIFICATION_LOOKUP_THREADS are running.
+ */
+static void rm_notification_lookup_dispatch(void)
+{
+	while (rm_notification_lookups && rm_notification_lookup_stats.active < RM_NOTIFICATION_LOOKUP_THREADS) {
+		RmNotificationLookup *lookup = g_queue_pop_head(&rm_notification_lookup_queue);
+
+		if (!lookup) {
+			break;
+		}
+
+		G_LOCK(rm_notification_lookup_stats);
+		rm_notification_lookup_stats.queued--;
+		rm_notification_lookup_stats.active++;
+		G_UNLOCK(rm_notification_lookup_stats);
+
+		lookup->running = TRUE;
+
+		/* Providers run concurrently, the result is delivered on this (main) context */
+		rm_lookup_search_async(lookup->number, lookup->cancellable, rm_notification_lookup_cb, lookup);
+	}
+}
+
+/**
+ * rm_notification_lookup_cancel:
+ * @connection: a #RmConnection
+ *
+ * Cancel a pending reverse lookup of @connection.
+ */
+static void rm_notification_lookup_cancel(RmConnection *connection)
+{
+	RmNotificationLookup *lookup;
+
+	if (!rm_notification_lookups) {
+		return;
+	}
+
+	lookup = g_hash_table_lookup(rm_notification_lookups, connection);
+	if (!lookup) {
+		return;
+	}
+
+	g_hash_table_remove(rm_notification_lookups, connection);
+
+	if (lookup->running) {
+		g_cancellable_cancel(lookup->cancellable);
+	} else {
+		rm_notification_lookup_unqueue(lookup);
+	}
+}
+
+/**
+ * rm_notification_lookup_start:
+ * @connection: a #RmConnection
+ *
+ * Queue a reverse lookup for @connection. In case the queue is full the request is dropped.
+ */
+static void rm_notification_lookup_start(RmConnection *connection)
+{
+	RmNotificationLookup *lookup;
+	guint queued;
+
+	if (!rm_notification_lookups) {
+		return;
+	}
+
+	/* A lookup for this connection is already pending (e.g. repeated ring event), it is superseded */
+	rm_notification_lookup_cancel(connection);
+
+	G_LOCK(rm_notification_lookup_stats);
+	queued = rm_notification_lookup_stats.queued;
+	if (queued >= RM_NOTIFICATION_LOOKUP_QUEUE) {
+		rm_notification_lookup_stats.dropped++;
+	} else {
+		rm_notification_lookup_stats.queued++;
+		rm_notification_lookup_stats.max_queued = MAX(rm_notification_lookup_stats.max_queued, queued + 1);
+	}
+	G_UNLOCK(rm_notification_lookup_stats);
+
+	if (queued >= RM_NOTIFICATION_LOOKUP_QUEUE) {
+		g_warning("%s(): Lookup queue is full, skipping reverse lookup", __FUNCTION__);
+		return;
+	}
+
+	lookup = g_slice_new0(RmNotificationLookup);
+	lookup->connection = connection;
+	lookup->number = g_strdup(connection->remote_number);
+	lookup->cancellable = g_cancellable_new();
+	lookup->timeout_id = g_timeout_add_seconds(RM_NOTIFICATION_LOOKUP_TIMEOUT, rm_notification_lookup_timeout_cb, lookup);
+
+	g_hash_table_insert(rm_notification_lookups, connection, lookup);
+	g_queue_push_tail(&rm_notification_lookup_queue, lookup);
+
+	rm_notification_lookup_dispatch();
+}
+
+/**
+ * rm_notification_get_lookup_stats:
+ * @stats: pointer to store statistics in
+ *
+ * Get reverse lookup worker pool statistics.
+ */
+void rm_notification_get_lookup_stats(RmNotificationLookupStats *stats)
+{
+	G_LOCK(rm_notification_lookup_stats);
+	*stats = rm_notification_lookup_stats;
+	G_UNLOCK(rm_notification_lookup_stats);
 }
 
 /**
@@ -311,6 +545,7 @@ static void rm_notification_connection_changed_cb(RmObject *obj, gint event, RmC
 		RmNotificationMessage *message = rm_notification_message_get(connection);
 
 		rm_notification_stop_ringtone();
+		rm_notification_lookup_cancel(connection);
 
 		if (message) {
 			rm_notification_message_close(message);
@@ -329,8 +564,10 @@ static void rm_notification_connection_changed_cb(RmObject *obj, gint event, RmC
 
 	/* In case no name is given, try a reverse lookup for the remote number */
 	if (RM_EMPTY_STRING(contact->name)) {
-		g_thread_new("rmnotification reverse lookup", rm_notification_reverse_lookup_thread, connection);
+		rm_notification_lookup_start(connection);
 	}
+
+	rm_contact_free(contact);
 }
 
 /**
@@ -364,6 +601,9 @@ void rm_notification_init(void)
 {
 	/* Connect to "connection-changed" signal */
 	rm_notification_signal_id = g_signal_connect(G_OBJECT(rm_object), "connection-changed", G_CALLBACK(rm_notification_connection_changed_cb), NULL);
+
+	/* Reverse lookups are queued and run asynchronously on a bounded number of slots */
+	rm_notification_lookups = g_hash_table_new(g_direct_hash, g_direct_equal);
 }
 
 /**
@@ -377,6 +617,29 @@ void rm_notification_shutdown(void)
 		g_signal_handler_disconnect(G_OBJECT(rm_object), rm_notification_signal_id);
 		rm_notification_signal_id = 0;
 	}
+
+	if (rm_notification_lookups) {
+		GHashTableIter iter;
+		gpointer value;
+		GHashTable *lookups = g_steal_pointer(&rm_notification_lookups);
+
+		/* Cancel running lookups, rm_notification_lookup_cb() frees them without touching their connection */
+		g_hash_table_iter_init(&iter, lookups);
+		while (g_hash_table_iter_next(&iter, NULL, &value)) {
+			RmNotificationLookup *lookup = value;
+
+			if (lookup->running) {
+				g_cancellable_cancel(lookup->cancellable);
+			}
+		}
+
+		g_hash_table_destroy(lookups);
+
+		/* Queued lookups never started */
+		while (!g_queue_is_empty(&rm_notification_lookup_queue)) {
+			rm_notification_lookup_unqueue(g_queue_peek_head(&rm_notification_lookup_queue));
+		}
+	}
 }
 
 /**
@@ -60,7 +60,30 @@ struct RmNotification {
 	void (*close)(gpointer priv);
 };
 
+/**
+ * RmNotificationLookupStats:
+ * @queued: number of reverse lookups waiting for a worker
+ * @active: number of reverse lookups currently running
+ * @completed: number of finished reverse lookups
+ * @dropped: number of reverse lookups dropped due to a full queue
+ * @cancelled: number of reverse lookups cancelled by a connection state change
+ * @expired: number of reverse lookups which exceeded their deadline
+ * @max_queued: highest number of queued reverse lookups
+ *
+ * Reverse lookup worker pool statistics.
+ */
+typedef struct {
+	guint queued;
+	guint active;
+	guint completed;
+	guint dropped;
+	guint cancelled;
+	guint expired;
+	guint max_queued;
+} RmNotificationLookupStats;
+
 RmNotification *rm_notification_get(gchar *name);
+void rm_notification_get_lookup_stats(RmNotificationLookupStats *stats);
 
 void rm_notification_init(void);
 void rm_notification_shutdown(void);
@@ -44,6 +44,62 @@ RmCallByCallEntry rm_call_by_call_table[] = {
 	{ "", "", 0 },
 };
 
+/** Size of stack buffer used for canonized numbers */
+#define RM_NUMBER_BUFFER_SIZE 64
+
+/** Maximum number of memoized numbers per format, cache is flushed once it is full */
+#define RM_NUMBER_CACHE_SIZE 4096
+
+/** Protects swapping of profile number contexts */
+G_LOCK_DEFINE_STATIC(rm_number_context);
+
+/**
+ * RmNumberCache:
+ *
+ * Memo cache of normalized numbers (raw number -> result) of a #RmNumberContext, one table per country
+ * code prefix mode. Protected by its own lock, the context itself is never modified.
+ */
+struct _RmNumberCache {
+	/*< private >*/
+	GMutex lock;
+	GHashTable *table[2];
+	guint hits;
+	guint misses;
+};
+
+/**
+ * rm_number_cache_new:
+ *
+ * Create an empty memo cache.
+ *
+ * Returns: new #RmNumberCache
+ */
+static RmNumberCache *rm_number_cache_new(void)
+{
+	RmNumberCache *cache = g_slice_new0(RmNumberCache);
+
+	g_mutex_init(&cache->lock);
+	cache->table[0] = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	cache->table[1] = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	return cache;
+}
+
+/**
+ * rm_number_cache_free:
+ * @cache: a #RmNumberCache
+ *
+ * Free memo cache.
+ */
+static void rm_number_cache_free(RmNumberCache *cache)
+{
+	g_hash_table_destroy(cache->table[0]);
+	g_hash_table_destroy(cache->table[1]);
+	g_mutex_clear(&cache->lock);
+
+	g_slice_free(RmNumberCache, cache);
+}
+
 /**
  * rm_number_scramble:
  * @number: input number
@@ -82,35 +138,280 @@ gchar *rm_number_scramble(const gchar *number)
 }
 
 /**
- * rm_call_by_call_prefix_length:
+ * rm_number_context_new:
+ * @profile: a #RmProfile
+ *
+ * Create a dialing settings snapshot of @profile.
+ *
+ * Returns: new #RmNumberContext
+ */
+static RmNumberContext *rm_number_context_new(RmProfile *profile)
+{
+	RmNumberContext *context = g_slice_new0(RmNumberContext);
+
+	context->ref_count = 1;
+	context->international_access_code = rm_router_get_international_access_code(profile);
+	context->national_prefix = rm_router_get_national_prefix(profile);
+	context->country_code = rm_router_get_country_code(profile);
+	context->area_code = rm_router_get_area_code(profile);
+
+	/* Unset values are treated as empty strings */
+	if (!context->international_access_code) {
+		context->international_access_code = g_strdup("");
+	}
+	if (!context->national_prefix) {
+		context->national_prefix = g_strdup("");
+	}
+	if (!context->country_code) {
+		context->country_code = g_strdup("");
+	}
+	if (!context->area_code) {
+		context->area_code = g_strdup("");
+	}
+
+	context->international_access_code_len = strlen(context->international_access_code);
+	context->national_prefix_len = strlen(context->national_prefix);
+	context->country_code_len = strlen(context->country_code);
+	context->area_code_len = strlen(context->area_code);
+
+	context->cache = rm_number_cache_new();
+
+	return context;
+}
+
+/**
+ * rm_number_context_ref:
+ * @context: a #RmNumberContext
+ *
+ * Increase reference count of @context.
+ *
+ * Returns: @context
+ */
+RmNumberContext *rm_number_context_ref(RmNumberContext *context)
+{
+	g_atomic_int_inc(&context->ref_count);
+
+	return context;
+}
+
+/**
+ * rm_number_context_unref:
+ * @context: a #RmNumberContext
+ *
+ * Decrease reference count of @context and free it once it drops to zero.
+ */
+void rm_number_context_unref(RmNumberContext *context)
+{
+	if (!context || !g_atomic_int_dec_and_test(&context->ref_count)) {
+		return;
+	}
+
+	g_free(context->international_access_code);
+	g_free(context->national_prefix);
+	g_free(context->country_code);
+	g_free(context->area_code);
+
+	rm_number_cache_free(context->cache);
+
+	g_slice_free(RmNumberContext, context);
+}
+
+/**
+ * rm_number_context_swap:
+ * @profile: a #RmProfile
+ * @context: new #RmNumberContext or %NULL (transfer full)
+ *
+ * Replace number context of @profile. Users holding a reference to the old context keep a consistent snapshot.
+ */
+static void rm_number_context_swap(RmProfile *profile, RmNumberContext *context)
+{
+	RmNumberContext *old;
+
+	G_LOCK(rm_number_context);
+	old = profile->number_context;
+	profile->number_context = context;
+	G_UNLOCK(rm_number_context);
+
+	rm_number_context_unref(old);
+}
+
+/**
+ * rm_number_context_settings_changed_cb:
+ * @settings: profile #GSettings
+ * @key: changed key
+ * @user_data: a #RmProfile
+ *
+ * Rebuild number context after dialing settings have been changed.
+ */
+static void rm_number_context_settings_changed_cb(GSettings *settings, const gchar *key, gpointer user_data)
+{
+	RmProfile *profile = user_data;
+
+	if (strcmp(key, "international-access-code") && strcmp(key, "national-access-code") && strcmp(key, "country-code") && strcmp(key, "area-code")) {
+		return;
+	}
+
+	g_debug("%s(): %s changed, updating number context", __FUNCTION__, key);
+	rm_number_context_swap(profile, rm_number_context_new(profile));
+}
+
+/**
+ * rm_number_context_get:
+ * @profile: a #RmProfile
+ *
+ * Get current dialing settings snapshot of @profile. It is created on first use and replaced
+ * whenever the dialing settings change.
+ *
+ * Returns: referenced #RmNumberContext, release with rm_number_context_unref(), or %NULL without profile
+ */
+RmNumberContext *rm_number_context_get(RmProfile *profile)
+{
+	RmNumberContext *context;
+	RmNumberContext *new_context;
+
+	if (!profile) {
+		return NULL;
+	}
+
+	G_LOCK(rm_number_context);
+	context = profile->number_context;
+	if (context) {
+		rm_number_context_ref(context);
+	}
+	G_UNLOCK(rm_number_context);
+
+	if (context) {
+		return context;
+	}
+
+	new_context = rm_number_context_new(profile);
+
+	G_LOCK(rm_number_context);
+	if (!profile->number_context) {
+		profile->number_context = new_context;
+		new_context = NULL;
+
+		if (profile->settings) {
+			g_signal_connect(profile->settings, "changed", G_CALLBACK(rm_number_context_settings_changed_cb), profile);
+		}
+	}
+	context = rm_number_context_ref(profile->number_context);
+	G_UNLOCK(rm_number_context);
+
+	/* Another thread has been faster */
+	rm_number_context_unref(new_context);
+
+	return context;
+}
+
+/**
+ * rm_number_context_clear:
+ * @profile: a #RmProfile
+ *
+ * Drop number context of @profile, e.g. on profile removal.
+ */
+void rm_number_context_clear(RmProfile *profile)
+{
+	if (!profile->number_context) {
+		return;
+	}
+
+	if (profile->settings) {
+		g_signal_handlers_disconnect_by_func(profile->settings, rm_number_context_settings_changed_cb, profile);
+	}
+
+	rm_number_context_swap(profile, NULL);
+}
+
+/**
+ * rm_number_call_by_call_prefix_length:
+ * @context: a #RmNumberContext
  * @number: input number string
  *
  * Get call-by-call prefix length
  *
  * Returns: length of call-by-call prefix
  */
-gint rm_call_by_call_prefix_length(const gchar *number)
+static gint rm_number_call_by_call_prefix_length(RmNumberContext *context, const gchar *number)
 {
-	gchar *my_country_code = rm_router_get_country_code(rm_profile_get_active());
 	RmCallByCallEntry *entry;
 
-	if (RM_EMPTY_STRING(my_country_code)) {
-		g_free(my_country_code);
+	if (!context || !context->country_code_len) {
 		return 0;
 	}
 
-	for (entry = rm_call_by_call_table; strlen(entry->country_code); entry++) {
-		if (!strcmp(my_country_code, entry->country_code) && !strncmp(number, entry->prefix, strlen(entry->prefix))) {
-			g_free(my_country_code);
+	for (entry = rm_call_by_call_table; entry->prefix_length; entry++) {
+		if (!strcmp(context->country_code, entry->country_code) && !strncmp(number, entry->prefix, strlen(entry->prefix))) {
 			return entry->prefix_length;
 		}
 	}
 
-	g_free(my_country_code);
-
 	return 0;
 }
 
+/**
+ * rm_call_by_call_prefix_length:
+ * @number: input number string
+ *
+ * Get call-by-call prefix length
+ *
+ * Returns: length of call-by-call prefix
+ */
+gint rm_call_by_call_prefix_length(const gchar *number)
+{
+	RmNumberContext *context = rm_number_context_get(rm_profile_get_active());
+	gint len = rm_number_call_by_call_prefix_length(context, number);
+
+	rm_number_context_unref(context);
+
+	return len;
+}
+
+/**
+ * rm_number_canonize_buffer:
+ * @context: a #RmNumberContext or %NULL
+ * @number: input number
+ * @buffer: output buffer or %NULL
+ * @size: size of @buffer
+ *
+ * Canonize number (valid chars: 0123456789#*) into @buffer. If @buffer is too small a new
+ * buffer is allocated.
+ *
+ * Returns: canonized number, @buffer or allocated memory which must be freed with g_free()
+ */
+static gchar *rm_number_canonize_buffer(RmNumberContext *context, const gchar *number, gchar *buffer, gsize size)
+{
+	const gchar *international_access_code = context ? context->international_access_code : "";
+	gsize international_access_code_len = context ? context->international_access_code_len : 0;
+	const gchar *pos;
+	gsize needed = 1;
+	gchar *out;
+
+	for (pos = number; *pos; pos++) {
+		if (isdigit(*pos) || *pos == '*' || *pos == '#') {
+			needed++;
+		} else if (*pos == '+') {
+			needed += international_access_code_len;
+		}
+	}
+
+	if (needed > size) {
+		buffer = g_malloc(needed);
+	}
+
+	for (out = buffer, pos = number; *pos; pos++) {
+		if (isdigit(*pos) || *pos == '*' || *pos == '#') {
+			*out++ = *pos;
+		} else if (*pos == '+') {
+			memcpy(out, international_access_code, international_access_code_len);
+			out += international_access_code_len;
+		}
+	}
+	*out = '\0';
+
+	return buffer;
+}
+
 /**
  * rm_number_canonize:
  * @number: input number
@@ -121,76 +422,52 @@ gint rm_call_by_call_prefix_length(const gchar *number)
  */
 gchar *rm_number_canonize(const gchar *number)
 {
-	GString *new_number;
-
-	new_number = g_string_sized_new(strlen(number));
-	while (*number) {
-		if (isdigit(*number) || *number == '*' || *number == '#') {
-			g_string_append_c(new_number, *number);
-		} else if (*number == '+') {
-			g_string_append(new_number, rm_router_get_international_access_code(rm_profile_get_active()));
-		}
+	RmNumberContext *context = rm_number_context_get(rm_profile_get_active());
+	gchar *canonized = rm_number_canonize_buffer(context, number, NULL, 0);
 
-		number++;
-	}
+	rm_number_context_unref(context);
 
-	return g_string_free(new_number, FALSE);
+	return canonized;
 }
 
 /**
- * rm_number_format:
- * @profile: a #RmProfile
+ * rm_number_format_context:
+ * @context: a #RmNumberContext
  * @number: input number
  * @output_format: selected number output format
  *
- * Format number according to phone standard.
+ * Format number according to phone standard using dialing settings of @context.
  *
  * Returns: real number
  */
-gchar *rm_number_format(RmProfile *profile, const gchar *number, RmNumberFormats output_format)
+static gchar *rm_number_format_context(RmNumberContext *context, const gchar *number, RmNumberFormats output_format)
 {
+	gchar buffer[RM_NUMBER_BUFFER_SIZE];
 	gchar *tmp;
 	gchar *canonized;
-	gchar *international_access_code;
-	gchar *national_prefix;
-	gchar *my_country_code;
-	gchar *my_area_code;
 	gint number_format = RM_NUMBER_FORMAT_UNKNOWN;
 	const gchar *my_prefix;
 	gchar *result = NULL;
 
-	if (!profile)
-		return g_strdup(number);
-
-	/* Check for internal sip numbers first */
-	if (strchr(number, '@')) {
-		return g_strdup(number);
-	}
-
-	canonized = tmp = rm_number_canonize(number);
-
-	international_access_code = rm_router_get_international_access_code(profile);
-	national_prefix = rm_router_get_national_prefix(profile);
-	my_country_code = rm_router_get_country_code(profile);
-	my_area_code = rm_router_get_area_code(profile);
+	canonized = tmp = rm_number_canonize_buffer(context, number, buffer, sizeof(buffer));
 
 	/* we only need to check for international prefix, as rm_number_canonize() already replaced '+'
 	 * Example of the following:
 	 *    tmp = 00494012345678  with international_access_code 00 and my_country_code 49
 	 *    number_format = NUMBER_FORMAT_UNKNOWN
 	 */
-	if (!strncmp(tmp, international_access_code, strlen(international_access_code))) {
+	if (!strncmp(tmp, context->international_access_code, context->international_access_code_len)) {
 		/* International format number */
-		tmp += strlen(international_access_code);
+		tmp += context->international_access_code_len;
 		number_format = RM_NUMBER_FORMAT_INTERNATIONAL;
 
 		/* Example:
 		 * tmp = 494012345678
 		 * number_format = NUMBER_FORMAT_INTERNATIONAL
 		 */
-		if (!strncmp(tmp, my_country_code, strlen(my_country_code))) {
+		if (!strncmp(tmp, context->country_code, context->country_code_len)) {
 			/* national number */
-			tmp = tmp + strlen(my_country_code);
+			tmp = tmp + context->country_code_len;
 			number_format = RM_NUMBER_FORMAT_NATIONAL;
 
 			/* Example:
@@ -200,8 +477,8 @@ gchar *rm_number_format(RmProfile *profile, const gchar *number, RmNumberFormats
 		}
 	} else {
 		/* not an international format, test for national or local format */
-		if (!RM_EMPTY_STRING(national_prefix) && !strncmp(tmp, national_prefix, strlen(national_prefix))) {
-			tmp = tmp + strlen(national_prefix);
+		if (context->national_prefix_len && !strncmp(tmp, context->national_prefix, context->national_prefix_len)) {
+			tmp = tmp + context->national_prefix_len;
 			number_format = RM_NUMBER_FORMAT_NATIONAL;
 
 			/* Example:
@@ -219,9 +496,9 @@ gchar *rm_number_format(RmProfile *profile, const gchar *number, RmNumberFormats
 		}
 	}
 
-	if ((number_format == RM_NUMBER_FORMAT_NATIONAL) && (!strncmp(tmp, my_area_code, strlen(my_area_code)))) {
+	if ((number_format == RM_NUMBER_FORMAT_NATIONAL) && (!strncmp(tmp, context->area_code, context->area_code_len))) {
 		/* local number */
-		tmp = tmp + strlen(my_area_code);
+		tmp = tmp + context->area_code_len;
 		number_format = RM_NUMBER_FORMAT_LOCAL;
 
 		/* Example:
@@ -241,14 +518,14 @@ gchar *rm_number_format(RmProfile *profile, const gchar *number, RmNumberFormats
 			if (output_format == RM_NUMBER_FORMAT_LOCAL) {
 				result = g_strdup(tmp);
 			} else {
-				result = g_strconcat(national_prefix, my_area_code, tmp, NULL);
+				result = g_strconcat(context->national_prefix, context->area_code, tmp, NULL);
 			}
 			break;
 		case RM_NUMBER_FORMAT_NATIONAL:
-			result = g_strconcat(national_prefix, tmp, NULL);
+			result = g_strconcat(context->national_prefix, tmp, NULL);
 			break;
 		case RM_NUMBER_FORMAT_INTERNATIONAL:
-			result = g_strconcat(international_access_code, tmp, NULL);
+			result = g_strconcat(context->international_access_code, tmp, NULL);
 			break;
 		}
 		break;
@@ -256,13 +533,13 @@ gchar *rm_number_format(RmProfile *profile, const gchar *number, RmNumberFormats
 	/* international prefix + international format */
 	case RM_NUMBER_FORMAT_INTERNATIONAL_PLUS:
 		/* international format prefixed by a + */
-		my_prefix = (output_format == RM_NUMBER_FORMAT_INTERNATIONAL_PLUS) ? "+" : international_access_code;
+		my_prefix = (output_format == RM_NUMBER_FORMAT_INTERNATIONAL_PLUS) ? "+" : context->international_access_code;
 		switch (number_format) {
 		case RM_NUMBER_FORMAT_LOCAL:
-			result = g_strconcat(my_prefix, my_country_code, my_area_code, tmp, NULL);
+			result = g_strconcat(my_prefix, context->country_code, context->area_code, tmp, NULL);
 			break;
 		case RM_NUMBER_FORMAT_NATIONAL:
-			result = g_strconcat(my_prefix, my_country_code, tmp, NULL);
+			result = g_strconcat(my_prefix, context->country_code, tmp, NULL);
 			break;
 		case RM_NUMBER_FORMAT_INTERNATIONAL:
 			result = g_strconcat(my_prefix, tmp, NULL);
@@ -274,17 +551,199 @@ gchar *rm_number_format(RmProfile *profile, const gchar *number, RmNumberFormats
 		break;
 	}
 
-	g_free(international_access_code);
-	g_free(national_prefix);
-	g_free(my_country_code);
-	g_free(my_area_code);
-
-	g_free(canonized);
+	if (canonized != buffer) {
+		g_free(canonized);
+	}
 	g_assert(result != NULL);
 
 	return result;
 }
 
+/**
+ * rm_number_format:
+ * @profile: a #RmProfile
+ * @number: input number
+ * @output_format: selected number output format
+ *
+ * Format number according to phone standard.
+ *
+ * Returns: real number
+ */
+gchar *rm_number_format(RmProfile *profile, const gchar *number, RmNumberFormats output_format)
+{
+	RmNumberContext *context;
+	gchar *result;
+
+	if (!profile)
+		return g_strdup(number);
+
+	/* Check for internal sip numbers first */
+	if (strchr(number, '@')) {
+		return g_strdup(number);
+	}
+
+	context = rm_number_context_get(profile);
+	result = rm_number_format_context(context, number, output_format);
+	rm_number_context_unref(context);
+
+	return result;
+}
+
+/**
+ * rm_number_full_context:
+ * @context: a #RmNumberContext
+ * @number: input phone number
+ * @country_code_prefix: whether we want a international or national phone number format
+ *
+ * Retrieve standardized number without call by call prefix using dialing settings of @context.
+ *
+ * Returns: canonized and formatted phone number
+ */
+static gchar *rm_number_full_context(RmNumberContext *context, const gchar *number, gboolean country_code_prefix)
+{
+	/* Remove call-by-call (carrier preselect) prefix */
+	number += rm_number_call_by_call_prefix_length(context, number);
+
+	/* Check if it is an international number */
+	if (!strncmp(number, "00", 2)) {
+		if (country_code_prefix) {
+			return g_strdup(number);
+		}
+
+		if (!strncmp(number + 2, context->country_code, context->country_code_len)) {
+			return g_strconcat("0", number + 4, NULL);
+		}
+
+		return g_strdup(number);
+	}
+
+	/* Check for internal sip numbers */
+	if (strchr(number, '@')) {
+		return g_strdup(number);
+	}
+
+	return rm_number_format_context(context, number, country_code_prefix ? RM_NUMBER_FORMAT_INTERNATIONAL : RM_NUMBER_FORMAT_NATIONAL);
+}
+
+/**
+ * rm_number_full_cached:
+ * @context: a #RmNumberContext
+ * @number: input phone number
+ * @country_code_prefix: whether we want a international or national phone number format
+ *
+ * Lookup normalized @number in memo cache of @context and normalize it on a miss. Memo cache lock must be held.
+ *
+ * Returns: normalized number owned by cache
+ */
+static const gchar *rm_number_full_cached(RmNumberContext *context, const gchar *number, gboolean country_code_prefix)
+{
+	GHashTable *cache = context->cache->table[country_code_prefix ? 1 : 0];
+	gchar *result = g_hash_table_lookup(cache, number);
+
+	if (result) {
+		context->cache->hits++;
+		return result;
+	}
+
+	context->cache->misses++;
+
+	if (g_hash_table_size(cache) >= RM_NUMBER_CACHE_SIZE) {
+		g_debug("%s(): Cache full, flushing", __FUNCTION__);
+		g_hash_table_remove_all(cache);
+	}
+
+	result = rm_number_full_context(context, number, country_code_prefix);
+	g_hash_table_insert(cache, g_strdup(number), result);
+
+	return result;
+}
+
+/**
+ * rm_number_full_batch:
+ * @numbers: array of input phone numbers
+ * @results: array to store normalized numbers in (free each with g_free()), or %NULL
+ * @count: number of elements in @numbers and @results
+ * @country_code_prefix: whether we want a international or national phone number format
+ *
+ * Normalize a set of numbers like rm_number_full() using a single dialing context and memo cache lock.
+ * Duplicate numbers are normalized only once per profile. Without @results the numbers are only
+ * added to the memo cache.
+ */
+void rm_number_full_batch(const gchar **numbers, gchar **results, guint count, gboolean country_code_prefix)
+{
+	RmProfile *profile = rm_profile_get_active();
+	RmNumberContext *context = rm_number_context_get(profile);
+	guint idx;
+
+	if (context) {
+		g_mutex_lock(&context->cache->lock);
+	}
+
+	for (idx = 0; idx < count; idx++) {
+		const gchar *number = numbers[idx];
+		const gchar *result = number;
+
+		if (RM_EMPTY_STRING(number)) {
+			result = NULL;
+		} else if (context && number[0] != '*' && number[0] != '#') {
+			/* Skip numbers with leading '*' or '#' */
+			result = rm_number_full_cached(context, number, country_code_prefix);
+		}
+
+		if (results) {
+			results[idx] = g_strdup(result);
+		}
+	}
+
+	if (context) {
+		g_mutex_unlock(&context->cache->lock);
+		rm_number_context_unref(context);
+	}
+}
+
+/**
+ * rm_number_get_cache_stats:
+ * @profile: a #RmProfile
+ * @hits: pointer to store number of cache hits in, or %NULL
+ * @misses: pointer to store number of cache misses in, or %NULL
+ * @size: pointer to store number of cached entries in, or %NULL
+ *
+ * Get statistics of the number memo cache of @profile. Statistics start over whenever the
+ * dialing settings change.
+ */
+void rm_number_get_cache_stats(RmProfile *profile, guint *hits, guint *misses, guint *size)
+{
+	RmNumberContext *context = rm_number_context_get(profile);
+
+	if (hits) {
+		*hits = 0;
+	}
+	if (misses) {
+		*misses = 0;
+	}
+	if (size) {
+		*size = 0;
+	}
+
+	if (!context) {
+		return;
+	}
+
+	g_mutex_lock(&context->cache->lock);
+	if (hits) {
+		*hits = context->cache->hits;
+	}
+	if (misses) {
+		*misses = context->cache->misses;
+	}
+	if (size) {
+		*size = g_hash_table_size(context->cache->table[0]) + g_hash_table_size(context->cache->table[1]);
+	}
+	g_mutex_unlock(&context->cache->lock);
+
+	rm_number_context_unref(context);
+}
+
 /**
  * rm_number_full:
  * @number: input phone number
@@ -296,7 +755,9 @@ gchar *rm_number_format(RmProfile *profile, const gchar *number, RmNumberFormats
  */
 gchar *rm_number_full(const gchar *number, gboolean country_code_prefix)
 {
-	RmProfile *profile = rm_profile_get_active();;
+	RmProfile *profile = rm_profile_get_active();
+	RmNumberContext *context;
+	gchar *result;
 
 	if (RM_EMPTY_STRING(number)) {
 		return NULL;
@@ -310,27 +771,13 @@ gchar *rm_number_full(const gchar *number, gboolean country_code_prefix)
 	if (!profile)
 		return g_strdup(number);
 
-	/* Remove call-by-call (carrier preselect) prefix */
-	number += rm_call_by_call_prefix_length(number);
+	context = rm_number_context_get(profile);
 
-	/* Check if it is an international number */
-	if (!strncmp(number, "00", 2)) {
-		gchar *out;
-		gchar *my_country_code;
+	g_mutex_lock(&context->cache->lock);
+	result = g_strdup(rm_number_full_cached(context, number, country_code_prefix));
+	g_mutex_unlock(&context->cache->lock);
 
-		if (country_code_prefix) {
-			return g_strdup(number);
-		}
-
-		my_country_code = rm_router_get_country_code(profile);
-		if (!strncmp(number + 2, my_country_code, strlen(my_country_code))) {
-			out = g_strdup_printf("0%s", number + 4);
-		} else {
-			out = g_strdup(number);
-		}
-
-		return out;
-	}
+	rm_number_context_unref(context);
 
-	return rm_number_format(profile, number, country_code_prefix ? RM_NUMBER_FORMAT_INTERNATIONAL : RM_NUMBER_FORMAT_NATIONAL);
+	return result;
 }
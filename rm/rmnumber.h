@@ -59,8 +59,42 @@ typedef struct {
 	gint prefix_length;
 } RmCallByCallEntry;
 
+typedef struct _RmNumberCache RmNumberCache;
+
+/**
+ * RmNumberContext:
+ *
+ * Immutable snapshot of the dialing settings of a profile. Numbers normalized with these settings are
+ * memoized in a separate, internally locked #RmNumberCache bound to the snapshot.
+ *
+ * The #RmNumberContext-struct contains only private fileds and should not be directly accessed.
+ */
+typedef struct {
+	/*< private >*/
+	gint ref_count;
+
+	gchar *international_access_code;
+	gchar *national_prefix;
+	gchar *country_code;
+	gchar *area_code;
+
+	gsize international_access_code_len;
+	gsize national_prefix_len;
+	gsize country_code_len;
+	gsize area_code_len;
+
+	RmNumberCache *cache;
+} RmNumberContext;
+
+RmNumberContext *rm_number_context_get(RmProfile *profile);
+RmNumberContext *rm_number_context_ref(RmNumberContext *context);
+void rm_number_context_unref(RmNumberContext *context);
+void rm_number_context_clear(RmProfile *profile);
+
 gchar *rm_number_scramble(const gchar *number);
 gchar *rm_number_full(const gchar *number, gboolean country_code_prefix);
+void rm_number_full_batch(const gchar **numbers, gchar **results, guint count, gboolean country_code_prefix);
+void rm_number_get_cache_stats(RmProfile *profile, guint *hits, guint *misses, guint *size);
 gchar *rm_number_format(RmProfile *profile, const gchar *number, RmNumberFormats output_format);
 gchar *rm_number_canonize(const gchar *number);
 
@@ -97,10 +97,12 @@ static void rm_object_create_signals(GObjectClass *g_object_class)
 		G_TYPE_UINT,
 		G_TYPE_POINTER);
 
+	/* Single lookups are emitted with detail "single", contacts of a batch without. Batch-aware
+	 * resolvers connect to "contact-process::single" so they do not see batch contacts twice */
 	rm_object_signals[RM_ACB_CONTACT_PROCESS] = g_signal_new(
 		"contact-process",
 		G_OBJECT_CLASS_TYPE(g_object_class),
-		G_SIGNAL_RUN_FIRST,
+		G_SIGNAL_RUN_FIRST | G_SIGNAL_DETAILED,
 		G_STRUCT_OFFSET(RmObjectClass, contact_process),
 		NULL,
 		NULL,
@@ -182,6 +184,19 @@ static void rm_object_create_signals(GObjectClass *g_object_class)
 		G_TYPE_NONE,
 		0,
 		G_TYPE_NONE);
+
+	/* Batch variant of contact-process, array of distinct #RmContact */
+	rm_object_signals[RM_ACB_CONTACTS_PROCESS] = g_signal_new(
+		"contacts-process",
+		G_OBJECT_CLASS_TYPE(g_object_class),
+		G_SIGNAL_RUN_FIRST,
+		G_STRUCT_OFFSET(RmObjectClass, contacts_process),
+		NULL,
+		NULL,
+		g_cclosure_marshal_VOID__POINTER,
+		G_TYPE_NONE,
+		1,
+		G_TYPE_POINTER);
 }
 
 /**
@@ -43,6 +43,7 @@ G_BEGIN_DECLS
  * @RM_ACB_CONTACTS_CHANGED: contacts-changed
  * @RM_ACB_AUTHENTICATE: authenticate
  * @RM_ACB_PROFILE_CHANGED: profile-changed
+ * @RM_ACB_CONTACTS_PROCESS: contacts-process
  * @RM_ACB_MAX: Max Id
  *
  * RM Callback signal ids
@@ -56,6 +57,7 @@ typedef enum {
 	RM_ACB_CONTACTS_CHANGED,
 	RM_ACB_AUTHENTICATE,
   RM_ACB_PROFILE_CHANGED,
+	RM_ACB_CONTACTS_PROCESS,
 	RM_ACB_MAX
 } RmCallbackId;
 
@@ -92,6 +94,7 @@ typedef struct _RmObjectClass {
 	void (*contacts_changed)(void);
 	void (*authenticate)(RmAuthData *auth_data);
   void (*profile_changed)(void);
+	void (*contacts_process)(GPtrArray *contacts);
 } RmObjectClass;
 
 GObject *rm_object_new(void);
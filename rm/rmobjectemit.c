@@ -63,11 +63,48 @@ void rm_object_emit_connection_changed(gint event, RmConnection *connection)
  * rm_object_emit_contact_process:
  * @contact: a #RmContact
  *
- * Emit signal: contact-process.
+ * Emit signal: contact-process (detail "single"), reaches handlers of "contact-process" and
+ * "contact-process::single". Handlers fill in @contact directly, so it must not be shared.
  */
 void rm_object_emit_contact_process(RmContact *contact)
 {
-	g_signal_emit(rm_object, rm_object_signals[RM_ACB_CONTACT_PROCESS], 0, contact);
+	static GQuark single = 0;
+
+	if (!single) {
+		single = g_quark_from_static_string("single");
+	}
+
+	g_signal_emit(rm_object, rm_object_signals[RM_ACB_CONTACT_PROCESS], single, contact);
+}
+
+/**
+ * rm_object_emit_contacts_process:
+ * @contacts: array holding a reference to each #RmContact, with distinct numbers
+ *
+ * Emit signal: contacts-process. Afterwards contact-process is emitted without detail for each
+ * contact, so resolvers which only implement the single variant still see all contacts. Batch-aware
+ * resolvers connect to "contact-process::single" and are skipped there.
+ *
+ * Entries may be shared with other owners. Handlers replace an entry instead of modifying it, either by
+ * a result of their own or by rm_contact_make_writable(). contact-process handlers modify their contact
+ * in place, so entries are made writable before they are passed on.
+ */
+void rm_object_emit_contacts_process(GPtrArray *contacts)
+{
+	guint idx;
+
+	g_signal_emit(rm_object, rm_object_signals[RM_ACB_CONTACTS_PROCESS], 0, contacts);
+
+	if (!g_signal_has_handler_pending(rm_object, rm_object_signals[RM_ACB_CONTACT_PROCESS], 0, FALSE)) {
+		return;
+	}
+
+	for (idx = 0; idx < contacts->len; idx++) {
+		RmContact *contact = rm_contact_make_writable(g_ptr_array_index(contacts, idx));
+
+		g_ptr_array_index(contacts, idx) = contact;
+		g_signal_emit(rm_object, rm_object_signals[RM_ACB_CONTACT_PROCESS], 0, contact);
+	}
 }
 
 /**
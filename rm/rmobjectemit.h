@@ -33,6 +33,7 @@ G_BEGIN_DECLS
 
 void rm_object_emit_connection_changed(gint event, RmConnection *connection);
 void rm_object_emit_contact_process(RmContact *contact);
+void rm_object_emit_contacts_process(GPtrArray *contacts);
 void rm_object_emit_fax_process(const gchar *filename);
 void rm_object_emit_connection_incoming(RmConnection *connection);
 void rm_object_emit_connection_outgoing(RmConnection *connection);
@@ -32,6 +32,7 @@
 #include <rm/rmsettings.h>
 #include <rm/rmnotification.h>
 #include <rm/rmfilter.h>
+#include <rm/rmnumber.h>
 #include <rm/rmstring.h>
 
 /**
@@ -102,6 +103,8 @@ void rm_profile_remove(RmProfile *profile)
 {
 	rm_profile_list = g_list_remove(rm_profile_list, profile);
 
+	rm_number_context_clear(profile);
+
 	if (profile->settings) {
 		g_object_unref(profile->settings);
 	}
@@ -340,6 +343,9 @@ static void rm_profile_free_entry(gpointer data)
 	/* Free actions */
 	rm_action_shutdown(profile);
 
+	/* Free dialing context */
+	rm_number_context_clear(profile);
+
 	/* Free profiles settings */
 	g_clear_object(&profile->settings);
 
@@ -50,6 +50,9 @@ typedef struct {
 
 	GList *action_list;
 	GList *filter_list;
+
+	/* Current #RmNumberContext, see rm_number_context_get() */
+	gpointer number_context;
 } RmProfile;
 
 gboolean rm_profile_init(void);
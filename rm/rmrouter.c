@@ -562,25 +562,81 @@ void rm_router_shutdown(void)
 /**
  * rm_router_process_journal:
  * @journal: journal list
+ * @error: a #GError, set if the local journal store could not be updated
  *
  * Router needs to process a new loaded journal (emit journal-process signal and journal-loaded)
+ *
+ * Returns: merged journal list (@journal is consumed)
  */
-void rm_router_process_journal(GList *journal)
+GList *rm_router_process_journal(GList *journal, GError **error)
 {
 	GList *list;
+	GHashTable *distinct;
+	GPtrArray *contacts;
+	GArray *indices;
+	guint idx;
+	guint hits;
+	guint misses;
+	guint size;
+
+	/* Load offline journal, combine new entries and append them to disk */
+	journal = rm_journal_load(journal, error);
+
+	/* Collect distinct remote numbers, remember the contact index of each call */
+	distinct = g_hash_table_new(g_str_hash, g_str_equal);
+	contacts = g_ptr_array_new_with_free_func((GDestroyNotify)rm_contact_free);
+	indices = g_array_new(FALSE, FALSE, sizeof(guint));
+	for (list = journal; list; list = list->next) {
+		RmCallEntry *call = list->data;
+		gpointer value;
 
-	/* Parse offline journal and combine new entries */
-	journal = rm_journal_load(journal);
+		idx = G_MAXUINT;
 
-	/* Store it back to disk */
-	rm_journal_save(journal);
+		if (!RM_EMPTY_STRING(call->remote->number)) {
+			if (g_hash_table_lookup_extended(distinct, call->remote->number, NULL, &value)) {
+				idx = GPOINTER_TO_UINT(value);
+			} else {
+				idx = contacts->len;
+				g_hash_table_insert(distinct, call->remote->number, GUINT_TO_POINTER(idx));
+				g_ptr_array_add(contacts, g_object_ref(call->remote));
+			}
+		}
 
-	/* Try to lookup entries in address book */
-	for (list = journal; list; list = list->next) {
+		g_array_append_val(indices, idx);
+	}
+	g_hash_table_destroy(distinct);
+
+	/* Calls get the resolved contacts below, drop their references so resolvers do not need to copy */
+	for (list = journal, idx = 0; list; list = list->next, idx++) {
+		RmCallEntry *call = list->data;
+
+		if (g_array_index(indices, guint, idx) != G_MAXUINT) {
+			g_clear_pointer(&call->remote, rm_contact_free);
+		}
+	}
+
+	/* Let resolvers (address book, area codes, ...) process all numbers at once, followed by contact-process for the others */
+	rm_object_emit_contacts_process(contacts);
+
+	/* Fan results out to all entries sharing a number */
+	for (list = journal, idx = 0; list; list = list->next, idx++) {
 		RmCallEntry *call = list->data;
+		guint contact_idx = g_array_index(indices, guint, idx);
 
-		rm_object_emit_contact_process(call->remote);
+		if (contact_idx != G_MAXUINT) {
+			call->remote = g_object_ref(g_ptr_array_index(contacts, contact_idx));
+		}
 	}
+
+	g_debug("%s(): resolved %u distinct numbers", __FUNCTION__, contacts->len);
+
+	g_array_free(indices, TRUE);
+	g_ptr_array_free(contacts, TRUE);
+
+	rm_number_get_cache_stats(rm_profile_get_active(), &hits, &misses, &size);
+	g_debug("%s(): number cache hits %u, misses %u, size %u", __FUNCTION__, hits, misses, size);
+
+	return journal;
 }
 
 /**
@@ -792,6 +848,7 @@ GList *rm_router_load_fax_reports(RmProfile *profile, GList *journal)
 {
 	g_autoptr (GDir) dir = NULL;
 	GError *error = NULL;
+	RmJournal *container;
 	const gchar *file_name;
 	gchar *dir_name = g_settings_get_string(profile->settings, "fax-report-dir");
 
@@ -805,6 +862,8 @@ GList *rm_router_load_fax_reports(RmProfile *profile, GList *journal)
 		return journal;
 	}
 
+	container = rm_journal_new_from_list(journal);
+
 	while ((file_name = g_dir_read_name(dir))) {
 		RmCallEntry *call;
 		gchar *uri;
@@ -826,13 +885,13 @@ GList *rm_router_load_fax_reports(RmProfile *profile, GList *journal)
 		date_time = g_strdup_printf("%s.%s.%s %2.2s:%2.2s", split[3], split[4], split[5] + 2, split[6], split[7]);
 
 		call = rm_call_entry_new(RM_CALL_ENTRY_TYPE_FAX_REPORT, date_time, "", split[2], ("Fax-Report"), split[1], "0:01", g_strdup(uri));
-		journal = rm_journal_add_call_entry(journal, call);
+		rm_journal_add(container, call);
 
 		g_free(uri);
 		g_strfreev(split);
 	}
 
-	return journal;
+	return rm_journal_steal_list(container);
 }
 
 /**
@@ -848,6 +907,7 @@ GList *rm_router_load_voice_records(RmProfile *profile, GList *journal)
 {
 	g_autoptr(GDir) dir = NULL;
 	GError *error = NULL;
+	RmJournal *container;
 	const gchar *file_name;
 	const gchar *dir_name = rm_get_user_data_dir();
 
@@ -861,6 +921,8 @@ GList *rm_router_load_voice_records(RmProfile *profile, GList *journal)
 		return journal;
 	}
 
+	container = rm_journal_new_from_list(journal);
+
 	while ((file_name = g_dir_read_name(dir))) {
 		RmCallEntry *call;
 		gchar *uri;
@@ -891,13 +953,13 @@ GList *rm_router_load_voice_records(RmProfile *profile, GList *journal)
 		date_time = g_strdup_printf("%s %2.2s:%2.2s", split[0], split[1], split[2]);
 
 		call = rm_call_entry_new(RM_CALL_ENTRY_TYPE_RECORD, date_time, "", num, ("Record"), split[3], "0:01", g_strdup(uri));
-		journal = rm_journal_add_call_entry(journal, call);
+		rm_journal_add(container, call);
 
 		g_free(uri);
 		g_strfreev(split);
 	}
 
-	return journal;
+	return rm_journal_steal_list(container);
 }
 
 /**
@@ -139,7 +139,7 @@ void rm_router_shutdown(void);
 
 gchar **rm_router_get_numbers(RmProfile *profile);
 
-void rm_router_process_journal(GList *journal);
+GList *rm_router_process_journal(GList *journal, GError **error);
 
 gboolean rm_router_register(RmRouter *router);
 
@@ -20,6 +20,7 @@
 #include <string.h>
 
 #include <glib.h>
+#include <gio/gio.h>
 
 #include <libxml/parser.h>
 
@@ -34,6 +35,207 @@
  * Small subset of function for parsing and modifying XML files.
  */
 
+/** Minimum number of children of a parsed element to get a child index */
+#define RM_XML_INDEX_MIN_CHILDREN 8
+
+/** Size of a single arena block, larger allocations get a block on their own */
+#define RM_XML_ARENA_BLOCK_SIZE (64 * 1024)
+
+/**
+ * RmXmlArena:
+ *
+ * Memory of a parsed document in arena mode. Nodes and strings are carved out of large blocks
+ * and released together when the root node is freed.
+ */
+struct _RmXmlArena {
+	GSList *blocks;
+	gchar *pos;
+	gsize left;
+	/* Interned names, prefixes and namespaces, released with the document */
+	GHashTable *strings;
+	/* Namespace maps and child indices of arena nodes */
+	GPtrArray *tables;
+	RmXmlNode *root;
+	/* Heap allocated nodes have been inserted into the tree */
+	gboolean foreign;
+};
+
+/**
+ * xml_arena_new:
+ *
+ * Create a new document arena
+ *
+ * Returns: new #RmXmlArena
+ */
+static RmXmlArena *xml_arena_new(void)
+{
+	RmXmlArena *arena = g_slice_new0(RmXmlArena);
+
+	arena->strings = g_hash_table_new(g_str_hash, g_str_equal);
+	arena->tables = g_ptr_array_new_with_free_func((GDestroyNotify)g_hash_table_destroy);
+
+	return arena;
+}
+
+/**
+ * xml_arena_free:
+ * @arena: a #RmXmlArena
+ *
+ * Release all memory of @arena
+ */
+static void xml_arena_free(RmXmlArena *arena)
+{
+	g_slist_free_full(arena->blocks, g_free);
+	g_hash_table_destroy(arena->strings);
+	g_ptr_array_free(arena->tables, TRUE);
+
+	g_slice_free(RmXmlArena, arena);
+}
+
+/**
+ * xml_arena_alloc:
+ * @arena: a #RmXmlArena
+ * @size: number of bytes
+ * @align: whether memory needs to be aligned for structures
+ *
+ * Allocate memory from @arena. It is not cleared.
+ *
+ * Returns: pointer to @size bytes
+ */
+static gpointer xml_arena_alloc(RmXmlArena *arena, gsize size, gboolean align)
+{
+	gchar *ret;
+
+	if (align) {
+		gsize pad = GPOINTER_TO_SIZE(arena->pos) % G_MEM_ALIGN;
+
+		if (pad && arena->left >= G_MEM_ALIGN - pad) {
+			arena->pos += G_MEM_ALIGN - pad;
+			arena->left -= G_MEM_ALIGN - pad;
+		} else if (pad) {
+			arena->left = 0;
+		}
+	}
+
+	if (size > RM_XML_ARENA_BLOCK_SIZE / 4) {
+		/* Keep current block for smaller allocations */
+		ret = g_malloc(size);
+		arena->blocks = g_slist_append(arena->blocks, ret);
+
+		return ret;
+	}
+
+	if (size > arena->left) {
+		arena->pos = g_malloc(RM_XML_ARENA_BLOCK_SIZE);
+		arena->left = RM_XML_ARENA_BLOCK_SIZE;
+		arena->blocks = g_slist_prepend(arena->blocks, arena->pos);
+	}
+
+	ret = arena->pos;
+	arena->pos += size;
+	arena->left -= size;
+
+	return ret;
+}
+
+/**
+ * xml_arena_strndup:
+ * @arena: a #RmXmlArena
+ * @str: string
+ * @len: length of @str
+ *
+ * Copy string into @arena
+ *
+ * Returns: NUL terminated copy of @str
+ */
+static gchar *xml_arena_strndup(RmXmlArena *arena, const gchar *str, gsize len)
+{
+	gchar *ret = xml_arena_alloc(arena, len + 1, FALSE);
+
+	memcpy(ret, str, len);
+	ret[len] = '\0';
+
+	return ret;
+}
+
+/**
+ * xml_arena_intern:
+ * @arena: a #RmXmlArena
+ * @str: string or %NULL
+ *
+ * Store @str once within @arena
+ *
+ * Returns: arena copy of @str or %NULL
+ */
+static gchar *xml_arena_intern(RmXmlArena *arena, const gchar *str)
+{
+	gchar *ret;
+
+	if (!str) {
+		return NULL;
+	}
+
+	ret = g_hash_table_lookup(arena->strings, str);
+	if (!ret) {
+		ret = xml_arena_strndup(arena, str, strlen(str));
+		g_hash_table_add(arena->strings, ret);
+	}
+
+	return ret;
+}
+
+/**
+ * xmlnode_strdup:
+ * @node: a #RmXmlNode
+ * @str: string or %NULL
+ *
+ * Copy string with the allocator of @node
+ *
+ * Returns: copy of @str
+ */
+static gchar *xmlnode_strdup(RmXmlNode *node, const gchar *str)
+{
+	if (node->arena && str) {
+		return xml_arena_strndup(node->arena, str, strlen(str));
+	}
+
+	return g_strdup(str);
+}
+
+/**
+ * xmlnode_str_free:
+ * @node: a #RmXmlNode
+ * @str: string of @node
+ *
+ * Free string of @node unless it is owned by an arena
+ */
+static void xmlnode_str_free(RmXmlNode *node, gchar *str)
+{
+	if (!node->arena) {
+		g_free(str);
+	}
+}
+
+/**
+ * xmlnode_has_name:
+ * @node: a #RmXmlNode
+ * @quark: quark of @name or 0 if there is none
+ * @name: name to compare with
+ *
+ * Compare node name. Names are never interned as quarks for untrusted documents, so only
+ * names known beforehand are compared by quark, all others by string.
+ *
+ * Returns: %TRUE if @node is called @name
+ */
+static inline gboolean xmlnode_has_name(const RmXmlNode *node, GQuark quark, const gchar *name)
+{
+	if (node->quark && quark) {
+		return node->quark == quark;
+	}
+
+	return !strcmp(node->name, name);
+}
+
 /**
  * new_node:
  * @name: node name
@@ -48,6 +250,7 @@ RmXmlNode *new_node(const gchar *name, RmXmlNodeType type)
 	RmXmlNode *node = g_new0(RmXmlNode, 1);
 
 	node->name = g_strdup(name);
+	node->quark = g_quark_try_string(name);
 	node->type = type;
 
 	return node;
@@ -68,6 +271,78 @@ RmXmlNode *rm_xmlnode_new(const gchar *name)
 	return new_node(name, RM_XMLNODE_TYPE_TAG);
 }
 
+/**
+ * xmlnode_index_add:
+ * @parent: a #RmXmlNode
+ * @child: new child of @parent
+ *
+ * Add @child to child index of @parent unless an earlier twin is indexed already
+ */
+static void xmlnode_index_add(RmXmlNode *parent, RmXmlNode *child)
+{
+	if (parent->index && child->type == RM_XMLNODE_TYPE_TAG && !g_hash_table_contains(parent->index, child->name)) {
+		g_hash_table_insert(parent->index, child->name, child);
+	}
+}
+
+/**
+ * xmlnode_index_remove:
+ * @parent: a #RmXmlNode
+ * @child: child which is about to be unlinked from @parent
+ *
+ * Replace @child within child index of @parent by its next twin
+ */
+static void xmlnode_index_remove(RmXmlNode *parent, RmXmlNode *child)
+{
+	RmXmlNode *twin;
+
+	if (!parent->index || g_hash_table_lookup(parent->index, child->name) != child) {
+		return;
+	}
+
+	for (twin = child->next; twin; twin = twin->next) {
+		if (twin->type == RM_XMLNODE_TYPE_TAG && xmlnode_has_name(twin, child->quark, child->name)) {
+			break;
+		}
+	}
+
+	/* Key is owned by the indexed node, so replace it as well */
+	if (twin) {
+		g_hash_table_replace(parent->index, twin->name, twin);
+	} else {
+		g_hash_table_remove(parent->index, child->name);
+	}
+}
+
+/**
+ * xmlnode_index_build:
+ * @node: a #RmXmlNode
+ *
+ * Create child index of @node if it has enough children to pay off
+ */
+static void xmlnode_index_build(RmXmlNode *node)
+{
+	RmXmlNode *child;
+	gint count = 0;
+
+	for (child = node->child; child && count < RM_XML_INDEX_MIN_CHILDREN; child = child->next) {
+		count++;
+	}
+
+	if (count < RM_XML_INDEX_MIN_CHILDREN) {
+		return;
+	}
+
+	node->index = g_hash_table_new(g_str_hash, g_str_equal);
+	if (node->arena) {
+		g_ptr_array_add(node->arena->tables, node->index);
+	}
+
+	for (child = node->child; child; child = child->next) {
+		xmlnode_index_add(node, child);
+	}
+}
+
 /**
  * rm_xmlnode_insert_child:
  * @parent: a #RmXmlNode
@@ -82,6 +357,10 @@ void rm_xmlnode_insert_child(RmXmlNode *parent, RmXmlNode *child)
 
 	child->parent = parent;
 
+	if (parent->arena && child->arena != parent->arena) {
+		parent->arena->foreign = TRUE;
+	}
+
 	if (parent->last_child) {
 		parent->last_child->next = child;
 	} else {
@@ -89,6 +368,8 @@ void rm_xmlnode_insert_child(RmXmlNode *parent, RmXmlNode *child)
 	}
 
 	parent->last_child = child;
+
+	xmlnode_index_add(parent, child);
 }
 
 /**
@@ -115,18 +396,63 @@ RmXmlNode *rm_xmlnode_new_child(RmXmlNode *parent, const gchar *name)
 }
 
 /**
- * rm_xmlnode_free:
+ * xmlnode_free_tree:
  * @node: a #RmXmlNode
  *
- * Free node
+ * Free node and its children without unlinking it. Arena nodes are skipped,
+ * only nodes of other trees inserted into an arena tree need to be visited.
+ * An arena root releases its arena, also when it has been inserted into another tree.
  */
-void rm_xmlnode_free(RmXmlNode *node)
+static void xmlnode_free_tree(RmXmlNode *node)
 {
 	RmXmlNode *x, *y;
 
+	if (!node->arena || node->arena->foreign) {
+		x = node->child;
+		while (x) {
+			y = x->next;
+			xmlnode_free_tree(x);
+			x = y;
+		}
+	}
+
+	if (node->arena) {
+		if (node->arena->root == node) {
+			xml_arena_free(node->arena);
+		}
+		return;
+	}
+
+	g_free(node->name);
+	g_free(node->data);
+	g_free(node->xml_ns);
+	g_free(node->prefix);
+
+	if (node->namespace_map) {
+		g_hash_table_destroy(node->namespace_map);
+	}
+
+	if (node->index) {
+		g_hash_table_destroy(node->index);
+	}
+
+	g_free(node);
+}
+
+/**
+ * rm_xmlnode_free:
+ * @node: a #RmXmlNode
+ *
+ * Free node. Nodes of an arena tree stay allocated until its root node is freed, either on its own
+ * or as part of a tree it has been inserted into.
+ */
+void rm_xmlnode_free(RmXmlNode *node)
+{
 	g_return_if_fail(node != NULL);
 
 	if (node->parent != NULL) {
+		xmlnode_index_remove(node->parent, node);
+
 		if (node->parent->child == node) {
 			node->parent->child = node->next;
 			if (node->parent->last_child == node) {
@@ -147,23 +473,7 @@ void rm_xmlnode_free(RmXmlNode *node)
 		}
 	}
 
-	x = node->child;
-	while (x) {
-		y = x->next;
-		rm_xmlnode_free(x);
-		x = y;
-	}
-
-	g_free(node->name);
-	g_free(node->data);
-	g_free(node->xml_ns);
-	g_free(node->prefix);
-
-	if (node->namespace_map) {
-		g_hash_table_destroy(node->namespace_map);
-	}
-
-	g_free(node);
+	xmlnode_free_tree(node);
 }
 
 /**
@@ -174,12 +484,15 @@ void rm_xmlnode_free(RmXmlNode *node)
 static void xmlnode_remove_attrib(RmXmlNode *node, const gchar *attr)
 {
 	RmXmlNode *attr_node, *sibling = NULL;
+	GQuark quark;
 
 	g_return_if_fail(node != NULL);
 	g_return_if_fail(attr != NULL);
 
+	quark = g_quark_try_string(attr);
+
 	for (attr_node = node->child; attr_node != NULL; attr_node = attr_node->next) {
-		if (attr_node->type == RM_XMLNODE_TYPE_ATTRIB && !strcmp(attr_node->name, attr)) {
+		if (attr_node->type == RM_XMLNODE_TYPE_ATTRIB && xmlnode_has_name(attr_node, quark, attr)) {
 			if (sibling == NULL) {
 				node->child = attr_node->next;
 			} else {
@@ -222,137 +535,341 @@ void rm_xmlnode_set_attrib(RmXmlNode *node, const gchar *attr, const gchar *valu
 	rm_xmlnode_insert_child(node, attrib_node);
 }
 
+/** Size of chunks produced by #RmXmlWriter */
+#define RM_XML_WRITER_CHUNK_SIZE 8192
+
+/** XML declaration written in front of documents */
+#define RM_XML_DECLARATION "<?xml version='1.0' encoding='UTF-8' ?>\n\n"
+
 /**
- * Get node prefix
- * @node node pointer
- * Returns: node prefix
+ * RmXmlWriterFrame:
+ *
+ * Serialization state of one open element
+ */
+typedef struct {
+	RmXmlNode *node;
+	/* Next child to write */
+	RmXmlNode *child;
+	/* Trailing newlines requested by parent */
+	gboolean formatting;
+	/* Indentation within element, off as soon as it contains text */
+	gboolean pretty;
+	gint depth;
+} RmXmlWriterFrame;
+
+/**
+ * RmXmlWriter:
+ *
+ * Incremental serializer. It produces a tree in chunks of about #RM_XML_WRITER_CHUNK_SIZE bytes
+ * reusing one buffer, so memory usage does not depend on the size of the document.
  */
-static const gchar *xmlnode_get_prefix(RmXmlNode *node)
+struct _RmXmlWriter {
+	GString *buffer;
+	GArray *stack;
+	gboolean declaration;
+};
+
+/**
+ * xml_writer_escape:
+ * @buffer: output buffer
+ * @text: text to escape
+ * @len: length of @text or -1 for #strlen
+ *
+ * Append @text with markup escaped, the same way as g_markup_escape_text() but without temporary strings
+ */
+static void xml_writer_escape(GString *buffer, const gchar *text, gssize len)
 {
-	g_return_val_if_fail(node != NULL, NULL);
+	const gchar *end;
+	const gchar *start;
+	const gchar *ptr;
+
+	if (len < 0) {
+		len = strlen(text);
+	}
 
-	return node->prefix;
+	end = text + len;
+
+	for (start = ptr = text; ptr < end; ptr++) {
+		guchar c = *ptr;
+		const gchar *replacement = NULL;
+		gunichar control = 0;
+		gsize skip = 1;
+
+		switch (c) {
+		case '&':
+			replacement = "&amp;";
+			break;
+		case '<':
+			replacement = "&lt;";
+			break;
+		case '>':
+			replacement = "&gt;";
+			break;
+		case '\'':
+			replacement = "&apos;";
+			break;
+		case '"':
+			replacement = "&quot;";
+			break;
+		default:
+			if ((c < 0x20 && c != '\t' && c != '\n' && c != '\r') || c == 0x7f) {
+				control = c;
+			} else if (c == 0xc2 && ptr + 1 < end && (guchar)ptr[1] >= 0x80 && (guchar)ptr[1] <= 0x9f && (guchar)ptr[1] != 0x85) {
+				/* C1 control characters */
+				control = (guchar)ptr[1];
+				skip = 2;
+			}
+			break;
+		}
+
+		if (!replacement && !control) {
+			continue;
+		}
+
+		g_string_append_len(buffer, start, ptr - start);
+
+		if (replacement) {
+			g_string_append(buffer, replacement);
+		} else {
+			g_string_append_printf(buffer, "&#x%x;", control);
+		}
+
+		ptr += skip - 1;
+		start = ptr + 1;
+	}
+
+	g_string_append_len(buffer, start, ptr - start);
 }
 
 /**
- * Convert node to string
- * @key key name
- * @value value
- * @buf buffer to print to
+ * xml_writer_append_ns:
+ * @key: namespace prefix
+ * @value: namespace
+ * @buffer: output buffer
+ *
+ * Append namespace declaration
  */
-static void xmlnode_to_str_foreach_append_ns(const gchar *key, const gchar *value, GString *buf)
+static void xml_writer_append_ns(const gchar *key, const gchar *value, GString *buffer)
 {
 	if (*key) {
-		g_string_append_printf(buf, " xmlns:%s='%s'", key, value);
+		g_string_append_printf(buffer, " xmlns:%s='%s'", key, value);
 	} else {
-		g_string_append_printf(buf, " xmlns='%s'", value);
+		g_string_append_printf(buffer, " xmlns='%s'", value);
 	}
 }
 
 /**
- * Helps with converting node to string
- * @node node to convert
- * @len pointer for len saving
- * @formatting format text?
- * @depth depth
- * Returns: string data or NULL on error
+ * xml_writer_push:
+ * @writer: a #RmXmlWriter
+ * @node: element to write
+ * @formatting: format output
+ * @depth: depth of @node
+ *
+ * Write start tag of @node and open it for its children
  */
-static gchar *xmlnode_to_str_helper(RmXmlNode *node, gint *len, gboolean formatting, gint depth)
+static void xml_writer_push(RmXmlWriter *writer, RmXmlNode *node, gboolean formatting, gint depth)
 {
-	GString *text = g_string_new("");
-	const gchar *prefix;
+	GString *buffer = writer->buffer;
+	RmXmlWriterFrame frame;
 	RmXmlNode *c;
-	gchar *node_name, *esc, *esc2, *tab = NULL;
-	gboolean need_end = FALSE, pretty = formatting;
-
-	g_return_val_if_fail(node != NULL, NULL);
-
-	if (pretty && depth) {
-		tab = g_strnfill(depth, '\t');
-		text = g_string_append(text, tab);
+	gboolean need_end = FALSE;
+	gint idx;
+
+	frame.node = node;
+	frame.child = node->child;
+	frame.formatting = formatting;
+	frame.pretty = formatting;
+	frame.depth = depth;
+
+	if (formatting) {
+		for (idx = 0; idx < depth; idx++) {
+			g_string_append_c(buffer, '\t');
+		}
 	}
 
-	node_name = g_markup_escape_text(node->name, -1);
-	prefix = xmlnode_get_prefix(node);
-
-	if (prefix) {
-		g_string_append_printf(text, "<%s:%s", prefix, node_name);
-	} else {
-		g_string_append_printf(text, "<%s", node_name);
+	g_string_append_c(buffer, '<');
+	if (node->prefix) {
+		g_string_append_printf(buffer, "%s:", node->prefix);
 	}
+	xml_writer_escape(buffer, node->name, -1);
 
 	if (node->namespace_map) {
-		g_hash_table_foreach(node->namespace_map, (GHFunc)xmlnode_to_str_foreach_append_ns, text);
+		g_hash_table_foreach(node->namespace_map, (GHFunc)xml_writer_append_ns, buffer);
 	} else if (node->xml_ns) {
 		if (!node->parent || !node->parent->xml_ns || strcmp(node->xml_ns, node->parent->xml_ns)) {
-			gchar *xml_ns = g_markup_escape_text(node->xml_ns, -1);
-
-			g_string_append_printf(text, " xmlns='%s'", xml_ns);
-			g_free(xml_ns);
+			g_string_append(buffer, " xmlns='");
+			xml_writer_escape(buffer, node->xml_ns, -1);
+			g_string_append_c(buffer, '\'');
 		}
 	}
 
 	for (c = node->child; c != NULL; c = c->next) {
 		if (c->type == RM_XMLNODE_TYPE_ATTRIB) {
-			const gchar *a_prefix = xmlnode_get_prefix(c);
-
-			esc = g_markup_escape_text(c->name, -1);
-			esc2 = g_markup_escape_text(c->data, -1);
-
-			if (a_prefix) {
-				g_string_append_printf(text, " %s:%s='%s'", a_prefix, esc, esc2);
-			} else {
-				g_string_append_printf(text, " %s='%s'", esc, esc2);
+			g_string_append_c(buffer, ' ');
+			if (c->prefix) {
+				g_string_append_printf(buffer, "%s:", c->prefix);
 			}
-
-			g_free(esc);
-			g_free(esc2);
+			xml_writer_escape(buffer, c->name, -1);
+			g_string_append(buffer, "='");
+			xml_writer_escape(buffer, c->data, -1);
+			g_string_append_c(buffer, '\'');
 		} else if (c->type == RM_XMLNODE_TYPE_TAG || c->type == RM_XMLNODE_TYPE_DATA) {
 			if (c->type == RM_XMLNODE_TYPE_DATA) {
-				pretty = FALSE;
+				frame.pretty = FALSE;
 			}
 			need_end = TRUE;
 		}
 	}
 
-	if (need_end) {
-		g_string_append_printf(text, ">%s", pretty ? "\n" : "");
+	if (!need_end) {
+		g_string_append_printf(buffer, "/>%s", formatting ? "\n" : "");
+		return;
+	}
 
-		for (c = node->child; c != NULL; c = c->next) {
-			if (c->type == RM_XMLNODE_TYPE_TAG) {
-				gint esc_len;
+	g_string_append_printf(buffer, ">%s", frame.pretty ? "\n" : "");
+	g_array_append_val(writer->stack, frame);
+}
 
-				esc = xmlnode_to_str_helper(c, &esc_len, pretty, depth + 1);
-				text = g_string_append_len(text, esc, esc_len);
-				g_free(esc);
-			} else if (c->type == RM_XMLNODE_TYPE_DATA && c->data_size > 0) {
-				esc = g_markup_escape_text(c->data, c->data_size);
-				text = g_string_append(text, esc);
-				g_free(esc);
-			}
+/**
+ * xml_writer_step:
+ * @writer: a #RmXmlWriter
+ *
+ * Write next child of innermost open element or close it
+ */
+static void xml_writer_step(RmXmlWriter *writer)
+{
+	RmXmlWriterFrame *frame = &g_array_index(writer->stack, RmXmlWriterFrame, writer->stack->len - 1);
+	GString *buffer = writer->buffer;
+	RmXmlNode *child = frame->child;
+	gint idx;
+
+	if (child) {
+		frame->child = child->next;
+
+		if (child->type == RM_XMLNODE_TYPE_TAG) {
+			/* Frame pointer is invalid after push */
+			xml_writer_push(writer, child, frame->pretty, frame->depth + 1);
+		} else if (child->type == RM_XMLNODE_TYPE_DATA && child->data_size > 0) {
+			xml_writer_escape(buffer, child->data, child->data_size);
 		}
 
-		if (tab && pretty) {
-			text = g_string_append(text, tab);
-		}
-		if (prefix) {
-			g_string_append_printf(text, "</%s:%s>%s", prefix, node_name, formatting ? "\n" : "");
-		} else {
-			g_string_append_printf(text, "</%s>%s", node_name, formatting ? "\n" : "");
+		return;
+	}
+
+	if (frame->pretty && frame->formatting) {
+		for (idx = 0; idx < frame->depth; idx++) {
+			g_string_append_c(buffer, '\t');
 		}
-	} else {
-		g_string_append_printf(text, "/>%s", formatting ? "\n" : "");
 	}
 
-	g_free(node_name);
+	g_string_append(buffer, "</");
+	if (frame->node->prefix) {
+		g_string_append_printf(buffer, "%s:", frame->node->prefix);
+	}
+	xml_writer_escape(buffer, frame->node->name, -1);
+	g_string_append_printf(buffer, ">%s", frame->formatting ? "\n" : "");
 
-	g_free(tab);
+	g_array_set_size(writer->stack, writer->stack->len - 1);
+}
 
-	if (len) {
-		*len = text->len;
+/**
+ * rm_xml_writer_new:
+ * @node: a #RmXmlNode
+ *
+ * Create a formatting serializer for @node including xml declaration. @node must not be modified while it is in use.
+ *
+ * Returns: new #RmXmlWriter
+ */
+RmXmlWriter *rm_xml_writer_new(RmXmlNode *node)
+{
+	RmXmlWriter *writer;
+
+	g_return_val_if_fail(node != NULL, NULL);
+
+	writer = g_slice_new0(RmXmlWriter);
+	writer->buffer = g_string_sized_new(RM_XML_WRITER_CHUNK_SIZE + 256);
+	writer->stack = g_array_new(FALSE, FALSE, sizeof(RmXmlWriterFrame));
+
+	g_string_append(writer->buffer, RM_XML_DECLARATION);
+	xml_writer_push(writer, node, TRUE, 0);
+	writer->declaration = TRUE;
+
+	return writer;
+}
+
+/**
+ * rm_xml_writer_next:
+ * @writer: a #RmXmlWriter
+ * @data: return location for chunk
+ * @len: return location for length of chunk
+ *
+ * Produce next chunk of the document. The chunk stays valid until the next call.
+ *
+ * Returns: %TRUE if a chunk has been produced, %FALSE at the end of the document
+ */
+gboolean rm_xml_writer_next(RmXmlWriter *writer, const gchar **data, gsize *len)
+{
+	g_return_val_if_fail(writer != NULL, FALSE);
+
+	/* First chunk already contains start of document */
+	if (!writer->declaration) {
+		g_string_truncate(writer->buffer, 0);
 	}
+	writer->declaration = FALSE;
 
-	return g_string_free(text, FALSE);
+	while (writer->stack->len && writer->buffer->len < RM_XML_WRITER_CHUNK_SIZE) {
+		xml_writer_step(writer);
+	}
+
+	*data = writer->buffer->str;
+	*len = writer->buffer->len;
+
+	return writer->buffer->len > 0;
+}
+
+/**
+ * rm_xml_writer_free:
+ * @writer: a #RmXmlWriter
+ *
+ * Free serializer
+ */
+void rm_xml_writer_free(RmXmlWriter *writer)
+{
+	g_string_free(writer->buffer, TRUE);
+	g_array_free(writer->stack, TRUE);
+	g_slice_free(RmXmlWriter, writer);
+}
+
+/**
+ * rm_xmlnode_write_to_stream:
+ * @node: a #RmXmlNode
+ * @stream: a #GOutputStream
+ * @cancellable: a #GCancellable
+ * @error: a #GError
+ *
+ * Write formatted document of @node to @stream chunk by chunk
+ *
+ * Returns: %TRUE on success
+ */
+gboolean rm_xmlnode_write_to_stream(RmXmlNode *node, GOutputStream *stream, GCancellable *cancellable, GError **error)
+{
+	RmXmlWriter *writer;
+	const gchar *data;
+	gsize len;
+	gboolean ret = TRUE;
+
+	g_return_val_if_fail(node != NULL, FALSE);
+	g_return_val_if_fail(G_IS_OUTPUT_STREAM(stream), FALSE);
+
+	writer = rm_xml_writer_new(node);
+
+	while (ret && rm_xml_writer_next(writer, &data, &len)) {
+		ret = g_output_stream_write_all(stream, data, len, NULL, cancellable, error);
+	}
+
+	rm_xml_writer_free(writer);
+
+	return ret;
 }
 
 /**
@@ -366,24 +883,33 @@ static gchar *xmlnode_to_str_helper(RmXmlNode *node, gint *len, gboolean formatt
  */
 gchar *rm_xmlnode_to_formatted_str(RmXmlNode *node, gint *len)
 {
-	gchar *xml, *xml_with_declaration;
+	RmXmlWriter *writer;
+	GString *text = g_string_new(NULL);
+	const gchar *data;
+	gsize size;
 
 	g_return_val_if_fail(node != NULL, NULL);
 
-	xml = xmlnode_to_str_helper(node, len, TRUE, 0);
-	xml_with_declaration = g_strdup_printf("<?xml version='1.0' encoding='UTF-8' ?>\n\n%s", xml);
-	g_free(xml);
+	writer = rm_xml_writer_new(node);
+
+	while (rm_xml_writer_next(writer, &data, &size)) {
+		g_string_append_len(text, data, size);
+	}
+
+	rm_xml_writer_free(writer);
 
 	if (len) {
-		*len += sizeof("<?xml version='1.0' encoding='UTF-8' ?>\n\n") - 1;
+		*len = text->len;
 	}
 
-	return xml_with_declaration;
+	return g_string_free(text, FALSE);
 }
 
 /** RmXmlNode parser data structure */
 struct _xmlnode_parser_data {
 	RmXmlNode *current;
+	RmXmlArena *arena;
+	RmXmlNodeParseFlags flags;
 	gboolean error;
 };
 
@@ -396,8 +922,8 @@ void xmlnode_set_namespace(RmXmlNode *node, const gchar *xml_ns)
 {
 	g_return_if_fail(node != NULL);
 
-	g_free(node->xml_ns);
-	node->xml_ns = g_strdup(xml_ns);
+	xmlnode_str_free(node, node->xml_ns);
+	node->xml_ns = xmlnode_strdup(node, xml_ns);
 }
 
 /**
@@ -409,8 +935,8 @@ static void xmlnode_set_prefix(RmXmlNode *node, const gchar *prefix)
 {
 	g_return_if_fail(node != NULL);
 
-	g_free(node->prefix);
-	node->prefix = g_strdup(prefix);
+	xmlnode_str_free(node, node->prefix);
+	node->prefix = xmlnode_strdup(node, prefix);
 }
 
 /**
@@ -483,12 +1009,15 @@ static void xmlnode_set_attrib_with_prefix(RmXmlNode *node, const gchar *attr, c
 const gchar *rm_xmlnode_get_attrib(RmXmlNode *node, const gchar *attr)
 {
 	RmXmlNode *x;
+	GQuark quark;
 
 	g_return_val_if_fail(node != NULL, NULL);
 	g_return_val_if_fail(attr != NULL, NULL);
 
+	quark = g_quark_try_string(attr);
+
 	for (x = node->child; x != NULL; x = x->next) {
-		if (x->type == RM_XMLNODE_TYPE_ATTRIB && strcmp(attr, x->name) == 0) {
+		if (x->type == RM_XMLNODE_TYPE_ATTRIB && xmlnode_has_name(x, quark, attr)) {
 			return x->data;
 		}
 	}
@@ -497,30 +1026,56 @@ const gchar *rm_xmlnode_get_attrib(RmXmlNode *node, const gchar *attr)
 }
 
 /**
- * Unescape html text
- * @html html text
- * Returns: unescaped text
+ * Create a parser node, either on the heap or within the document arena
+ * @xpd RmXmlNode parser data
+ * @name node name
+ * @type a #RmXmlNodeType
+ * Returns: new node
  */
-static gchar *unescape_html(const gchar *html)
+static RmXmlNode *xmlnode_parser_new_node(struct _xmlnode_parser_data *xpd, const gchar *name, RmXmlNodeType type)
 {
-	if (html != NULL) {
-		const gchar *c = html;
-		GString *ret = g_string_new("");
-
-		while (*c) {
-			if (!strncmp(c, "<br>", 4)) {
-				ret = g_string_append_c(ret, '\n');
-				c += 4;
-			} else {
-				ret = g_string_append_c(ret, *c);
-				c++;
-			}
-		}
+	RmXmlNode *node;
 
-		return g_string_free(ret, FALSE);
+	if (!xpd->arena) {
+		return new_node(name, type);
 	}
 
-	return NULL;
+	node = xml_arena_alloc(xpd->arena, sizeof(RmXmlNode), TRUE);
+	memset(node, 0, sizeof(RmXmlNode));
+
+	/* Names are interned per document, quarks are only looked up so untrusted input can not grow them */
+	node->name = xml_arena_intern(xpd->arena, name);
+	node->quark = g_quark_try_string(name);
+	node->type = type;
+	node->arena = xpd->arena;
+
+	return node;
+}
+
+/**
+ * Copy attribute value and unescape html line breaks
+ * @xpd RmXmlNode parser data
+ * @value attribute value
+ * @len length of value
+ * Returns: unescaped copy of value
+ */
+static gchar *xmlnode_parser_unescape(struct _xmlnode_parser_data *xpd, const gchar *value, gsize len)
+{
+	gchar *ret = xpd->arena ? xml_arena_alloc(xpd->arena, len + 1, FALSE) : g_malloc(len + 1);
+	gsize src = 0;
+	gsize dst = 0;
+
+	while (src < len) {
+		if (len - src >= 4 && !strncmp(value + src, "<br>", 4)) {
+			ret[dst++] = '\n';
+			src += 4;
+		} else {
+			ret[dst++] = value[src++];
+		}
+	}
+	ret[dst] = '\0';
+
+	return ret;
 }
 
 /**
@@ -547,44 +1102,62 @@ static void xmlnode_parser_element_start_libxml(void *user_data, const xmlChar *
 		return;
 	}
 
+	node = xmlnode_parser_new_node(xpd, (const gchar*)element_name, RM_XMLNODE_TYPE_TAG);
+
 	if (xpd->current) {
-		node = rm_xmlnode_new_child(xpd->current, (const gchar*)element_name);
-	} else {
-		node = rm_xmlnode_new((const gchar*)element_name);
+		rm_xmlnode_insert_child(xpd->current, node);
+	} else if (xpd->arena) {
+		xpd->arena->root = node;
 	}
 
-	xmlnode_set_namespace(node, (const gchar*)xml_ns);
-	xmlnode_set_prefix(node, (const gchar*)prefix);
+	if (xpd->arena) {
+		node->xml_ns = xml_arena_intern(xpd->arena, (const gchar*)xml_ns);
+		node->prefix = xml_arena_intern(xpd->arena, (const gchar*)prefix);
+	} else {
+		xmlnode_set_namespace(node, (const gchar*)xml_ns);
+		xmlnode_set_prefix(node, (const gchar*)prefix);
+	}
 
 	if (nb_namespaces != 0) {
-		node->namespace_map = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+		if (xpd->arena) {
+			node->namespace_map = g_hash_table_new(g_str_hash, g_str_equal);
+			g_ptr_array_add(xpd->arena->tables, node->namespace_map);
+		} else {
+			node->namespace_map = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+		}
 
 		for (i = 0, j = 0; i < nb_namespaces; i++, j += 2) {
 			const gchar *key = (const gchar*)namespaces[j];
 			const gchar *val = (const gchar*)namespaces[j + 1];
 
-			g_hash_table_insert(node->namespace_map, g_strdup(key ? key : ""), g_strdup(val ? val : ""));
+			if (xpd->arena) {
+				g_hash_table_insert(node->namespace_map, xml_arena_intern(xpd->arena, key ? key : ""), xml_arena_intern(xpd->arena, val ? val : ""));
+			} else {
+				g_hash_table_insert(node->namespace_map, g_strdup(key ? key : ""), g_strdup(val ? val : ""));
+			}
 		}
 	}
 
 	for (i = 0; i < nb_attributes * 5; i += 5) {
 		const gchar *prefix = (const gchar*)attributes[i + 1];
-		gchar *txt;
-		gint attrib_len = attributes[i + 4] - attributes[i + 3];
-		gchar *attrib = g_malloc(attrib_len + 1);
-
-		memcpy(attrib, attributes[i + 3], attrib_len);
-		attrib[attrib_len] = '\0';
-		txt = attrib;
-		attrib = unescape_html(txt);
-		g_free(txt);
-
-		if (prefix && *prefix) {
-			xmlnode_set_attrib_with_prefix(node, (const gchar*)attributes[i], prefix, attrib);
+		gchar *attrib = xmlnode_parser_unescape(xpd, (const gchar*)attributes[i + 3], attributes[i + 4] - attributes[i + 3]);
+
+		if (xpd->arena) {
+			RmXmlNode *attrib_node = xmlnode_parser_new_node(xpd, (const gchar*)attributes[i], RM_XMLNODE_TYPE_ATTRIB);
+
+			attrib_node->data = attrib;
+			if (prefix && *prefix) {
+				attrib_node->prefix = xml_arena_intern(xpd->arena, prefix);
+			}
+			rm_xmlnode_insert_child(node, attrib_node);
 		} else {
-			rm_xmlnode_set_attrib(node, (const gchar*)attributes[i], attrib);
+			if (prefix && *prefix) {
+				xmlnode_set_attrib_with_prefix(node, (const gchar*)attributes[i], prefix, attrib);
+			} else {
+				rm_xmlnode_set_attrib(node, (const gchar*)attributes[i], attrib);
+			}
+			g_free(attrib);
 		}
-		g_free(attrib);
 	}
 
 	xpd->current = node;
@@ -605,10 +1178,17 @@ static void xmlnode_parser_element_end_libxml(void *user_data, const xmlChar *el
 		return;
 	}
 
+	if (xmlStrcmp((xmlChar*)xpd->current->name, element_name)) {
+		return;
+	}
+
+	/* All children are known now */
+	if (xpd->flags & RM_XMLNODE_PARSE_INDEX) {
+		xmlnode_index_build(xpd->current);
+	}
+
 	if (xpd->current->parent) {
-		if (!xmlStrcmp((xmlChar*)xpd->current->name, element_name)) {
-			xpd->current = xpd->current->parent;
-		}
+		xpd->current = xpd->current->parent;
 	}
 }
 
@@ -630,6 +1210,15 @@ static void xmlnode_parser_element_text_libxml(void *user_data, const xmlChar *t
 		return;
 	}
 
+	if (xpd->arena) {
+		RmXmlNode *node = xmlnode_parser_new_node(xpd, NULL, RM_XMLNODE_TYPE_DATA);
+
+		node->data = xml_arena_strndup(xpd->arena, (const gchar*)text, text_len);
+		node->data_size = text_len;
+		rm_xmlnode_insert_child(xpd->current, node);
+		return;
+	}
+
 	rm_xmlnode_insert_data(xpd->current, (const gchar*)text, text_len);
 }
 
@@ -722,15 +1311,39 @@ static xmlSAXHandler xml_node_parser_libxml = {
 };
 
 /**
- * rm_xmlnode_from_str:
+ * xmlnode_parser_free:
+ * @xpd: RmXmlNode parser data
+ *
+ * Free partially parsed tree
+ */
+static void xmlnode_parser_free(struct _xmlnode_parser_data *xpd)
+{
+	while (xpd->current && xpd->current->parent) {
+		xpd->current = xpd->current->parent;
+	}
+
+	if (xpd->arena) {
+		xml_arena_free(xpd->arena);
+	} else if (xpd->current) {
+		rm_xmlnode_free(xpd->current);
+	}
+
+	xpd->current = NULL;
+	xpd->arena = NULL;
+}
+
+/**
+ * rm_xmlnode_from_str_full:
  * @str: string
  * @size: size of string
+ * @flags: #RmXmlNodeParseFlags
  *
- * Create RmXmlNode from string
+ * Create RmXmlNode from string. With %RM_XMLNODE_PARSE_ARENA the tree is allocated in bulk,
+ * which is a lot cheaper for large documents that are only read and freed with rm_xmlnode_free() on the root.
  *
  * Returns: new #RmXmlNode
  */
-RmXmlNode *rm_xmlnode_from_str(const gchar *str, gssize size)
+RmXmlNode *rm_xmlnode_from_str_full(const gchar *str, gssize size, RmXmlNodeParseFlags flags)
 {
 	struct _xmlnode_parser_data *xpd;
 	RmXmlNode *ret;
@@ -741,31 +1354,35 @@ RmXmlNode *rm_xmlnode_from_str(const gchar *str, gssize size)
 	real_size = size < 0 ? strlen(str) : size;
 	xpd = g_new0(struct _xmlnode_parser_data, 1);
 
-	if (xmlSAXUserParseMemory(&xml_node_parser_libxml, xpd, str, real_size) < 0) {
-		while (xpd->current && xpd->current->parent) {
-			xpd->current = xpd->current->parent;
-		}
-
-		if (xpd->current) {
-			rm_xmlnode_free(xpd->current);
-		}
-		xpd->current = NULL;
+	xpd->flags = flags;
+	if (flags & RM_XMLNODE_PARSE_ARENA) {
+		xpd->arena = xml_arena_new();
 	}
-	ret = xpd->current;
-
-	if (xpd->error) {
-		ret = NULL;
 
-		if (xpd->current) {
-			rm_xmlnode_free(xpd->current);
-		}
+	if (xmlSAXUserParseMemory(&xml_node_parser_libxml, xpd, str, real_size) < 0 || xpd->error || !xpd->current) {
+		xmlnode_parser_free(xpd);
 	}
+	ret = xpd->current;
 
 	g_free(xpd);
 
 	return ret;
 }
 
+/**
+ * rm_xmlnode_from_str:
+ * @str: string
+ * @size: size of string
+ *
+ * Create RmXmlNode from string
+ *
+ * Returns: new #RmXmlNode
+ */
+RmXmlNode *rm_xmlnode_from_str(const gchar *str, gssize size)
+{
+	return rm_xmlnode_from_str_full(str, size, RM_XMLNODE_PARSE_DEFAULT);
+}
+
 /**
  * Get namespace
  * @node xml node
@@ -787,37 +1404,42 @@ const gchar *xmlnode_get_namespace(RmXmlNode *node)
  */
 RmXmlNode *xmlnode_get_child_with_namespace(const RmXmlNode *parent, const gchar *name, const gchar *ns)
 {
-	RmXmlNode *x, *ret = NULL;
-	gchar **names;
-	gchar *parent_name, *child_name;
+	RmXmlNode *x;
+	const gchar *child_name;
+	GQuark quark;
 
 	g_return_val_if_fail(parent != NULL, NULL);
 	g_return_val_if_fail(name != NULL, NULL);
 
-	names = g_strsplit(name, "/", 2);
-	parent_name = names[0];
-	child_name = names[1];
+	child_name = strchr(name, '/');
+	if (child_name) {
+		gchar *parent_name = g_strndup(name, child_name - name);
 
-	for (x = parent->child; x; x = x->next) {
-		const gchar *xml_ns = NULL;
+		x = xmlnode_get_child_with_namespace(parent, parent_name, ns);
+		g_free(parent_name);
 
-		if (ns != NULL) {
-			xml_ns = xmlnode_get_namespace(x);
-		}
-
-		if (x->type == RM_XMLNODE_TYPE_TAG && name && !strcmp(parent_name, x->name) && (!ns || (xml_ns && !strcmp(ns, xml_ns)))) {
-			ret = x;
-			break;
-		}
+		return x ? rm_xmlnode_get_child(x, child_name + 1) : NULL;
 	}
 
-	if (child_name && ret) {
-		ret = rm_xmlnode_get_child(ret, child_name);
+	quark = g_quark_try_string(name);
+
+	if (parent->index) {
+		x = g_hash_table_lookup(parent->index, name);
+	} else {
+		x = parent->child;
 	}
 
-	g_strfreev(names);
+	for (; x; x = x->next) {
+		if (x->type == RM_XMLNODE_TYPE_TAG && xmlnode_has_name(x, quark, name)) {
+			const gchar *xml_ns = xmlnode_get_namespace(x);
 
-	return ret;
+			if (!ns || (xml_ns && !strcmp(ns, xml_ns))) {
+				return x;
+			}
+		}
+	}
+
+	return NULL;
 }
 
 /**
@@ -851,14 +1473,12 @@ RmXmlNode *rm_xmlnode_get_next_twin(RmXmlNode *node)
 	g_return_val_if_fail(node->type == RM_XMLNODE_TYPE_TAG, NULL);
 
 	for (sibling = node->next; sibling; sibling = sibling->next) {
-		const gchar *xml_ns = NULL;
+		if (sibling->type == RM_XMLNODE_TYPE_TAG && xmlnode_has_name(sibling, node->quark, node->name)) {
+			const gchar *xml_ns = sibling->xml_ns;
 
-		if (ns != NULL) {
-			xml_ns = xmlnode_get_namespace(sibling);
-		}
-
-		if (sibling->type == RM_XMLNODE_TYPE_TAG && !strcmp(node->name, sibling->name) && (!ns || (xml_ns && !strcmp(ns, xml_ns)))) {
-			return sibling;
+			if (!ns || xml_ns == ns || (xml_ns && !strcmp(ns, xml_ns))) {
+				return sibling;
+			}
 		}
 	}
 
@@ -913,11 +1533,11 @@ gint xmlnode_set_data(RmXmlNode *node, gchar *data)
 	for (c = node->child; c != NULL; c = c->next) {
 		if (c->type == RM_XMLNODE_TYPE_DATA) {
 			if (c->data) {
-				g_free(c->data);
+				xmlnode_str_free(c, c->data);
 				c->data = NULL;
 			}
 
-			c->data = g_strdup(data);
+			c->data = xmlnode_strdup(c, data);
 			c->data_size = strlen(c->data);
 			ret = 0;
 		}
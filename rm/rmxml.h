@@ -43,6 +43,22 @@ typedef enum {
 	RM_XMLNODE_TYPE_DATA
 } RmXmlNodeType;
 
+/**
+ * RmXmlNodeParseFlags:
+ * @RM_XMLNODE_PARSE_DEFAULT: every node and string is allocated on its own
+ * @RM_XMLNODE_PARSE_ARENA: the whole tree is allocated from a few large blocks and released at once with the root node
+ * @RM_XMLNODE_PARSE_INDEX: elements with many children get an index for rm_xmlnode_get_child()
+ *
+ * Flags for rm_xmlnode_from_str_full().
+ */
+typedef enum {
+	RM_XMLNODE_PARSE_DEFAULT = 0,
+	RM_XMLNODE_PARSE_ARENA = 1 << 0,
+	RM_XMLNODE_PARSE_INDEX = 1 << 1
+} RmXmlNodeParseFlags;
+
+typedef struct _RmXmlArena RmXmlArena;
+
 /**
  * RmXmlNode:
  *
@@ -61,8 +77,18 @@ typedef struct _RmXmlNode {
 	struct _RmXmlNode *next;
 	gchar *prefix;
 	GHashTable *namespace_map;
+	RmXmlArena *arena;
+	GQuark quark;
+	GHashTable *index;
 } RmXmlNode;
 
+/**
+ * RmXmlWriter:
+ *
+ * The #RmXmlWriter-struct contains only private fileds and should not be directly accessed.
+ */
+typedef struct _RmXmlWriter RmXmlWriter;
+
 RmXmlNode *rm_xmlnode_new(const gchar *name);
 RmXmlNode *rm_xmlnode_new_child(RmXmlNode *parent, const gchar *name);
 RmXmlNode *rm_xml_read_from_file(const gchar *file_name);
@@ -71,12 +97,18 @@ RmXmlNode *rm_xmlnode_get_next_twin(RmXmlNode *node);
 gchar *rm_xmlnode_get_data(RmXmlNode *node);
 const gchar *rm_xmlnode_get_attrib(RmXmlNode *node, const gchar *attr);
 RmXmlNode *rm_xmlnode_from_str(const char *str, gssize size);
+RmXmlNode *rm_xmlnode_from_str_full(const gchar *str, gssize size, RmXmlNodeParseFlags flags);
 void rm_xmlnode_insert_data(RmXmlNode *node, const gchar *data, gssize size);
 void rm_xmlnode_free(RmXmlNode *node);
 void rm_xmlnode_set_attrib(RmXmlNode *node, const gchar *attr, const gchar *value);
 void rm_xmlnode_insert_child(RmXmlNode *parent, RmXmlNode *child);
 gchar *rm_xmlnode_to_formatted_str(RmXmlNode *node, gint *len);
 RmXmlNode *rm_xmlnode_copy(const RmXmlNode *node);
+gboolean rm_xmlnode_write_to_stream(RmXmlNode *node, GOutputStream *stream, GCancellable *cancellable, GError **error);
+
+RmXmlWriter *rm_xml_writer_new(RmXmlNode *node);
+gboolean rm_xml_writer_next(RmXmlWriter *writer, const gchar **data, gsize *len);
+void rm_xml_writer_free(RmXmlWriter *writer);
 
 G_END_DECLS
 
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <rm/rmaddressbook.h>
+#include <rm/rmcontact.h>
+#include <rm/rmobject.h>
+#include <rm/rmobjectemit.h>
+#include <rm/rmprofile.h>
+#include <rm/rmrouter.h>
+
+typedef struct {
+	RmProfile *profile;
+} addressbook_fixture;
+
+typedef struct {
+	const gchar *number;
+	const gchar *name;
+	gboolean fuzzy;
+} addressbook_test;
+
+static GList *test_addressbook_contacts = NULL;
+
+static GList *test_addressbook_get_contacts(void)
+{
+	return test_addressbook_contacts;
+}
+
+static RmAddressBook test_addressbook = {
+	"Test",
+	NULL,
+	test_addressbook_get_contacts,
+	NULL,
+	NULL,
+	NULL,
+	NULL
+};
+
+static void test_addressbook_add(const gchar *name, const gchar *number)
+{
+	RmContact *contact = rm_contact_new();
+	RmPhoneNumber *phone_number = g_slice_new0(RmPhoneNumber);
+
+	contact->name = g_strdup(name);
+	phone_number->type = RM_PHONE_NUMBER_TYPE_HOME;
+	phone_number->number = g_strdup(number);
+	contact->numbers = g_list_append(contact->numbers, phone_number);
+
+	test_addressbook_contacts = g_list_append(test_addressbook_contacts, contact);
+}
+
+static void test_addressbook_init(addressbook_fixture *af, gconstpointer user_data)
+{
+	rm_object = rm_object_new();
+	af->profile = rm_profile_add("Test");
+
+	g_settings_set_string(af->profile->settings, "international-access-code", "00");
+	g_settings_set_string(af->profile->settings, "country-code", "49");
+	g_settings_set_string(af->profile->settings, "national-access-code", "0");
+	g_settings_set_string(af->profile->settings, "area-code", "30");
+
+	rm_profile_set_active(af->profile);
+
+	test_addressbook_add("Alice", "030 1234567");
+	test_addressbook_add("Bob", "+49 40 7654321");
+	test_addressbook_add("Carol", "089 1112223");
+	test_addressbook_add("Frank", "2223334");
+	test_addressbook_add("Company", "030 55566-0");
+	test_addressbook_add("Dave", "040 3334445");
+	test_addressbook_add("Erin", "+49 40 3334445");
+	test_addressbook_add("Shop", "040 88899-0");
+	test_addressbook_add("Shop Service", "040 88899-10");
+
+	rm_addressbook_register(&test_addressbook);
+	rm_profile_set_addressbook(af->profile, &test_addressbook);
+}
+
+static void test_addressbook_shutdown(addressbook_fixture *af, gconstpointer user_data)
+{
+	rm_addressbook_unregister(&test_addressbook);
+
+	g_list_free_full(test_addressbook_contacts, (GDestroyNotify)rm_contact_free);
+	test_addressbook_contacts = NULL;
+}
+
+static void test_addressbook_resolve_unknown(addressbook_fixture *af, gconstpointer user_data)
+{
+	RmContact *contact = rm_contact_new();
+	gchar *number = g_strdup("030 7654321");
+	gint run;
+
+	contact->number = number;
+
+	/* First run misses the index, second run hits the negative cache entry */
+	for (run = 0; run < 2; run++) {
+		rm_object_emit_contact_process(contact);
+
+		g_assert_true(contact->number == number);
+		g_assert_cmpstr(contact->number, ==, "030 7654321");
+		g_assert_null(contact->name);
+	}
+
+	rm_contact_free(contact);
+}
+
+static void test_addressbook_resolve_known(addressbook_fixture *af, gconstpointer user_data)
+{
+	RmContact *contact = rm_contact_new();
+	gchar *number = g_strdup("+49 30 1234567");
+	gint run;
+
+	contact->number = number;
+
+	/* First run fills the cache from the index, second run is a cache hit */
+	for (run = 0; run < 2; run++) {
+		g_clear_pointer(&contact->name, g_free);
+
+		rm_object_emit_contact_process(contact);
+
+		g_assert_true(contact->number == number);
+		g_assert_cmpstr(contact->name, ==, "Alice");
+	}
+
+	rm_contact_free(contact);
+}
+
+static gchar *test_addressbook_resolve(const gchar *number)
+{
+	RmContact *contact = rm_contact_new();
+	gchar *name;
+
+	contact->number = g_strdup(number);
+	rm_object_emit_contact_process(contact);
+
+	name = g_strdup(contact->name);
+	rm_contact_free(contact);
+
+	return name;
+}
+
+static void test_addressbook_index(addressbook_fixture *af, gconstpointer user_data)
+{
+	const addressbook_test tests[] = {
+		{ "030 1234567", "Alice" },
+		{ "0301234567", "Alice" },
+		{ "+49 30 1234567", "Alice" },
+		{ "0049301234567", "Alice" },
+		{ "1234567", "Alice" },
+		{ "040 7654321", "Bob" },
+		{ "+49 (40) 765 43 21", "Bob" },
+		{ "089/1112223", "Carol" },
+		{ "2223334", "Frank" },
+		{ "030 2223334", "Frank" },
+		/* Same trailing digits in another area */
+		{ "030 7654321", NULL },
+		{ "7654321", NULL },
+		{ "040 1234567", NULL },
+	};
+	guint fuzzy = rm_addressbook_get_fuzzy_matches();
+	guint idx;
+
+	for (idx = 0; idx < G_N_ELEMENTS(tests); idx++) {
+		gchar *name = test_addressbook_resolve(tests[idx].number);
+
+		g_test_message("%s -> %s", tests[idx].number, name ? name : "(unknown)");
+		g_assert_cmpstr(name, ==, tests[idx].name);
+		g_free(name);
+	}
+
+	/* All numbers are resolved by the normalized number index */
+	g_assert_cmpuint(rm_addressbook_get_fuzzy_matches(), ==, fuzzy);
+}
+
+static void test_addressbook_fuzzy(addressbook_fixture *af, gconstpointer user_data)
+{
+	const addressbook_test tests[] = {
+		/* Trailing digits, caller dialed with an outside line prefix */
+		{ "0 089 1112223", "Carol", TRUE },
+		{ "0 040 7654321", "Bob", TRUE },
+		/* Trailing digits shared by two contacts */
+		{ "0 040 3334445", NULL, FALSE },
+		/* Extension base numbers */
+		{ "030 55566-0", "Company", FALSE },
+		{ "030 55566 1", "Company", TRUE },
+		{ "030 55566 123", "Company", TRUE },
+		{ "030 55566 12345", NULL, FALSE },
+		{ "040 55566 12", NULL, FALSE },
+		/* Extension base shared by two contacts */
+		{ "040 88899-0", "Shop", FALSE },
+		{ "040 88899 55", NULL, FALSE },
+	};
+	guint idx;
+
+	for (idx = 0; idx < G_N_ELEMENTS(tests); idx++) {
+		guint fuzzy = rm_addressbook_get_fuzzy_matches();
+		gchar *name = test_addressbook_resolve(tests[idx].number);
+
+		g_test_message("%s -> %s", tests[idx].number, name ? name : "(unknown)");
+		g_assert_cmpstr(name, ==, tests[idx].name);
+		g_assert_cmpuint(rm_addressbook_get_fuzzy_matches(), ==, fuzzy + (tests[idx].fuzzy ? 1 : 0));
+		g_free(name);
+	}
+}
+
+static void test_addressbook_single_cb(RmObject *obj, RmContact *contact, gpointer user_data)
+{
+	GPtrArray *seen = user_data;
+
+	g_ptr_array_add(seen, contact);
+}
+
+static void test_addressbook_batch(addressbook_fixture *af, gconstpointer user_data)
+{
+	GPtrArray *contacts = g_ptr_array_new_with_free_func((GDestroyNotify)rm_contact_free);
+	GPtrArray *seen = g_ptr_array_new();
+	RmContact *contact;
+	gulong id;
+	guint idx;
+
+	/* Resolver which only knows the single variant */
+	id = g_signal_connect(rm_object, "contact-process", G_CALLBACK(test_addressbook_single_cb), seen);
+
+	for (idx = 0; idx < 2; idx++) {
+		contact = rm_contact_new();
+		contact->number = g_strdup(idx ? "040 7654321" : "030 1234567");
+		g_ptr_array_add(contacts, contact);
+	}
+
+	rm_object_emit_contacts_process(contacts);
+
+	/* Batch is resolved by the address book and still passed on to single resolvers once */
+	g_assert_cmpuint(seen->len, ==, 2);
+	g_assert_cmpstr(((RmContact*)g_ptr_array_index(seen, 0))->name, ==, "Alice");
+	g_assert_cmpstr(((RmContact*)g_ptr_array_index(seen, 1))->name, ==, "Bob");
+
+	/* Single lookups reach both */
+	contact = rm_contact_new();
+	contact->number = g_strdup("089 1112223");
+	rm_object_emit_contact_process(contact);
+	g_assert_cmpuint(seen->len, ==, 3);
+	g_assert_cmpstr(contact->name, ==, "Carol");
+	rm_contact_free(contact);
+
+	g_signal_handler_disconnect(rm_object, id);
+	g_ptr_array_free(seen, TRUE);
+	g_ptr_array_free(contacts, TRUE);
+}
+
+static void test_addressbook_batch_shared(addressbook_fixture *af, gconstpointer user_data)
+{
+	RmContact *results[2];
+	gint run;
+
+	/* Batch hits are references to the cached result, not copies */
+	for (run = 0; run < 2; run++) {
+		GPtrArray *contacts = g_ptr_array_new_with_free_func((GDestroyNotify)rm_contact_free);
+		RmContact *contact = rm_contact_new();
+
+		contact->number = g_strdup("+49 30 1234567");
+		g_ptr_array_add(contacts, contact);
+
+		rm_object_emit_contacts_process(contacts);
+
+		results[run] = g_object_ref(g_ptr_array_index(contacts, 0));
+		g_assert_true(results[run] != contact);
+		g_assert_cmpstr(results[run]->name, ==, "Alice");
+		g_assert_cmpstr(results[run]->number, ==, "+49 30 1234567");
+
+		g_ptr_array_free(contacts, TRUE);
+	}
+
+	g_assert_true(results[0] == results[1]);
+
+	/* Writers get their own copy */
+	results[1] = rm_contact_make_writable(results[1]);
+	g_assert_true(results[0] != results[1]);
+
+	rm_contact_free(results[1]);
+	rm_contact_free(results[0]);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add("/addressbook/resolve-unknown", addressbook_fixture, "", test_addressbook_init, test_addressbook_resolve_unknown, test_addressbook_shutdown);
+	g_test_add("/addressbook/resolve-known", addressbook_fixture, "", test_addressbook_init, test_addressbook_resolve_known, test_addressbook_shutdown);
+	g_test_add("/addressbook/index", addressbook_fixture, "", test_addressbook_init, test_addressbook_index, test_addressbook_shutdown);
+	g_test_add("/addressbook/fuzzy", addressbook_fixture, "", test_addressbook_init, test_addressbook_fuzzy, test_addressbook_shutdown);
+	g_test_add("/addressbook/batch", addressbook_fixture, "", test_addressbook_init, test_addressbook_batch, test_addressbook_shutdown);
+	g_test_add("/addressbook/batch-shared", addressbook_fixture, "", test_addressbook_init, test_addressbook_batch_shared, test_addressbook_shutdown);
+
+	return g_test_run();
+}
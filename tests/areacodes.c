@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <rm/rm.h>
+
+#include "../plugins/areacodes_global/trie.c"
+
+#define TEST_AREACODES_HEADER "\"Country\",\"Country Code\",\"Area\",\"Area Code\""
+
+static AreaCodesTrie *test_areacodes_trie(void)
+{
+	AreaCodesTrieBuilder *builder = areacodes_trie_builder_new();
+	AreaCodesTrie *trie;
+	GBytes *bytes;
+
+	areacodes_trie_builder_add(builder, "Germany", "49", "Berlin", "030");
+	areacodes_trie_builder_add(builder, "Germany", "49", "M\xfcnchen", "089");
+	areacodes_trie_builder_add(builder, "Germany", "49", "Bad Soden", "06196");
+	areacodes_trie_builder_add(builder, "Germany", "49", "Frankfurt", "069");
+	areacodes_trie_builder_add(builder, "Ireland", "353", "Dublin", "01");
+	areacodes_trie_builder_add(builder, "Anguilla", "1", "Anguilla", "(1+)264");
+
+	bytes = areacodes_trie_builder_end(builder);
+	trie = areacodes_trie_new(bytes);
+	g_bytes_unref(bytes);
+
+	return trie;
+}
+
+static void test_areacodes_lookup(void)
+{
+	AreaCodesTrie *trie = test_areacodes_trie();
+
+	g_assert_nonnull(trie);
+
+	g_assert_cmpstr(areacodes_trie_lookup(trie, "49301234"), ==, "Berlin");
+	g_assert_cmpstr(areacodes_trie_lookup(trie, "49891234"), ==, "M\xc3\xbcnchen");
+	g_assert_cmpstr(areacodes_trie_lookup(trie, "4969123"), ==, "Frankfurt");
+	g_assert_cmpstr(areacodes_trie_lookup(trie, "49619612"), ==, "Bad Soden");
+
+	/* Longest prefix wins, short area codes match as well */
+	g_assert_cmpstr(areacodes_trie_lookup(trie, "3531234567"), ==, "Dublin");
+
+	g_assert_null(areacodes_trie_lookup(trie, "4940123"));
+	g_assert_null(areacodes_trie_lookup(trie, "49"));
+	g_assert_null(areacodes_trie_lookup(trie, "1264123"));
+	g_assert_null(areacodes_trie_lookup(trie, "99"));
+	g_assert_null(areacodes_trie_lookup(trie, ""));
+
+	areacodes_trie_free(trie);
+}
+
+static void test_areacodes_invalid(void)
+{
+	AreaCodesTrie *trie = test_areacodes_trie();
+	GBytes *bytes = g_bytes_new_from_bytes(trie->bytes, 0, g_bytes_get_size(trie->bytes) - 1);
+
+	g_assert_null(areacodes_trie_new(bytes));
+
+	g_bytes_unref(bytes);
+	areacodes_trie_free(trie);
+}
+
+static void test_areacodes_byte_order(void)
+{
+	AreaCodesTrie *trie = test_areacodes_trie();
+	const guint8 *data = g_bytes_get_data(trie->bytes, NULL);
+	const guint8 marker[] = { 0x04, 0x03, 0x02, 0x01 };
+
+	/* Blob is little endian on every host */
+	g_assert_cmpmem(data + G_STRUCT_OFFSET(AreaCodesTrieHeader, byte_order), 4, marker, 4);
+	g_assert_cmpuint(data[G_STRUCT_OFFSET(AreaCodesTrieHeader, version)], ==, AREACODES_TRIE_VERSION);
+
+	areacodes_trie_free(trie);
+}
+
+static gpointer test_areacodes_parse_line(gpointer ptr, const RmCsvField *fields, guint count)
+{
+	if (count == 4) {
+		areacodes_trie_builder_add(ptr, fields[0].str, fields[1].str, fields[2].str, fields[3].str);
+	}
+
+	return ptr;
+}
+
+static void test_areacodes_bench(void)
+{
+	const gchar *file_name = g_test_get_filename(G_TEST_DIST, "..", "plugins", "areacodes_global", "share", "globalareacodes.csv", NULL);
+	AreaCodesTrieBuilder *builder = areacodes_trie_builder_new();
+	AreaCodesTrie *trie;
+	GFile *file = g_file_new_for_path(file_name);
+	GFileInputStream *stream;
+	GBytes *bytes;
+	GRand *rand = g_rand_new_with_seed(42);
+	gchar **numbers = g_new(gchar*, 100000);
+	gint found = 0;
+	gint idx;
+
+	stream = g_file_read(file, NULL, NULL);
+	g_object_unref(file);
+	if (!stream) {
+		g_test_skip("globalareacodes.csv not found");
+		g_bytes_unref(areacodes_trie_builder_end(builder));
+		g_free(numbers);
+		g_rand_free(rand);
+		return;
+	}
+
+	g_test_timer_start();
+	rm_csv_parse_stream(G_INPUT_STREAM(stream), TEST_AREACODES_HEADER, test_areacodes_parse_line, builder, NULL, NULL);
+	bytes = areacodes_trie_builder_end(builder);
+	g_test_message("built %" G_GSIZE_FORMAT " byte trie in %f seconds", g_bytes_get_size(bytes), g_test_timer_elapsed());
+	g_object_unref(stream);
+
+	trie = areacodes_trie_new(bytes);
+	g_assert_nonnull(trie);
+
+	/* Random numbers, half of them with a common country code */
+	for (idx = 0; idx < 100000; idx++) {
+		numbers[idx] = g_strdup_printf("%s%u", idx % 2 ? "49" : "", g_rand_int(rand));
+	}
+
+	g_test_timer_start();
+	for (idx = 0; idx < 100000; idx++) {
+		if (areacodes_trie_lookup(trie, numbers[idx])) {
+			found++;
+		}
+	}
+	g_test_minimized_result(g_test_timer_elapsed(), "looked up 100000 numbers in %f seconds (%d found)", g_test_timer_last(), found);
+
+	for (idx = 0; idx < 100000; idx++) {
+		g_free(numbers[idx]);
+	}
+	g_free(numbers);
+	g_rand_free(rand);
+	areacodes_trie_free(trie);
+	g_bytes_unref(bytes);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/areacodes/lookup", test_areacodes_lookup);
+	g_test_add_func("/areacodes/invalid", test_areacodes_invalid);
+	g_test_add_func("/areacodes/byte-order", test_areacodes_byte_order);
+
+	if (g_test_perf()) {
+		g_test_add_func("/areacodes/bench", test_areacodes_bench);
+	}
+
+	return g_test_run();
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <rm/rm.h>
+
+static gsize test_cache_size(gconstpointer value)
+{
+	return strlen(value) + 1;
+}
+
+static void test_cache_lru(void)
+{
+	RmCache *cache = rm_cache_new(2, 0, (GBoxedCopyFunc)g_strdup, g_free, NULL);
+	RmCacheStats stats;
+	gpointer value;
+
+	rm_cache_insert(cache, "0301", g_strdup("Doe"));
+	rm_cache_insert(cache, "0302", NULL);
+
+	/* Touch first entry, second one is evicted next */
+	g_assert_true(rm_cache_lookup(cache, "0301", &value));
+	g_assert_cmpstr(value, ==, "Doe");
+	g_free(value);
+
+	rm_cache_insert(cache, "0303", g_strdup("Smith"));
+
+	g_assert_false(rm_cache_lookup(cache, "0302", &value));
+	g_assert_null(value);
+	g_assert_true(rm_cache_lookup(cache, "0301", &value));
+	g_free(value);
+	g_assert_true(rm_cache_lookup(cache, "0303", &value));
+	g_free(value);
+
+	rm_cache_get_stats(cache, &stats);
+	g_assert_cmpuint(stats.hits, ==, 3);
+	g_assert_cmpuint(stats.misses, ==, 1);
+	g_assert_cmpuint(stats.evictions, ==, 1);
+	g_assert_cmpuint(stats.entries, ==, 2);
+
+	rm_cache_free(cache);
+}
+
+static void test_cache_negative(void)
+{
+	RmCache *cache = rm_cache_new(16, 0, NULL, g_free, NULL);
+	gpointer value = GINT_TO_POINTER(1);
+
+	rm_cache_insert(cache, "0301", NULL);
+
+	/* Negative entry is a valid hit without value */
+	g_assert_true(rm_cache_lookup(cache, "0301", &value));
+	g_assert_null(value);
+
+	rm_cache_remove_all(cache);
+	g_assert_false(rm_cache_lookup(cache, "0301", &value));
+
+	rm_cache_free(cache);
+}
+
+static void test_cache_memory(void)
+{
+	RmCache *cache = rm_cache_new(1000, 512, NULL, g_free, test_cache_size);
+	RmCacheStats stats;
+	gint idx;
+
+	for (idx = 0; idx < 100; idx++) {
+		gchar *key = g_strdup_printf("%d", idx);
+
+		rm_cache_insert(cache, key, g_strdup("a cached value"));
+		g_free(key);
+	}
+
+	rm_cache_get_stats(cache, &stats);
+	g_assert_cmpuint(stats.memory, <=, 512);
+	g_assert_cmpuint(stats.entries + stats.evictions, ==, 100);
+
+	rm_cache_free(cache);
+}
+
+static void test_cache_ttl(void)
+{
+	RmCache *cache = rm_cache_new(16, 0, NULL, g_free, NULL);
+	RmCacheStats stats;
+	gpointer value;
+
+	rm_cache_set_ttl(cache, 0, 1);
+	rm_cache_insert(cache, "0301", NULL);
+	rm_cache_insert(cache, "0302", g_strdup("Doe"));
+
+	g_usleep(G_USEC_PER_SEC + G_USEC_PER_SEC / 10);
+
+	g_assert_false(rm_cache_lookup(cache, "0301", &value));
+	g_assert_true(rm_cache_lookup(cache, "0302", &value));
+
+	rm_cache_get_stats(cache, &stats);
+	g_assert_cmpuint(stats.expirations, ==, 1);
+
+	rm_cache_free(cache);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/cache/lru", test_cache_lru);
+	g_test_add_func("/cache/negative", test_cache_negative);
+	g_test_add_func("/cache/memory", test_cache_memory);
+
+	if (g_test_slow()) {
+		g_test_add_func("/cache/ttl", test_cache_ttl);
+	}
+
+	return g_test_run();
+}
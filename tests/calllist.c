@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "../plugins/fritzbox/calllist.c"
+
+static void test_calllist_collect(const gchar * const *fields, gpointer user_data)
+{
+	GPtrArray *calls = user_data;
+	CallListField check[] = { CALLLIST_FIELD_ID, CALLLIST_FIELD_TYPE, CALLLIST_FIELD_CALLER, CALLLIST_FIELD_NAME, CALLLIST_FIELD_PATH };
+	GString *call = g_string_new(NULL);
+	guint idx;
+
+	for (idx = 0; idx < G_N_ELEMENTS(check); idx++) {
+		g_string_append_printf(call, "%s%s", idx ? "|" : "", fields[check[idx]] ? fields[check[idx]] : "-");
+	}
+
+	g_ptr_array_add(calls, g_string_free(call, FALSE));
+}
+
+static gboolean test_calllist_parse(const gchar *xml, GPtrArray *calls)
+{
+	GInputStream *stream = g_memory_input_stream_new_from_data(xml, -1, NULL);
+	GError *error = NULL;
+	gboolean ret;
+
+	ret = calllist_parse_stream(stream, test_calllist_collect, calls, NULL, &error);
+	g_clear_error(&error);
+	g_object_unref(stream);
+
+	return ret;
+}
+
+static void test_calllist_fields(void)
+{
+	GPtrArray *calls = g_ptr_array_new_with_free_func(g_free);
+	const gchar *xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			   "<root xmlns=\"urn:dslforum-org:service\"><timestamp>1</timestamp>\n"
+			   "<Call><Id>12</Id><Type>1</Type><Caller>0301234</Caller><Name>Doe &amp; Sons</Name><Path /></Call>\n"
+			   "<Call><Id>11</Id><Type>3</Type><Caller></Caller><Name><Id>99</Id></Name></Call>\n"
+			   "</root>";
+
+	g_assert_true(test_calllist_parse(xml, calls));
+
+	g_assert_cmpuint(calls->len, ==, 2);
+	g_assert_cmpstr(g_ptr_array_index(calls, 0), ==, "12|1|0301234|Doe & Sons|-");
+	/* Only direct children of <Call> are fields */
+	g_assert_cmpstr(g_ptr_array_index(calls, 1), ==, "11|3|-|-|-");
+
+	g_ptr_array_free(calls, TRUE);
+}
+
+static void test_calllist_invalid(void)
+{
+	GPtrArray *calls = g_ptr_array_new_with_free_func(g_free);
+
+	g_assert_false(test_calllist_parse("<root><Call><Id>1</Id></Call><Call>", calls));
+	g_assert_cmpuint(calls->len, ==, 1);
+
+	g_ptr_array_free(calls, TRUE);
+}
+
+static void test_calllist_large(void)
+{
+	GPtrArray *calls = g_ptr_array_new_with_free_func(g_free);
+	GString *xml = g_string_new("<root>");
+	gint idx;
+
+	/* Calls span several read chunks */
+	for (idx = 0; idx < 5000; idx++) {
+		g_string_append_printf(xml, "<Call><Id>%d</Id><Type>1</Type><Caller>0%d</Caller><Name>Name %d</Name><Path>/p/%d</Path></Call>", idx, idx, idx, idx);
+	}
+	g_string_append(xml, "</root>");
+
+	g_assert_true(test_calllist_parse(xml->str, calls));
+	g_assert_cmpuint(calls->len, ==, 5000);
+	g_assert_cmpstr(g_ptr_array_index(calls, 4999), ==, "4999|1|04999|Name 4999|/p/4999");
+
+	g_string_free(xml, TRUE);
+	g_ptr_array_free(calls, TRUE);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/calllist/fields", test_calllist_fields);
+	g_test_add_func("/calllist/invalid", test_calllist_invalid);
+	g_test_add_func("/calllist/large", test_calllist_large);
+
+	return g_test_run();
+}
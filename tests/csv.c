@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <rm/rm.h>
+
+#include "../plugins/fritzbox/csv.h"
+#include "../plugins/fritzbox/csv-private.h"
+
+#define TEST_CSV_HEADER "Name;Number;Note"
+
+static gpointer test_csv_parse_line(gpointer ptr, const RmCsvField *fields, guint count)
+{
+	GPtrArray *lines = ptr;
+	GString *line = g_string_new(NULL);
+	guint idx;
+
+	for (idx = 0; idx < count; idx++) {
+		g_assert_cmpuint(strlen(fields[idx].str), ==, fields[idx].len);
+		g_string_append_printf(line, "[%s]", fields[idx].str);
+	}
+
+	g_ptr_array_add(lines, g_string_free(line, FALSE));
+
+	return lines;
+}
+
+static void test_csv_quoting(void)
+{
+	GPtrArray *lines = g_ptr_array_new_with_free_func(g_free);
+	const gchar *data = "sep=;\r\n"
+			    TEST_CSV_HEADER "\r\n"
+			    "Doe;0301234;\r\n"
+			    "\"Doe; John\";\"0301234\";\"says \"\"hi\"\"\"\r\n"
+			    "\r\n"
+			    "Smith \"Jr\";;\"multi\nline\"";
+
+	g_assert_nonnull(rm_csv_parse_data(data, TEST_CSV_HEADER, test_csv_parse_line, lines));
+
+	g_assert_cmpuint(lines->len, ==, 3);
+	g_assert_cmpstr(g_ptr_array_index(lines, 0), ==, "[Doe][0301234][]");
+	g_assert_cmpstr(g_ptr_array_index(lines, 1), ==, "[Doe; John][0301234][says \"hi\"]");
+	g_assert_cmpstr(g_ptr_array_index(lines, 2), ==, "[Smith \"Jr\"][][multi\nline]");
+
+	g_ptr_array_free(lines, TRUE);
+}
+
+static void test_csv_header(void)
+{
+	GPtrArray *lines = g_ptr_array_new_with_free_func(g_free);
+
+	g_assert_null(rm_csv_parse_data("Unknown;Header\nDoe;0301234;\n", TEST_CSV_HEADER, test_csv_parse_line, lines));
+	g_assert_cmpuint(lines->len, ==, 0);
+
+	g_ptr_array_free(lines, TRUE);
+}
+
+static void test_csv_stream(void)
+{
+	GPtrArray *lines = g_ptr_array_new_with_free_func(g_free);
+	GString *data = g_string_new("sep=;\n" TEST_CSV_HEADER "\n");
+	GInputStream *stream;
+	gint idx;
+
+	/* Exceed a single read chunk */
+	for (idx = 0; idx < 5000; idx++) {
+		g_string_append_printf(data, "\"Name %d\";%d;\n", idx, idx);
+	}
+
+	stream = g_memory_input_stream_new_from_data(data->str, data->len, NULL);
+	g_assert_nonnull(rm_csv_parse_stream(stream, TEST_CSV_HEADER, test_csv_parse_line, lines, NULL, NULL));
+
+	g_assert_cmpuint(lines->len, ==, 5000);
+	g_assert_cmpstr(g_ptr_array_index(lines, 4999), ==, "[Name 4999][4999][]");
+
+	g_object_unref(stream);
+	g_string_free(data, TRUE);
+	g_ptr_array_free(lines, TRUE);
+}
+
+static void test_csv_fritzbox_dialects(void)
+{
+	guint idx;
+
+	for (idx = 0; csv_fritzbox_headers[idx]; idx++) {
+		gchar *data = g_strdup_printf("sep=;\n%s\n1;01.02.17 10:00;Doe;0301234;Phone;0307777;0:05\n", csv_fritzbox_headers[idx]);
+		GList *list = csv_parse_fritzbox_journal_data(NULL, data);
+		RmCallEntry *call;
+
+		g_assert_cmpuint(g_list_length(list), ==, 1);
+		call = list->data;
+		g_assert_cmpint(call->type, ==, RM_CALL_ENTRY_TYPE_INCOMING);
+		g_assert_cmpstr(call->date_time, ==, "01.02.17 10:00");
+		g_assert_cmpstr(call->remote->name, ==, "Doe");
+		g_assert_cmpstr(call->remote->number, ==, "0301234");
+		g_assert_cmpstr(call->local->name, ==, "Phone");
+		g_assert_cmpstr(call->local->number, ==, "0307777");
+		g_assert_cmpstr(call->duration, ==, "0:05");
+
+		g_list_free_full(list, rm_call_entry_free);
+		g_free(data);
+	}
+}
+
+static void test_csv_fritzbox_fields(void)
+{
+	GList *list;
+
+	/* Lines with extra or missing fields are not journal entries */
+	list = csv_parse_fritzbox_journal_data(NULL, "sep=;\n" CSV_FRITZBOX_JOURNAL_EN "\n"
+					       "1;01.02.17 10:00;Doe;0301234;Phone;0307777;0:05;Extra\n"
+					       "1;01.02.17 10:00;Doe;0301234;Phone;0307777\n");
+	g_assert_null(list);
+}
+
+static void test_csv_fritzbox_columns(void)
+{
+	CsvFritzboxDialect dialect;
+
+	/* Column map follows the header, repeated names are assigned in column order */
+	g_assert_true(csv_fritzbox_dialect_init(&dialect, "Date;Type;Telephone number;Name;Duration;Telephone number;Extension;Device"));
+	g_assert_cmpuint(dialect.fields, ==, 8);
+	g_assert_cmpuint(dialect.columns[CSV_FRITZBOX_COLUMN_TYPE], ==, 1);
+	g_assert_cmpuint(dialect.columns[CSV_FRITZBOX_COLUMN_DATE_TIME], ==, 0);
+	g_assert_cmpuint(dialect.columns[CSV_FRITZBOX_COLUMN_REMOTE_NAME], ==, 3);
+	g_assert_cmpuint(dialect.columns[CSV_FRITZBOX_COLUMN_REMOTE_NUMBER], ==, 2);
+	g_assert_cmpuint(dialect.columns[CSV_FRITZBOX_COLUMN_LOCAL_NAME], ==, 6);
+	g_assert_cmpuint(dialect.columns[CSV_FRITZBOX_COLUMN_LOCAL_NUMBER], ==, 5);
+	g_assert_cmpuint(dialect.columns[CSV_FRITZBOX_COLUMN_DURATION], ==, 4);
+
+	g_test_expect_message("rm", G_LOG_LEVEL_WARNING, "*lacks column*");
+	g_assert_false(csv_fritzbox_dialect_init(&dialect, "Type;Date;Name;Number;Duration"));
+	g_test_assert_expected_messages();
+	g_assert_cmpuint(dialect.fields, ==, G_MAXUINT);
+}
+
+static void test_csv_fritzbox_unknown(void)
+{
+	GList *list;
+
+	g_test_expect_message("rm", G_LOG_LEVEL_WARNING, "*Unknown journal dialect*");
+	list = csv_parse_fritzbox_journal_data(NULL, "Art;Zeit;Name;Nummer;Nebenstelle;Eigene Rufnummer;Dauer\n1;01.02.17 10:00;Doe;0301234;Phone;0307777;0:05\n");
+	g_test_assert_expected_messages();
+
+	g_assert_null(list);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/csv/quoting", test_csv_quoting);
+	g_test_add_func("/csv/header", test_csv_header);
+	g_test_add_func("/csv/stream", test_csv_stream);
+	g_test_add_func("/csv/fritzbox-dialects", test_csv_fritzbox_dialects);
+	g_test_add_func("/csv/fritzbox-fields", test_csv_fritzbox_fields);
+	g_test_add_func("/csv/fritzbox-columns", test_csv_fritzbox_columns);
+	g_test_add_func("/csv/fritzbox-unknown", test_csv_fritzbox_unknown);
+
+	return g_test_run();
+}
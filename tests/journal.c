@@ -0,0 +1,380 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <rm/rm.h>
+
+static RmCallEntry *test_journal_call(RmCallEntryTypes type, const gchar *date_time, const gchar *number)
+{
+	return rm_call_entry_new(type, date_time, "", number, "", "1234", "0:01", NULL);
+}
+
+static void test_journal_duplicates(void)
+{
+	RmJournal *journal = rm_journal_new();
+
+	g_assert_true(rm_journal_add(journal, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "01.02.17 10:00", "0301234")));
+	g_assert_false(rm_journal_add(journal, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "01.02.17 10:00", "0301234")));
+	g_assert_true(rm_journal_add(journal, test_journal_call(RM_CALL_ENTRY_TYPE_OUTGOING, "01.02.17 10:00", "0301234")));
+	g_assert_true(rm_journal_add(journal, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "01.02.17 10:00", "0405678")));
+
+	g_assert_cmpuint(rm_journal_get_length(journal), ==, 3);
+
+	rm_journal_destroy(journal);
+}
+
+static void test_journal_merge_voice(void)
+{
+	RmJournal *journal = rm_journal_new();
+	RmCallEntry *call;
+
+	rm_journal_add(journal, test_journal_call(RM_CALL_ENTRY_TYPE_MISSED, "01.02.17 10:00", "0301234"));
+
+	call = test_journal_call(RM_CALL_ENTRY_TYPE_VOICE, "01.02.17 10:00", "0301234");
+	call->priv = g_strdup("rec.0.000");
+	g_assert_false(rm_journal_add(journal, call));
+
+	g_assert_cmpuint(rm_journal_get_length(journal), ==, 1);
+	call = rm_journal_get_entry(journal, 0);
+	g_assert_cmpint(call->type, ==, RM_CALL_ENTRY_TYPE_VOICE);
+	g_assert_cmpstr(call->priv, ==, "rec.0.000");
+
+	/* Merged entry must be found with its new type */
+	g_assert_false(rm_journal_add(journal, test_journal_call(RM_CALL_ENTRY_TYPE_VOICE, "01.02.17 10:00", "0301234")));
+
+	rm_journal_destroy(journal);
+}
+
+static void test_journal_sorted(void)
+{
+	RmJournal *journal = rm_journal_new();
+	GList *list;
+
+	rm_journal_add(journal, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "01.02.16 10:00", "1"));
+	rm_journal_add(journal, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "03.02.17 09:00", "2"));
+	rm_journal_add(journal, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "03.02.17 11:00", "3"));
+
+	list = rm_journal_steal_list(journal);
+	g_assert_cmpuint(g_list_length(list), ==, 3);
+	g_assert_cmpstr(((RmCallEntry*)list->data)->remote->number, ==, "3");
+	g_assert_cmpstr(((RmCallEntry*)list->next->data)->remote->number, ==, "2");
+	g_assert_cmpstr(((RmCallEntry*)list->next->next->data)->remote->number, ==, "1");
+
+	rm_journal_free(list);
+}
+
+static void test_journal_timestamp(void)
+{
+	g_assert_cmpint(rm_call_entry_parse_date_time("01.01.00 00:00"), ==, G_GINT64_CONSTANT(946684800));
+	g_assert_cmpint(rm_call_entry_parse_date_time("02.01.1970 00:01"), ==, 86460);
+	g_assert_cmpint(rm_call_entry_parse_date_time("31.12.17"), ==, G_GINT64_CONSTANT(1514678400));
+	g_assert_cmpint(rm_call_entry_parse_date_time("31.02.17 10:00"), ==, 0);
+	g_assert_cmpint(rm_call_entry_parse_date_time(""), ==, 0);
+}
+
+static void test_journal_dup_shared(void)
+{
+	RmCallEntry *call = test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "01.02.17 10:00", "0301234");
+	RmCallEntry *copy = rm_call_entry_dup(call);
+
+	/* Duplicated entries share their contacts until one side is modified */
+	g_assert_true(copy->remote == call->remote);
+
+	copy->remote = rm_contact_make_writable(copy->remote);
+	g_assert_true(copy->remote != call->remote);
+	g_assert_cmpstr(copy->remote->number, ==, "0301234");
+
+	g_free(copy->remote->name);
+	copy->remote->name = g_strdup("Doe");
+	g_assert_cmpstr(call->remote->name, ==, "");
+
+	/* Exclusively owned contacts are not copied again */
+	g_assert_true(rm_contact_make_writable(copy->remote) == copy->remote);
+
+	rm_call_entry_free(copy);
+	rm_call_entry_free(call);
+}
+
+static gchar *test_journal_store_file(const gchar *name)
+{
+	return g_build_filename(rm_get_user_data_dir(), rm_profile_get_active()->name, name, NULL);
+}
+
+static void test_journal_store_clear(void)
+{
+	gchar *file_name = test_journal_store_file("journal.db");
+	gchar *csv_name = test_journal_store_file("journal.csv");
+
+	g_remove(file_name);
+	g_remove(csv_name);
+
+	g_free(csv_name);
+	g_free(file_name);
+}
+
+static GList *test_journal_store_load(GList *journal)
+{
+	GError *error = NULL;
+
+	journal = rm_journal_load(journal, &error);
+	g_assert_no_error(error);
+
+	return journal;
+}
+
+static void test_journal_store_append(void)
+{
+	gchar *file_name = test_journal_store_file("journal.db");
+	GList *journal;
+	gsize len;
+	gsize appended_len;
+	gchar *data;
+
+	test_journal_store_clear();
+
+	journal = test_journal_store_load(g_list_append(NULL, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "01.02.17 10:00", "0301234")));
+	g_assert_cmpuint(g_list_length(journal), ==, 1);
+	rm_journal_free(journal);
+
+	g_assert_true(g_file_get_contents(file_name, &data, &len, NULL));
+	g_assert_cmpmem(data, 8, "RMJRNL01", 8);
+	g_free(data);
+
+	/* Known calls are not appended again, new ones are */
+	journal = g_list_append(NULL, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "01.02.17 10:00", "0301234"));
+	journal = g_list_append(journal, test_journal_call(RM_CALL_ENTRY_TYPE_OUTGOING, "02.02.17 10:00", "0405678"));
+	journal = test_journal_store_load(journal);
+	g_assert_cmpuint(g_list_length(journal), ==, 2);
+	rm_journal_free(journal);
+
+	g_assert_true(g_file_get_contents(file_name, &data, &appended_len, NULL));
+	g_assert_cmpuint(appended_len, >, len);
+	g_free(data);
+
+	/* Reload without router calls */
+	journal = test_journal_store_load(NULL);
+	g_assert_cmpuint(g_list_length(journal), ==, 2);
+	g_assert_cmpstr(((RmCallEntry*)journal->data)->remote->number, ==, "0405678");
+	g_assert_cmpstr(((RmCallEntry*)journal->next->data)->remote->number, ==, "0301234");
+	rm_journal_free(journal);
+
+	g_assert_true(g_file_get_contents(file_name, &data, &len, NULL));
+	g_assert_cmpuint(len, ==, appended_len);
+	g_free(data);
+
+	g_free(file_name);
+}
+
+static void test_journal_store_merge(void)
+{
+	GList *journal;
+	RmCallEntry *call;
+
+	test_journal_store_clear();
+
+	journal = test_journal_store_load(g_list_append(NULL, test_journal_call(RM_CALL_ENTRY_TYPE_MISSED, "01.02.17 10:00", "0301234")));
+	rm_journal_free(journal);
+
+	/* Voice box message for a stored call */
+	call = test_journal_call(RM_CALL_ENTRY_TYPE_VOICE, "01.02.17 10:00", "0301234");
+	call->priv = g_strdup("rec.0.000");
+	journal = test_journal_store_load(g_list_append(NULL, call));
+	g_assert_cmpuint(g_list_length(journal), ==, 1);
+	rm_journal_free(journal);
+
+	/* Upgrade must survive a reload */
+	journal = test_journal_store_load(NULL);
+	g_assert_cmpuint(g_list_length(journal), ==, 1);
+	call = journal->data;
+	g_assert_cmpint(call->type, ==, RM_CALL_ENTRY_TYPE_VOICE);
+	g_assert_cmpstr(call->priv, ==, "rec.0.000");
+	rm_journal_free(journal);
+}
+
+static void test_journal_store_truncated(void)
+{
+	gchar *file_name = test_journal_store_file("journal.db");
+	GList *journal;
+	gchar *data;
+	gchar *truncated;
+	gsize len;
+	gsize truncated_len;
+
+	test_journal_store_clear();
+
+	journal = g_list_append(NULL, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "01.02.17 10:00", "0301234"));
+	journal = g_list_append(journal, test_journal_call(RM_CALL_ENTRY_TYPE_OUTGOING, "02.02.17 10:00", "0405678"));
+	journal = test_journal_store_load(journal);
+	rm_journal_free(journal);
+
+	g_assert_true(g_file_get_contents(file_name, &data, &len, NULL));
+
+	/* Simulate an interrupted append: a new record with its tail missing */
+	journal = test_journal_store_load(g_list_append(NULL, test_journal_call(RM_CALL_ENTRY_TYPE_MISSED, "03.02.17 10:00", "0609999")));
+	rm_journal_free(journal);
+
+	g_assert_true(g_file_get_contents(file_name, &truncated, &truncated_len, NULL));
+	g_assert_cmpuint(truncated_len, >, len);
+	g_assert_true(g_file_set_contents(file_name, truncated, len + (truncated_len - len) / 2, NULL));
+	g_free(truncated);
+
+	/* Complete records are kept, broken tail is dropped and the store is rewritten */
+	journal = test_journal_store_load(NULL);
+	g_assert_cmpuint(g_list_length(journal), ==, 2);
+	rm_journal_free(journal);
+
+	g_free(data);
+	g_assert_true(g_file_get_contents(file_name, &data, &truncated_len, NULL));
+	g_assert_cmpuint(truncated_len, ==, len);
+	g_free(data);
+
+	/* Store is appendable again */
+	journal = test_journal_store_load(g_list_append(NULL, test_journal_call(RM_CALL_ENTRY_TYPE_MISSED, "03.02.17 10:00", "0609999")));
+	rm_journal_free(journal);
+
+	journal = test_journal_store_load(NULL);
+	g_assert_cmpuint(g_list_length(journal), ==, 3);
+	rm_journal_free(journal);
+
+	g_free(file_name);
+}
+
+static void test_journal_store_unknown(void)
+{
+	gchar *file_name = test_journal_store_file("journal.db");
+	gchar *bad_name = test_journal_store_file("journal.db.bad");
+	gchar *csv_name = test_journal_store_file("journal.csv");
+	const gchar *newer = "RMJRNL99 history of a newer version";
+	GError *error = NULL;
+	GList *journal;
+	gchar *data;
+	gsize len;
+
+	test_journal_store_clear();
+	g_remove(bad_name);
+
+	journal = g_list_append(NULL, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "01.02.17 10:00", "0301234"));
+	g_assert_true(rm_journal_save_as(journal, csv_name));
+	rm_journal_free(journal);
+
+	g_assert_true(g_file_set_contents(file_name, newer, -1, NULL));
+
+	/* Store is neither migrated from journal.csv nor overwritten, but moved aside */
+	g_test_expect_message("rm", G_LOG_LEVEL_WARNING, "*Could not read journal store*");
+	journal = rm_journal_load(g_list_append(NULL, test_journal_call(RM_CALL_ENTRY_TYPE_OUTGOING, "02.02.17 10:00", "0405678")), &error);
+	g_test_assert_expected_messages();
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_cmpuint(g_list_length(journal), ==, 1);
+	rm_journal_free(journal);
+	g_clear_error(&error);
+
+	g_assert_false(g_file_test(file_name, G_FILE_TEST_EXISTS));
+	g_assert_true(g_file_get_contents(bad_name, &data, &len, NULL));
+	g_assert_cmpstr(data, ==, newer);
+	g_free(data);
+
+	g_remove(bad_name);
+	g_free(csv_name);
+	g_free(bad_name);
+	g_free(file_name);
+}
+
+static void test_journal_store_migrate(void)
+{
+	gchar *file_name = test_journal_store_file("journal.db");
+	gchar *csv_name = test_journal_store_file("journal.csv");
+	GList *journal = NULL;
+
+	test_journal_store_clear();
+
+	journal = g_list_append(journal, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, "01.02.17 10:00", "0301234"));
+	journal = g_list_append(journal, test_journal_call(RM_CALL_ENTRY_TYPE_MISSED, "02.02.17 10:00", "0405678"));
+	g_assert_true(rm_journal_save_as(journal, csv_name));
+	rm_journal_free(journal);
+
+	/* Old journal.csv is converted and merged with the router calls */
+	journal = test_journal_store_load(g_list_append(NULL, test_journal_call(RM_CALL_ENTRY_TYPE_OUTGOING, "03.02.17 10:00", "0609999")));
+	g_assert_cmpuint(g_list_length(journal), ==, 3);
+	rm_journal_free(journal);
+
+	g_assert_true(g_file_test(file_name, G_FILE_TEST_EXISTS));
+
+	/* Store is used from now on, even without journal.csv */
+	g_remove(csv_name);
+
+	journal = test_journal_store_load(NULL);
+	g_assert_cmpuint(g_list_length(journal), ==, 3);
+	g_assert_cmpint(((RmCallEntry*)g_list_last(journal)->data)->type, ==, RM_CALL_ENTRY_TYPE_INCOMING);
+	rm_journal_free(journal);
+
+	g_free(csv_name);
+	g_free(file_name);
+}
+
+static void test_journal_merge_perf(void)
+{
+	RmJournal *journal = rm_journal_new();
+	gint index;
+
+	g_test_timer_start();
+
+	/* Merge history twice, second run must detect every entry as duplicate */
+	for (index = 0; index < 100000; index++) {
+		gint id = index % 50000;
+		gchar *date_time = g_strdup_printf("%2.2d.%2.2d.%2.2d %2.2d:%2.2d", id % 28 + 1, id % 12 + 1, id % 20, id % 24, id % 60);
+		gchar *number = g_strdup_printf("0%d", id);
+
+		rm_journal_add(journal, test_journal_call(RM_CALL_ENTRY_TYPE_INCOMING, date_time, number));
+
+		g_free(number);
+		g_free(date_time);
+	}
+	rm_journal_get_entry(journal, 0);
+
+	g_test_minimized_result(g_test_timer_elapsed(), "merged 100000 calls in %f seconds", g_test_timer_last());
+	g_assert_cmpuint(rm_journal_get_length(journal), ==, 50000);
+
+	rm_journal_destroy(journal);
+}
+
+int main(int argc, char **argv)
+{
+	gchar *dir;
+	gint ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	/* Keep journal store of tests away from user data */
+	dir = g_dir_make_tmp("rm-journal-XXXXXX", NULL);
+	g_setenv("XDG_DATA_HOME", dir, TRUE);
+	g_setenv("XDG_CONFIG_HOME", dir, TRUE);
+	g_setenv("XDG_CACHE_HOME", dir, TRUE);
+	g_setenv("GSETTINGS_BACKEND", "memory", TRUE);
+
+	rm_new(FALSE, NULL);
+	rm_profile_set_active(rm_profile_add("Test"));
+
+	g_test_add_func("/journal/duplicates", test_journal_duplicates);
+	g_test_add_func("/journal/merge-voice", test_journal_merge_voice);
+	g_test_add_func("/journal/sorted", test_journal_sorted);
+	g_test_add_func("/journal/timestamp", test_journal_timestamp);
+	g_test_add_func("/journal/dup-shared", test_journal_dup_shared);
+	g_test_add_func("/journal/store-append", test_journal_store_append);
+	g_test_add_func("/journal/store-merge", test_journal_store_merge);
+	g_test_add_func("/journal/store-truncated", test_journal_store_truncated);
+	g_test_add_func("/journal/store-unknown", test_journal_store_unknown);
+	g_test_add_func("/journal/store-migrate", test_journal_store_migrate);
+
+	if (g_test_perf()) {
+		g_test_add_func("/journal/merge-perf", test_journal_merge_perf);
+	}
+
+	ret = g_test_run();
+
+	test_journal_store_clear();
+	g_free(dir);
+
+	return ret;
+}
@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <rm/rm.h>
+
+typedef struct {
+	gboolean done;
+	gboolean found;
+	gchar *name;
+	GError *error;
+} TestLookupResult;
+
+/* Asynchronous provider: requests stay pending until test_lookup_async_complete() */
+static GList *test_lookup_pending = NULL;
+static guint test_lookup_async_calls = 0;
+
+/* Synchronous provider: blocks its worker thread until the gate is opened */
+static GMutex test_lookup_sync_lock;
+static GCond test_lookup_sync_cond;
+static gboolean test_lookup_sync_open = FALSE;
+static const gchar *test_lookup_sync_name = NULL;
+
+static void test_lookup_async_search_async(gchar *number, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+	test_lookup_async_calls++;
+	test_lookup_pending = g_list_append(test_lookup_pending, g_task_new(NULL, cancellable, callback, user_data));
+}
+
+static gboolean test_lookup_async_search_finish(GAsyncResult *result, RmContact *contact, GError **error)
+{
+	gchar *name = g_task_propagate_pointer(G_TASK(result), error);
+
+	if (!name) {
+		return FALSE;
+	}
+
+	contact->name = name;
+
+	return TRUE;
+}
+
+static gboolean test_lookup_sync_search(gchar *number, RmContact *contact)
+{
+	g_mutex_lock(&test_lookup_sync_lock);
+	while (!test_lookup_sync_open) {
+		g_cond_wait(&test_lookup_sync_cond, &test_lookup_sync_lock);
+	}
+	g_mutex_unlock(&test_lookup_sync_lock);
+
+	if (!test_lookup_sync_name) {
+		return FALSE;
+	}
+
+	contact->name = g_strdup(test_lookup_sync_name);
+
+	return TRUE;
+}
+
+static RmLookup test_lookup_async = {
+	"Test Async",
+	NULL,
+	test_lookup_async_search_async,
+	test_lookup_async_search_finish
+};
+
+static RmLookup test_lookup_sync = {
+	"Test Sync",
+	test_lookup_sync_search,
+	NULL,
+	NULL
+};
+
+static void test_lookup_flush(void)
+{
+	while (g_main_context_pending(NULL)) {
+		g_main_context_iteration(NULL, FALSE);
+	}
+}
+
+static void test_lookup_async_complete(const gchar *name)
+{
+	GTask *task = test_lookup_pending->data;
+
+	test_lookup_pending = g_list_delete_link(test_lookup_pending, test_lookup_pending);
+
+	g_task_return_pointer(task, g_strdup(name), g_free);
+	g_object_unref(task);
+
+	test_lookup_flush();
+}
+
+static void test_lookup_sync_release(const gchar *name)
+{
+	g_mutex_lock(&test_lookup_sync_lock);
+	test_lookup_sync_name = name;
+	test_lookup_sync_open = TRUE;
+	g_cond_broadcast(&test_lookup_sync_cond);
+	g_mutex_unlock(&test_lookup_sync_lock);
+}
+
+static void test_lookup_result_cb(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	TestLookupResult *result = user_data;
+	RmContact *contact = rm_contact_new();
+
+	result->found = rm_lookup_search_finish(res, contact, &result->error);
+	result->name = g_strdup(contact->name);
+	result->done = TRUE;
+
+	rm_contact_free(contact);
+}
+
+static void test_lookup_wait(TestLookupResult *result)
+{
+	while (!result->done) {
+		g_main_context_iteration(NULL, TRUE);
+	}
+}
+
+static void test_lookup_result_clear(TestLookupResult *result)
+{
+	g_free(result->name);
+	g_clear_error(&result->error);
+}
+
+static void test_lookup_init(void)
+{
+	test_lookup_async_calls = 0;
+	test_lookup_sync_open = FALSE;
+	test_lookup_sync_name = NULL;
+}
+
+static void test_lookup_coalesce(void)
+{
+	TestLookupResult first = { 0 };
+	TestLookupResult second = { 0 };
+	guint coalesced = rm_lookup_get_coalesced();
+
+	test_lookup_init();
+	rm_lookup_register(&test_lookup_async);
+
+	rm_lookup_search_async("0301234567", NULL, test_lookup_result_cb, &first);
+	rm_lookup_search_async("0301234567", NULL, test_lookup_result_cb, &second);
+
+	g_assert_cmpuint(test_lookup_async_calls, ==, 1);
+	g_assert_cmpuint(rm_lookup_get_coalesced(), ==, coalesced + 1);
+
+	test_lookup_async_complete("Alice");
+	test_lookup_wait(&first);
+	test_lookup_wait(&second);
+
+	g_assert_true(first.found);
+	g_assert_cmpstr(first.name, ==, "Alice");
+	g_assert_true(second.found);
+	g_assert_cmpstr(second.name, ==, "Alice");
+
+	/* Finished lookups are not joined anymore */
+	test_lookup_result_clear(&first);
+	memset(&first, 0, sizeof(first));
+	rm_lookup_search_async("0301234567", NULL, test_lookup_result_cb, &first);
+	g_assert_cmpuint(test_lookup_async_calls, ==, 2);
+
+	test_lookup_async_complete(NULL);
+	test_lookup_wait(&first);
+	g_assert_false(first.found);
+	g_assert_no_error(first.error);
+
+	test_lookup_result_clear(&first);
+	test_lookup_result_clear(&second);
+
+	rm_lookup_unregister(&test_lookup_async);
+}
+
+static void test_lookup_priority(void)
+{
+	const gchar *first_names[] = { "Sync", NULL };
+	const gchar *expected[] = { "Sync", "Async" };
+	gint run;
+
+	for (run = 0; run < 2; run++) {
+		TestLookupResult result = { 0 };
+
+		test_lookup_init();
+		/* Later registered providers take precedence */
+		rm_lookup_register(&test_lookup_async);
+		rm_lookup_register(&test_lookup_sync);
+
+		rm_lookup_search_async("0307654321", NULL, test_lookup_result_cb, &result);
+
+		/* Second provider answers first, but has to wait for the first one */
+		test_lookup_async_complete("Async");
+		g_assert_false(result.done);
+
+		test_lookup_sync_release(first_names[run]);
+		test_lookup_wait(&result);
+
+		g_assert_true(result.found);
+		g_assert_cmpstr(result.name, ==, expected[run]);
+
+		test_lookup_result_clear(&result);
+
+		rm_lookup_unregister(&test_lookup_async);
+		rm_lookup_unregister(&test_lookup_sync);
+	}
+}
+
+static void test_lookup_cancel(void)
+{
+	TestLookupResult first = { 0 };
+	TestLookupResult second = { 0 };
+	GCancellable *cancellable = g_cancellable_new();
+	GTask *provider;
+
+	test_lookup_init();
+	rm_lookup_register(&test_lookup_async);
+
+	/* Cancelled waiter returns right away, the other one still gets the result */
+	rm_lookup_search_async("0301112222", cancellable, test_lookup_result_cb, &first);
+	rm_lookup_search_async("0301112222", NULL, test_lookup_result_cb, &second);
+	provider = test_lookup_pending->data;
+
+	g_cancellable_cancel(cancellable);
+	test_lookup_wait(&first);
+	g_assert_error(first.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert_false(second.done);
+
+	test_lookup_flush();
+	g_assert_false(g_cancellable_is_cancelled(g_task_get_cancellable(provider)));
+
+	test_lookup_async_complete("Bob");
+	test_lookup_wait(&second);
+	g_assert_cmpstr(second.name, ==, "Bob");
+
+	test_lookup_result_clear(&first);
+	test_lookup_result_clear(&second);
+	memset(&first, 0, sizeof(first));
+	g_object_unref(cancellable);
+
+	/* Last cancelled waiter stops providers without waiting for them */
+	cancellable = g_cancellable_new();
+	rm_lookup_search_async("0301112222", cancellable, test_lookup_result_cb, &first);
+	provider = test_lookup_pending->data;
+
+	g_cancellable_cancel(cancellable);
+	test_lookup_wait(&first);
+	g_assert_error(first.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+
+	test_lookup_flush();
+	g_assert_true(g_cancellable_is_cancelled(g_task_get_cancellable(provider)));
+
+	test_lookup_async_complete(NULL);
+	test_lookup_result_clear(&first);
+	memset(&first, 0, sizeof(first));
+
+	/* Already cancelled lookups do not reach the providers */
+	rm_lookup_search_async("0301112222", cancellable, test_lookup_result_cb, &first);
+	test_lookup_wait(&first);
+	g_assert_error(first.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert_cmpuint(test_lookup_async_calls, ==, 2);
+
+	test_lookup_result_clear(&first);
+	g_object_unref(cancellable);
+
+	rm_lookup_unregister(&test_lookup_async);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/lookup/coalesce", test_lookup_coalesce);
+	g_test_add_func("/lookup/priority", test_lookup_priority);
+	g_test_add_func("/lookup/cancel", test_lookup_cancel);
+
+	return g_test_run();
+}
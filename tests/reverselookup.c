@@ -0,0 +1,410 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libxml/HTMLparser.h>
+
+#include "../plugins/reverselookup/extract.c"
+#include "../plugins/reverselookup/cache.c"
+
+static gchar *test_name[] = { "span", "class", "name", NULL };
+static gchar *test_street[] = { "div", "itemprop", "street", NULL };
+static gchar *test_city[] = { "div", "itemprop", "city", NULL };
+static gchar *test_zip[] = { "div", "itemprop", "zip", NULL };
+
+static gchar *test_reverselookup_page(gint filler)
+{
+	GString *page = g_string_new("<html><head><title>Result</title></head><body>");
+	gint idx;
+
+	/* Typical result pages carry a lot of markup before the hit */
+	for (idx = 0; idx < filler; idx++) {
+		g_string_append_printf(page, "<div class=\"ad\"><a href=\"/x/%d\">Link %d</a><span class=\"teaser\">Some text</span></div>\n", idx, idx);
+	}
+
+	g_string_append(page, "<div class=\"hit\"><span class=\"name\">  John   <b>Jr</b> Doe &amp; Sons  </span>"
+			       "<div itemprop=\"street\">Main Street 1</div>"
+			       "<div itemprop=\"zip\">12345</div>"
+			       "<div itemprop=\"city\">Berlin</div></div>");
+
+	for (idx = 0; idx < filler; idx++) {
+		g_string_append(page, "<p>Footer text</p>\n");
+	}
+
+	g_string_append(page, "</body></html>");
+
+	return g_string_free(page, FALSE);
+}
+
+static void test_reverselookup_extract(void)
+{
+	gchar **patterns[REVERSELOOKUP_FIELD_MAX] = { test_name, test_street, test_city, test_zip };
+	gchar *fields[REVERSELOOKUP_FIELD_MAX] = { NULL };
+	gchar *page = test_reverselookup_page(10);
+	gint idx;
+
+	g_assert_true(reverselookup_extract(patterns, page, strlen(page), fields));
+
+	/* Only direct text children, spaces collapsed */
+	g_assert_cmpstr(fields[REVERSELOOKUP_FIELD_NAME], ==, "John Doe & Sons");
+	g_assert_cmpstr(fields[REVERSELOOKUP_FIELD_STREET], ==, "Main Street 1");
+	g_assert_cmpstr(fields[REVERSELOOKUP_FIELD_CITY], ==, "Berlin");
+	g_assert_cmpstr(fields[REVERSELOOKUP_FIELD_ZIP], ==, "12345");
+
+	for (idx = 0; idx < REVERSELOOKUP_FIELD_MAX; idx++) {
+		g_free(fields[idx]);
+	}
+	g_free(page);
+}
+
+static void test_reverselookup_missing(void)
+{
+	gchar *unknown[] = { "div", "itemprop", "phone", NULL };
+	gchar **patterns[REVERSELOOKUP_FIELD_MAX] = { test_name, unknown, NULL, NULL };
+	gchar *fields[REVERSELOOKUP_FIELD_MAX] = { NULL };
+	gchar *page = test_reverselookup_page(1);
+
+	g_assert_false(reverselookup_extract(patterns, page, strlen(page), fields));
+	g_assert_nonnull(fields[REVERSELOOKUP_FIELD_NAME]);
+	g_assert_null(fields[REVERSELOOKUP_FIELD_STREET]);
+
+	g_free(fields[REVERSELOOKUP_FIELD_NAME]);
+	g_free(page);
+}
+
+static void test_reverselookup_bench_data(const gchar *name, const gchar *data, gsize len)
+{
+	gchar **patterns[REVERSELOOKUP_FIELD_MAX] = { test_name, test_street, test_city, test_zip };
+	gdouble elapsed;
+	gint runs = 200;
+	gint run;
+
+	g_test_timer_start();
+
+	for (run = 0; run < runs; run++) {
+		gchar *fields[REVERSELOOKUP_FIELD_MAX] = { NULL };
+		gint idx;
+
+		reverselookup_extract(patterns, data, len, fields);
+
+		for (idx = 0; idx < REVERSELOOKUP_FIELD_MAX; idx++) {
+			g_free(fields[idx]);
+		}
+	}
+
+	elapsed = g_test_timer_elapsed();
+	g_test_minimized_result(elapsed / runs, "%s: %" G_GSIZE_FORMAT " bytes in %f ms", name, len, elapsed * 1000 / runs);
+}
+
+static void test_reverselookup_bench(void)
+{
+	const gchar *dir_name = g_getenv("RM_TEST_LOOKUP_PAGES");
+	gchar *page = test_reverselookup_page(2000);
+
+	test_reverselookup_bench_data("synthetic", page, strlen(page));
+	g_free(page);
+
+	/* Optionally benchmark saved result pages (see RL_DEBUG in reverselookup.c) */
+	if (dir_name) {
+		GDir *dir = g_dir_open(dir_name, 0, NULL);
+		const gchar *file_name;
+
+		while (dir && (file_name = g_dir_read_name(dir))) {
+			gchar *file = g_build_filename(dir_name, file_name, NULL);
+			gchar *data;
+			gsize len;
+
+			if (g_file_get_contents(file, &data, &len, NULL)) {
+				test_reverselookup_bench_data(file_name, data, len);
+				g_free(data);
+			}
+
+			g_free(file);
+		}
+
+		if (dir) {
+			g_dir_close(dir);
+		}
+	}
+}
+
+static RmContact *test_cache_contact(const gchar *name)
+{
+	RmContact *contact = rm_contact_new();
+
+	contact->name = g_strdup(name);
+	contact->street = g_strdup("Main Street 1");
+	contact->zip = g_strdup("12345");
+	contact->city = g_strdup("Berlin");
+
+	return contact;
+}
+
+static void test_cache_insert(RmLookupCache *cache, const gchar *number, const gchar *name)
+{
+	RmContact *contact = test_cache_contact(name);
+
+	reverselookup_cache_insert(cache, number, contact);
+	rm_contact_free(contact);
+}
+
+static void test_cache_assert(RmLookupCache *cache, const gchar *number, const gchar *name)
+{
+	RmContact *contact = reverselookup_cache_lookup(cache, number);
+
+	if (!name) {
+		g_assert_null(contact);
+		return;
+	}
+
+	g_assert_nonnull(contact);
+	g_assert_cmpstr(contact->name, ==, name);
+	g_assert_cmpstr(contact->city, ==, "Berlin");
+	rm_contact_free(contact);
+}
+
+static gsize test_cache_header(const gchar *file_name, RmLookupCacheHeader *header)
+{
+	gchar *data;
+	gsize len;
+
+	g_assert_true(g_file_get_contents(file_name, &data, &len, NULL));
+	g_assert_cmpuint(len, >=, sizeof(*header));
+	memcpy(header, data, sizeof(*header));
+	g_free(data);
+
+	return len;
+}
+
+static gsize test_cache_record_len(const gchar *number, const gchar *name)
+{
+	return sizeof(gint64) + strlen(number) + strlen(name) + strlen("Main Street 1") + strlen("12345") + strlen("Berlin") + REVERSELOOKUP_CACHE_FIELDS;
+}
+
+static void test_cache_format(void)
+{
+	gchar *dir = g_dir_make_tmp("rm-cache-XXXXXX", NULL);
+	gchar *file_name = g_build_filename(dir, "reverselookup.cache", NULL);
+	RmLookupCache *cache = reverselookup_cache_open(file_name);
+	RmLookupCacheHeader header;
+	gsize index_len = sizeof(header) + REVERSELOOKUP_CACHE_MIN_BUCKETS * sizeof(RmLookupCacheSlot);
+	gsize len;
+
+	/* Created on first insert */
+	test_cache_assert(cache, "0301234", NULL);
+	g_assert_false(g_file_test(file_name, G_FILE_TEST_EXISTS));
+
+	test_cache_insert(cache, "0301234", "Doe");
+	len = test_cache_header(file_name, &header);
+	g_assert_cmpmem(header.magic, sizeof(header.magic), REVERSELOOKUP_CACHE_MAGIC, sizeof(header.magic));
+	g_assert_cmpuint(header.version, ==, REVERSELOOKUP_CACHE_VERSION);
+	g_assert_cmpuint(header.buckets, ==, REVERSELOOKUP_CACHE_MIN_BUCKETS);
+	g_assert_cmpuint(header.entries, ==, 1);
+	g_assert_cmpuint(header.stale, ==, 0);
+	g_assert_cmpuint(len, ==, index_len + test_cache_record_len("0301234", "Doe"));
+
+	/* Further inserts append to the heap */
+	test_cache_insert(cache, "0405678", "Smith");
+	g_assert_cmpuint(test_cache_header(file_name, &header), ==, len + test_cache_record_len("0405678", "Smith"));
+	g_assert_cmpuint(header.entries, ==, 2);
+
+	/* Replacing a number leaves a stale record */
+	test_cache_insert(cache, "0301234", "Miller");
+	test_cache_header(file_name, &header);
+	g_assert_cmpuint(header.entries, ==, 2);
+	g_assert_cmpuint(header.stale, ==, 1);
+
+	reverselookup_cache_free(cache);
+
+	/* Reopened cache sees all updates */
+	cache = reverselookup_cache_open(file_name);
+	test_cache_assert(cache, "0301234", "Miller");
+	test_cache_assert(cache, "0405678", "Smith");
+	reverselookup_cache_free(cache);
+
+	g_remove(file_name);
+	g_rmdir(dir);
+	g_free(file_name);
+	g_free(dir);
+}
+
+static void test_cache_probe(void)
+{
+	gchar *dir = g_dir_make_tmp("rm-cache-XXXXXX", NULL);
+	gchar *file_name = g_build_filename(dir, "reverselookup.cache", NULL);
+	RmLookupCache *cache = reverselookup_cache_open(file_name);
+	RmLookupCacheHeader header;
+	GPtrArray *numbers = g_ptr_array_new_with_free_func(g_free);
+	guint32 bucket = 0;
+	gint idx;
+
+	/* Numbers sharing one bucket, so lookups have to probe */
+	for (idx = 0; numbers->len < REVERSELOOKUP_CACHE_MIN_BUCKETS / 2; idx++) {
+		gchar *number = g_strdup_printf("030%d", idx);
+		guint32 hash = reverselookup_cache_hash(number) & (REVERSELOOKUP_CACHE_MIN_BUCKETS - 1);
+
+		if (!numbers->len) {
+			bucket = hash;
+		}
+
+		if (hash == bucket) {
+			g_ptr_array_add(numbers, number);
+		} else {
+			g_free(number);
+		}
+	}
+
+	for (idx = 0; idx < numbers->len; idx++) {
+		test_cache_insert(cache, g_ptr_array_index(numbers, idx), g_ptr_array_index(numbers, idx));
+	}
+
+	test_cache_header(file_name, &header);
+	g_assert_cmpuint(header.buckets, ==, REVERSELOOKUP_CACHE_MIN_BUCKETS);
+	g_assert_cmpuint(header.entries, ==, numbers->len);
+
+	for (idx = 0; idx < numbers->len; idx++) {
+		test_cache_assert(cache, g_ptr_array_index(numbers, idx), g_ptr_array_index(numbers, idx));
+	}
+	test_cache_assert(cache, "0401111", NULL);
+
+	/* Exceeding the load factor compacts and grows the index */
+	test_cache_insert(cache, "0401111", "Doe");
+	test_cache_header(file_name, &header);
+	g_assert_cmpuint(header.buckets, ==, REVERSELOOKUP_CACHE_MIN_BUCKETS * 2);
+	g_assert_cmpuint(header.entries, ==, numbers->len + 1);
+
+	for (idx = 0; idx < numbers->len; idx++) {
+		test_cache_assert(cache, g_ptr_array_index(numbers, idx), g_ptr_array_index(numbers, idx));
+	}
+	test_cache_assert(cache, "0401111", "Doe");
+
+	/* Too many stale records compact the file */
+	for (idx = 0; idx < REVERSELOOKUP_CACHE_COMPACT_MIN; idx++) {
+		test_cache_insert(cache, "0401111", idx % 2 ? "Doe" : "Smith");
+	}
+	test_cache_header(file_name, &header);
+	g_assert_cmpuint(header.stale, <, REVERSELOOKUP_CACHE_COMPACT_MIN);
+	g_assert_cmpuint(header.entries, ==, numbers->len + 1);
+	test_cache_assert(cache, "0401111", "Doe");
+
+	reverselookup_cache_free(cache);
+	g_ptr_array_free(numbers, TRUE);
+
+	g_remove(file_name);
+	g_rmdir(dir);
+	g_free(file_name);
+	g_free(dir);
+}
+
+static void test_cache_expiry(void)
+{
+	gchar *dir = g_dir_make_tmp("rm-cache-XXXXXX", NULL);
+	gchar *file_name = g_build_filename(dir, "reverselookup.cache", NULL);
+	RmLookupCache *cache = reverselookup_cache_open(file_name);
+	RmLookupCacheHeader header;
+	RmLookupCacheRecord record;
+	RmLookupCacheSlot slot;
+	GHashTable *updates;
+	gint64 timestamp = g_get_real_time() / G_USEC_PER_SEC - REVERSELOOKUP_CACHE_TTL - 1;
+	guint32 bucket;
+	gchar *data;
+	gsize len;
+
+	test_cache_insert(cache, "0301234", "Doe");
+	test_cache_insert(cache, "0405678", "Smith");
+
+	/* Age first record beyond TTL */
+	g_assert_true(reverselookup_cache_probe(cache, "0301234", &bucket, &record));
+	reverselookup_cache_get_slot(cache, bucket, &slot);
+	reverselookup_cache_free(cache);
+
+	g_assert_true(g_file_get_contents(file_name, &data, &len, NULL));
+	memcpy(data + slot.offset, &timestamp, sizeof(timestamp));
+	g_assert_true(g_file_set_contents(file_name, data, len, NULL));
+	g_free(data);
+
+	cache = reverselookup_cache_open(file_name);
+	test_cache_assert(cache, "0301234", NULL);
+	test_cache_assert(cache, "0405678", "Smith");
+
+	/* Compaction drops expired records */
+	updates = g_hash_table_new(g_str_hash, g_str_equal);
+	g_mutex_lock(&cache->lock);
+	g_assert_true(reverselookup_cache_write(cache, updates));
+	g_mutex_unlock(&cache->lock);
+	g_hash_table_destroy(updates);
+
+	test_cache_header(file_name, &header);
+	g_assert_cmpuint(header.entries, ==, 1);
+	test_cache_assert(cache, "0405678", "Smith");
+
+	reverselookup_cache_free(cache);
+
+	g_remove(file_name);
+	g_rmdir(dir);
+	g_free(file_name);
+	g_free(dir);
+}
+
+static void test_cache_import(void)
+{
+	gchar *dir = g_dir_make_tmp("rm-cache-XXXXXX", NULL);
+	gchar *file_name = g_build_filename(dir, "reverselookup.cache", NULL);
+	gchar *old_dir = g_build_filename(dir, "reverselookup", NULL);
+	gchar *old_file;
+	RmLookupCache *cache;
+
+	g_mkdir(old_dir, 0700);
+
+	old_file = g_build_filename(old_dir, "0301234", NULL);
+	g_assert_true(g_file_set_contents(old_file, "0301234;Doe;Main Street 1;12345;Berlin\n", -1, NULL));
+	g_free(old_file);
+
+	old_file = g_build_filename(old_dir, "0405678", NULL);
+	g_assert_true(g_file_set_contents(old_file, "0405678;Smith;Main Street 1;12345;Berlin\n", -1, NULL));
+	g_free(old_file);
+
+	/* Broken entries are skipped */
+	old_file = g_build_filename(old_dir, "0509999", NULL);
+	g_assert_true(g_file_set_contents(old_file, "0509999;Broken", -1, NULL));
+	g_free(old_file);
+
+	cache = reverselookup_cache_open(file_name);
+	reverselookup_cache_import(cache, old_dir);
+
+	test_cache_assert(cache, "0301234", "Doe");
+	test_cache_assert(cache, "0405678", "Smith");
+	test_cache_assert(cache, "0509999", NULL);
+
+	/* Old cache is removed once imported */
+	g_assert_false(g_file_test(old_dir, G_FILE_TEST_EXISTS));
+
+	reverselookup_cache_free(cache);
+
+	g_remove(file_name);
+	g_rmdir(dir);
+	g_free(old_dir);
+	g_free(file_name);
+	g_free(dir);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/reverselookup/extract", test_reverselookup_extract);
+	g_test_add_func("/reverselookup/missing", test_reverselookup_missing);
+	g_test_add_func("/reverselookup/cache-format", test_cache_format);
+	g_test_add_func("/reverselookup/cache-probe", test_cache_probe);
+	g_test_add_func("/reverselookup/cache-expiry", test_cache_expiry);
+	g_test_add_func("/reverselookup/cache-import", test_cache_import);
+
+	if (g_test_perf()) {
+		g_test_add_func("/reverselookup/bench", test_reverselookup_bench);
+	}
+
+	return g_test_run();
+}
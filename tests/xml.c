@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <rm/rm.h>
+
+static gchar *test_xml_phonebook(gint count)
+{
+	GString *xml = g_string_new("<?xml version=\"1.0\" encoding=\"utf-8\"?><phonebooks><phonebook name=\"Test\">");
+	gint idx;
+
+	for (idx = 0; idx < count; idx++) {
+		g_string_append_printf(xml, "<contact><category>0</category><person><realName>Name %d</realName></person>"
+				       "<telephony nid=\"2\"><number type=\"home\" prio=\"1\" id=\"0\">030%d</number>"
+				       "<number type=\"mobile\" prio=\"0\" id=\"1\">0170%d</number></telephony>"
+				       "<services /><setup /><uniqueid>%d</uniqueid></contact>", idx, idx, idx, idx);
+	}
+
+	g_string_append(xml, "</phonebook></phonebooks>");
+
+	return g_string_free(xml, FALSE);
+}
+
+static void test_xml_arena(void)
+{
+	gchar *xml = test_xml_phonebook(10);
+	RmXmlNode *node = rm_xmlnode_from_str_full(xml, -1, RM_XMLNODE_PARSE_ARENA);
+	RmXmlNode *contact;
+	RmXmlNode *number;
+	RmXmlNode *copy;
+	gchar *data;
+	gint count = 0;
+
+	g_assert_nonnull(node);
+
+	for (contact = rm_xmlnode_get_child(node, "phonebook/contact"); contact; contact = rm_xmlnode_get_next_twin(contact)) {
+		count++;
+	}
+	g_assert_cmpint(count, ==, 10);
+
+	contact = rm_xmlnode_get_child(node, "phonebook/contact");
+	number = rm_xmlnode_get_child(contact, "telephony/number");
+	g_assert_cmpstr(rm_xmlnode_get_attrib(number, "type"), ==, "home");
+
+	data = rm_xmlnode_get_data(number);
+	g_assert_cmpstr(data, ==, "0300");
+	g_free(data);
+
+	/* Modifying arena trees mixes in heap nodes */
+	rm_xmlnode_set_attrib(number, "type", "work");
+	g_assert_cmpstr(rm_xmlnode_get_attrib(number, "type"), ==, "work");
+	rm_xmlnode_insert_data(rm_xmlnode_new_child(contact, "mod_time"), "1", -1);
+
+	/* Copies are independent of the arena */
+	copy = rm_xmlnode_copy(contact);
+	rm_xmlnode_free(rm_xmlnode_get_child(contact, "telephony"));
+	g_assert_null(rm_xmlnode_get_child(contact, "telephony"));
+
+	rm_xmlnode_free(node);
+
+	number = rm_xmlnode_get_child(copy, "telephony/number");
+	g_assert_cmpstr(rm_xmlnode_get_attrib(number, "type"), ==, "work");
+	rm_xmlnode_free(copy);
+
+	/* An arena document inserted into another tree is released with that tree */
+	node = rm_xmlnode_new("envelope");
+	rm_xmlnode_insert_child(node, rm_xmlnode_from_str_full(xml, -1, RM_XMLNODE_PARSE_ARENA));
+	g_assert_nonnull(rm_xmlnode_get_child(node, "phonebooks/phonebook/contact"));
+	rm_xmlnode_free(node);
+
+	g_assert_null(rm_xmlnode_from_str_full("<a><b></a>", -1, RM_XMLNODE_PARSE_ARENA));
+
+	g_free(xml);
+}
+
+static void test_xml_index(void)
+{
+	const gchar *xml = "<Call><Id>1</Id><Type>1</Type><Caller>0301234</Caller><Called>0405678</Called><Name>Doe</Name>"
+			   "<Numbertype>sip</Numbertype><Device>Phone</Device><Port>10</Port><Date>01.02.17 10:00</Date>"
+			   "<Duration>0:01</Duration><Id>2</Id></Call>";
+	RmXmlNodeParseFlags modes[] = { RM_XMLNODE_PARSE_INDEX, RM_XMLNODE_PARSE_ARENA | RM_XMLNODE_PARSE_INDEX };
+	guint idx;
+
+	for (idx = 0; idx < G_N_ELEMENTS(modes); idx++) {
+		RmXmlNode *node = rm_xmlnode_from_str_full(xml, -1, modes[idx]);
+		RmXmlNode *child;
+		gchar *data;
+
+		g_assert_nonnull(node);
+		g_assert_nonnull(node->index);
+
+		child = rm_xmlnode_get_child(node, "Duration");
+		data = rm_xmlnode_get_data(child);
+		g_assert_cmpstr(data, ==, "0:01");
+		g_free(data);
+
+		g_assert_null(rm_xmlnode_get_child(node, "NeverUsedElementName"));
+
+		/* Index follows removal and insertion of children */
+		child = rm_xmlnode_get_child(node, "Id");
+		g_assert_nonnull(rm_xmlnode_get_next_twin(child));
+		rm_xmlnode_free(child);
+
+		data = rm_xmlnode_get_data(rm_xmlnode_get_child(node, "Id"));
+		g_assert_cmpstr(data, ==, "2");
+		g_free(data);
+
+		g_assert_null(rm_xmlnode_get_child(node, "Path"));
+		rm_xmlnode_insert_data(rm_xmlnode_new_child(node, "Path"), "/p", -1);
+		g_assert_nonnull(rm_xmlnode_get_child(node, "Path"));
+
+		rm_xmlnode_free(node);
+	}
+}
+
+static void test_xml_names(void)
+{
+	const gchar *xml = "<root><rmTestOnlyElement rmTestOnlyAttrib=\"1\"/><rmTestOnlyElement rmTestOnlyAttrib=\"2\"/></root>";
+	RmXmlNodeParseFlags modes[] = { RM_XMLNODE_PARSE_DEFAULT, RM_XMLNODE_PARSE_ARENA };
+	guint idx;
+
+	for (idx = 0; idx < G_N_ELEMENTS(modes); idx++) {
+		RmXmlNode *node = rm_xmlnode_from_str_full(xml, -1, modes[idx]);
+		RmXmlNode *child;
+
+		g_assert_nonnull(node);
+
+		/* Parsing does not intern document names */
+		g_assert_cmpuint(g_quark_try_string("rmTestOnlyElement"), ==, 0);
+		g_assert_cmpuint(g_quark_try_string("rmTestOnlyAttrib"), ==, 0);
+
+		child = rm_xmlnode_get_child(node, "rmTestOnlyElement");
+		g_assert_nonnull(child);
+		g_assert_cmpstr(rm_xmlnode_get_attrib(child, "rmTestOnlyAttrib"), ==, "1");
+
+		child = rm_xmlnode_get_next_twin(child);
+		g_assert_nonnull(child);
+		g_assert_cmpstr(rm_xmlnode_get_attrib(child, "rmTestOnlyAttrib"), ==, "2");
+
+		rm_xmlnode_free(node);
+	}
+}
+
+static void test_xml_write(void)
+{
+	RmXmlNode *node = rm_xmlnode_new("contact");
+	RmXmlNode *child;
+	GOutputStream *stream;
+	gchar *xml;
+	gchar *big;
+	gint len;
+
+	child = rm_xmlnode_new_child(node, "person");
+	rm_xmlnode_insert_data(rm_xmlnode_new_child(child, "realName"), "Doe & <Sons>\x01", -1);
+	child = rm_xmlnode_new_child(node, "telephony");
+	rm_xmlnode_set_attrib(child, "nid", "1");
+	rm_xmlnode_new_child(node, "services");
+
+	xml = rm_xmlnode_to_formatted_str(node, &len);
+	g_assert_cmpstr(xml, ==, "<?xml version='1.0' encoding='UTF-8' ?>\n\n"
+				 "<contact>\n"
+				 "\t<person>\n"
+				 "\t\t<realName>Doe &amp; &lt;Sons&gt;&#x1;</realName>\n"
+				 "\t</person>\n"
+				 "\t<telephony nid='1'/>\n"
+				 "\t<services/>\n"
+				 "</contact>\n");
+	g_assert_cmpint(len, ==, strlen(xml));
+	g_free(xml);
+	rm_xmlnode_free(node);
+
+	/* Streamed output of a document spanning many chunks equals string output */
+	big = test_xml_phonebook(2000);
+	node = rm_xmlnode_from_str(big, -1);
+	xml = rm_xmlnode_to_formatted_str(node, &len);
+
+	stream = g_memory_output_stream_new_resizable();
+	g_assert_true(rm_xmlnode_write_to_stream(node, stream, NULL, NULL));
+	g_assert_true(g_output_stream_close(stream, NULL, NULL));
+	g_assert_cmpuint(g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)), ==, len);
+	g_assert_true(!memcmp(g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(stream)), xml, len));
+
+	g_object_unref(stream);
+	g_free(xml);
+	rm_xmlnode_free(node);
+	g_free(big);
+}
+
+static void test_xml_bench(void)
+{
+	gchar *xml = test_xml_phonebook(20000);
+	RmXmlNodeParseFlags modes[] = { RM_XMLNODE_PARSE_DEFAULT, RM_XMLNODE_PARSE_ARENA };
+	guint idx;
+
+	for (idx = 0; idx < G_N_ELEMENTS(modes); idx++) {
+		RmXmlNode *node;
+
+		g_test_timer_start();
+		node = rm_xmlnode_from_str_full(xml, -1, modes[idx]);
+		g_assert_nonnull(node);
+		rm_xmlnode_free(node);
+
+		g_test_minimized_result(g_test_timer_elapsed(), "%s: parsed and freed 20000 contacts in %f seconds", modes[idx] ? "arena" : "heap", g_test_timer_last());
+	}
+
+	g_free(xml);
+}
+
+int main(int argc, char **argv)
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/xml/arena", test_xml_arena);
+	g_test_add_func("/xml/index", test_xml_index);
+	g_test_add_func("/xml/names", test_xml_names);
+	g_test_add_func("/xml/write", test_xml_write);
+
+	if (g_test_perf()) {
+		g_test_add_func("/xml/bench", test_xml_bench);
+	}
+
+	return g_test_run();
+}